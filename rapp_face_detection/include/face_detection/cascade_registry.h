@@ -0,0 +1,119 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#ifndef RAPP_FACE_DETECTION_CASCADE_REGISTRY
+#define RAPP_FACE_DETECTION_CASCADE_REGISTRY
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <opencv2/objdetect/objdetect.hpp>
+
+/**
+ * @class CascadeRegistry
+ * @brief Process-wide pool of loaded Haar cascade classifiers, keyed by the
+ * cascade file path. A cv::CascadeClassifier keeps scratch state while
+ * detecting, thus each concurrent caller gets its own instance. Released
+ * instances stay in the pool and are handed to later requests, so a cascade
+ * is read from disk at most once per concurrently running request.
+ */
+class CascadeRegistry
+{
+  public:
+
+    /**
+     * @brief   Returns the process-wide registry
+     * @return  [CascadeRegistry&] The registry
+     */
+    static CascadeRegistry& instance(void);
+
+    /**
+     * @brief   Destructor. Frees the idle classifiers
+     */
+    ~CascadeRegistry(void);
+
+    /**
+     * @brief   Loads a cascade into the pool ahead of the first request
+     * @param   path [const std::string&] The Haar training model path
+     * @return  [bool] True if the cascade was loaded successfully
+     */
+    bool preload(const std::string& path);
+
+    /**
+     * @brief   Hands out a classifier for the given cascade. The classifier
+     *          returns to the pool when the last copy of the pointer is
+     *          destroyed.
+     * @param   path [const std::string&] The Haar training model path
+     * @return  [boost::shared_ptr<cv::CascadeClassifier>] The classifier. Empty
+     *          if the cascade could not be loaded.
+     */
+    boost::shared_ptr<cv::CascadeClassifier> acquire(const std::string& path);
+
+  private:
+
+    /**
+     * @brief   Default constructor. Use instance() instead.
+     */
+    CascadeRegistry(void);
+
+    /**
+     * @brief   Loads a new classifier from disk
+     * @param   path [const std::string&] The Haar training model path
+     * @return  [cv::CascadeClassifier*] The classifier, NULL on failure
+     */
+    cv::CascadeClassifier* load(const std::string& path);
+
+    /**
+     * @brief   Returns a classifier to the pool
+     * @param   path [const std::string&] The Haar training model path
+     * @param   cascade [cv::CascadeClassifier*] The classifier
+     */
+    void release(const std::string& path, cv::CascadeClassifier* cascade);
+
+    /**
+     * @class Releaser
+     * @brief Deleter of the handed out pointers, returning them to the pool
+     */
+    struct Releaser
+    {
+      Releaser(CascadeRegistry* registry, const std::string& path) :
+        registry(registry), path(path)
+      {
+      }
+
+      void operator()(cv::CascadeClassifier* cascade)
+      {
+        registry->release(path, cascade);
+      }
+
+      CascadeRegistry* registry;
+      std::string path;
+    };
+    friend struct Releaser;
+
+    /**< Guards the idle pool */
+    boost::mutex mutex_;
+
+    /**< Loaded classifiers currently not in use, per cascade path */
+    std::map<std::string, std::vector<cv::CascadeClassifier*> > idle_;
+};
+
+#endif // RAPP_FACE_DETECTION_CASCADE_REGISTRY
@@ -21,8 +21,12 @@ limitations under the License.
 #include "ros/ros.h"
 
 #include <rapp_platform_ros_communications/FaceDetectionRosSrv.h>
+#include <rapp_platform_ros_communications/FaceDetectionBatchRosSrv.h>
+
+#include <boost/shared_ptr.hpp>
 
 #include <face_detection/face_detector.h>
+#include <face_detection/face_detector_pool.h>
 
 /**
  * @class FaceDetection
@@ -48,7 +52,29 @@ class FaceDetection
       rapp_platform_ros_communications::FaceDetectionRosSrv::Response& res
       );
 
+    /**
+     * @brief Serves the batch face detection ROS service callback
+     * @param req [rapp_platform_ros_communications::FaceDetectionBatchRosSrv::Request&] The ROS service request
+     * @param res [rapp_platform_ros_communications::FaceDetectionBatchRosSrv::Response&] The ROS service response
+     * @return bool - The success status of the call
+     */
+    bool faceDetectionBatchCallback(
+      rapp_platform_ros_communications::FaceDetectionBatchRosSrv::Request& req,
+      rapp_platform_ros_communications::FaceDetectionBatchRosSrv::Response& res
+      );
+
   private:
+
+    /**
+     * @brief Converts the detected faces to corner points, skipping duplicates
+     * @param faces [const std::vector<cv::Rect>&] The detected faces
+     * @param up_left [std::vector<geometry_msgs::PointStamped>&] The faces' up left corners
+     * @param down_right [std::vector<geometry_msgs::PointStamped>&] The faces' down right corners
+     */
+    void facesToPoints(const std::vector<cv::Rect>& faces,
+      std::vector<geometry_msgs::PointStamped>& up_left,
+      std::vector<geometry_msgs::PointStamped>& down_right);
+
     /**< The ROS node handle */
     ros::NodeHandle nh_;
 
@@ -58,8 +84,17 @@ class FaceDetection
     /**< Member variable holding the face detection ROS service topic */
     std::string faceDetectionTopic_;
 
+    /**< The batch face detection service server */
+    ros::ServiceServer faceDetectionBatchService_;
+
+    /**< Member variable holding the batch face detection ROS service topic */
+    std::string faceDetectionBatchTopic_;
+
     /**< Object of type FaceDetector */
     FaceDetector face_detector_;
+
+    /**< The worker pool serving the batch requests */
+    boost::shared_ptr<FaceDetectorPool> face_detector_pool_;
 };
 
 #endif // RAPP_FACE_DETECTION_NODE
@@ -46,6 +46,14 @@ class FaceDetector
      */
     cv::Mat loadImage(std::string file_name);
 
+    /**
+     * @brief   Decodes an image from an in-memory encoded buffer
+     * @param   image_data [const std::vector<unsigned char>&] The encoded
+     *          image data (png, jpg etc)
+     * @return  [cv::Mat] The image in OpenCV representation
+     */
+    cv::Mat decodeImage(const std::vector<unsigned char>& image_data);
+
     /**
      * @brief   Finds faces in an image retrieved from a file URL
      * @param   file_name [std::string] The image file's URL
@@ -55,6 +63,17 @@ class FaceDetector
      */
     std::vector<cv::Rect> findFaces(std::string file_name, bool fast = false);
 
+    /**
+     * @brief   Finds faces in an in-memory encoded image
+     * @param   image_data [const std::vector<unsigned char>&] The encoded
+     *          image data (png, jpg etc)
+     * @param   fast [bool] True for fast detection -- frontal only
+     * @return  [std::vector<cv::Rect>] A vector containing the detected faces.
+     *          Each face is represented by a rectangle.
+     */
+    std::vector<cv::Rect> findFaces(
+      const std::vector<unsigned char>& image_data, bool fast = false);
+
     /**
      * @brief   Detects faces from a cv::Mat
      * @param   input_img [const cv::Mat&] The input image
@@ -65,8 +84,83 @@ class FaceDetector
     std::vector<cv::Rect> detectFaces(const cv::Mat& input_img, 
       bool fast = false);
 
+    /**
+     * @brief   Sets the maximum number of chunks the candidate faces of a
+     *          single cascade run are split into, run in parallel by OpenCV's
+     *          thread pool
+     * @param   threads [unsigned int] The number of chunks. 1 verifies the
+     *          candidates sequentially on the calling thread.
+     */
+    void setVerificationThreads(unsigned int threads);
+
+    /**
+     * @brief   Sets the resolution the detection runs at. Images with a longer
+     *          edge are downscaled before the detection and the faces are mapped
+     *          back to the original coordinates.
+     * @param   max_long_edge [int] The maximum long edge in pixels, 0 or
+     *          negative to always detect at the original resolution
+     * @param   refine [bool] True to refine every face found in a downscaled
+     *          image on the original resolution
+     */
+    void setDetectionResolution(int max_long_edge, bool refine = false);
+
   private:
 
+    /**< Minimum number of candidate faces in a verification chunk */
+    static const unsigned int CANDIDATES_PER_THREAD = 2;
+
+    /**< Maximum number of chunks the candidates of a cascade run are split
+     * into */
+    unsigned int verification_threads_;
+
+    /**< Runs the verification chunks on OpenCV's thread pool */
+    class VerificationBody;
+
+    /**< Runs the frontal and the profile cascades on OpenCV's thread pool */
+    class CascadeBody;
+
+    /**< The maximum long edge of the scanned image, 0 for no downscaling */
+    int max_long_edge_;
+
+    /**< True to refine the faces found in a downscaled image */
+    bool refine_;
+
+    /**
+     * @brief   Runs the face detection pipeline on an equalized grayscale image
+     * @param   grayscale_img [const cv::Mat&] The equalized grayscale image
+     * @param   fast [bool] True for fast detection -- frontal only
+     * @return  [std::vector<cv::Rect>] A vector containing the detected faces.
+     *          Each face is represented by a rectangle.
+     */
+    std::vector<cv::Rect> runCascades(const cv::Mat& grayscale_img,
+      bool fast);
+
+    /**
+     * @brief   Computes the factor an image is scaled by before the detection
+     * @param   size [const cv::Size&] The image's size
+     * @return  [double] The scale factor, 1 if the image is scanned as is
+     */
+    double detectionScale(const cv::Size& size) const;
+
+    /**
+     * @brief   Refines a face found at a reduced resolution, by running the
+     *          cascade on the full resolution region around it
+     * @param   grayscale_img [const cv::Mat&] The full resolution equalized
+     *          grayscale image
+     * @param   face [const cv::Rect&] The face, in full resolution coordinates
+     * @param   fast [bool] True for fast detection -- frontal only
+     * @return  [cv::Rect] The refined face. The input face if the cascades
+     *          did not confirm it.
+     */
+    cv::Rect refineFace(const cv::Mat& grayscale_img, const cv::Rect& face,
+      bool fast);
+
+    /**< The frontal face Haar training model path */
+    static const std::string FRONTAL_CASCADE_PATH;
+
+    /**< The profile face Haar training model path */
+    static const std::string PROFILE_CASCADE_PATH;
+
     /**
      * @brief   Detects faces from a cv::Mat
      * @param   input_img [const cv::Mat&] The input image
@@ -77,6 +171,35 @@ class FaceDetector
     std::vector<cv::Rect> detectFaces(const cv::Mat& input_img,
       const std::string& haar_path);
 
+    /**
+     * @brief   Detects faces from a cv::Mat, storing them in the given vector.
+     *          Used as the entry point of the concurrent cascade runs, thus
+     *          a failure is stored instead of thrown.
+     * @param   input_img [const cv::Mat&] The input image
+     * @param   haar_path [const std::string&] The Haar training model path
+     * @param   faces [std::vector<cv::Rect>*] Where the detected faces are stored
+     * @param   error [cv::Exception*] Where the failure is stored
+     * @param   failed [bool*] Set to true if the detection failed
+     */
+    void detectFacesInto(const cv::Mat& input_img,
+      const std::string& haar_path, std::vector<cv::Rect>* faces,
+      cv::Exception* error, bool* failed);
+
+    /**
+     * @brief   Re-runs the cascade inside every candidate face of a strided
+     *          subset of the candidates, to eliminate false positives
+     * @param   input_img [const cv::Mat&] The input image
+     * @param   haar_path [const std::string&] The Haar training model path
+     * @param   faces [const std::vector<cv::Rect>&] The candidate faces
+     * @param   first [unsigned int] The first candidate to verify
+     * @param   stride [unsigned int] The distance between verified candidates
+     * @param   verified [std::vector<char>*] Set to 1 for every confirmed
+     *          candidate
+     */
+    void verifyFaces(const cv::Mat& input_img, const std::string& haar_path,
+      const std::vector<cv::Rect>& faces, unsigned int first,
+      unsigned int stride, std::vector<char>* verified) const;
+
     /**
      * @brief   Identify unique faces from two sets of faces
      * @param   frontFaceVector [const std::vector<cv::Rect>&] The first set of faces
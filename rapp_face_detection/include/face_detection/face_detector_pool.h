@@ -0,0 +1,119 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#ifndef RAPP_FACE_DETECTOR_POOL
+#define RAPP_FACE_DETECTOR_POOL
+
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <face_detection/face_detector.h>
+
+/**
+ * @class FaceDetectorPool
+ * @brief Fans batches of images out to a fixed set of worker threads, each
+ * one owning a FaceDetector, so that the throughput of batch requests scales
+ * with the available cores.
+ */
+class FaceDetectorPool
+{
+  public:
+
+    /**
+     * @brief   Constructor. Starts the worker threads.
+     * @param   workers [unsigned int] The number of worker threads. At least
+     *          one worker is always started.
+     * @param   prototype [const FaceDetector&] The detector every worker's
+     *          detector is copied from, carrying its configuration. The
+     *          workers verify the candidate faces sequentially.
+     */
+    explicit FaceDetectorPool(unsigned int workers,
+      const FaceDetector& prototype = FaceDetector());
+
+    /**
+     * @brief   Destructor. Stops and joins the worker threads.
+     */
+    ~FaceDetectorPool(void);
+
+    /**
+     * @brief   Finds faces in a batch of images retrieved from file URLs.
+     *          Blocks until all the images are processed.
+     * @param   file_names [const std::vector<std::string>&] The image files' URLs
+     * @param   fast [bool] True for fast detection -- frontal only
+     * @return  [std::vector<std::vector<cv::Rect> >] The detected faces of
+     *          each image, in the order of the input files
+     */
+    std::vector<std::vector<cv::Rect> > findFaces(
+      const std::vector<std::string>& file_names, bool fast = false);
+
+    /**
+     * @brief   Returns the number of worker threads
+     * @return  [unsigned int] The number of worker threads
+     */
+    unsigned int size(void) const;
+
+  private:
+
+    /**
+     * @class Job
+     * @brief A single image of a batch, waiting for a worker
+     */
+    struct Job
+    {
+      /**< The image file's URL */
+      const std::string* file_name;
+      /**< True for fast detection */
+      bool fast;
+      /**< Where the detected faces are stored */
+      std::vector<cv::Rect>* faces;
+      /**< Counter of the batch's unfinished jobs */
+      unsigned int* pending;
+    };
+
+    /**
+     * @brief   The worker threads' loop
+     * @param   face_detector [boost::shared_ptr<FaceDetector>] The worker's detector
+     */
+    void work(boost::shared_ptr<FaceDetector> face_detector);
+
+    /**< The worker threads */
+    boost::thread_group workers_;
+
+    /**< The detectors owned by the worker threads */
+    std::vector<boost::shared_ptr<FaceDetector> > face_detectors_;
+
+    /**< Guards the job queue and the batches' counters */
+    boost::mutex mutex_;
+
+    /**< Signaled when jobs are queued or the pool is stopping */
+    boost::condition_variable jobs_available_;
+
+    /**< Signaled when a batch is finished */
+    boost::condition_variable batch_done_;
+
+    /**< The queued jobs */
+    std::deque<Job> jobs_;
+
+    /**< Set when the workers must exit */
+    bool stopping_;
+};
+
+#endif // RAPP_FACE_DETECTOR_POOL
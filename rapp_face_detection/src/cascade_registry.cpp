@@ -0,0 +1,137 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <face_detection/cascade_registry.h>
+
+/**
+ * @brief   Returns the process-wide registry
+ * @return  [CascadeRegistry&] The registry
+ */
+CascadeRegistry& CascadeRegistry::instance(void)
+{
+  static CascadeRegistry registry;
+  return registry;
+}
+
+/**
+ * @brief   Default constructor
+ */
+CascadeRegistry::CascadeRegistry(void)
+{
+}
+
+/**
+ * @brief   Destructor. Frees the idle classifiers
+ */
+CascadeRegistry::~CascadeRegistry(void)
+{
+  std::map<std::string, std::vector<cv::CascadeClassifier*> >::iterator it;
+  for(it = idle_.begin() ; it != idle_.end() ; it++)
+  {
+    for(unsigned int i = 0 ; i < it->second.size() ; i++)
+    {
+      delete it->second[i];
+    }
+  }
+}
+
+/**
+ * @brief   Loads a cascade into the pool ahead of the first request
+ * @param   path [const std::string&] The Haar training model path
+ * @return  [bool] True if the cascade was loaded successfully
+ */
+bool CascadeRegistry::preload(const std::string& path)
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if(!idle_[path].empty())
+    {
+      return true;
+    }
+  }
+  cv::CascadeClassifier* cascade = load(path);
+  if(cascade == NULL)
+  {
+    return false;
+  }
+  release(path, cascade);
+  return true;
+}
+
+/**
+ * @brief   Hands out a classifier for the given cascade. The classifier
+ *          returns to the pool when the last copy of the pointer is
+ *          destroyed.
+ * @param   path [const std::string&] The Haar training model path
+ * @return  [boost::shared_ptr<cv::CascadeClassifier>] The classifier. Empty
+ *          if the cascade could not be loaded.
+ */
+boost::shared_ptr<cv::CascadeClassifier> CascadeRegistry::acquire(
+  const std::string& path)
+{
+  cv::CascadeClassifier* cascade = NULL;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::vector<cv::CascadeClassifier*>& idle = idle_[path];
+    if(!idle.empty())
+    {
+      cascade = idle.back();
+      idle.pop_back();
+    }
+  }
+
+  // All the loaded instances are busy -- the loading happens outside the
+  // lock, so that the rest of the requests are not blocked on disk access
+  if(cascade == NULL)
+  {
+    cascade = load(path);
+  }
+  if(cascade == NULL)
+  {
+    return boost::shared_ptr<cv::CascadeClassifier>();
+  }
+  return boost::shared_ptr<cv::CascadeClassifier>(cascade,
+    Releaser(this, path));
+}
+
+/**
+ * @brief   Loads a new classifier from disk
+ * @param   path [const std::string&] The Haar training model path
+ * @return  [cv::CascadeClassifier*] The classifier, NULL on failure
+ */
+cv::CascadeClassifier* CascadeRegistry::load(const std::string& path)
+{
+  cv::CascadeClassifier* cascade = new cv::CascadeClassifier;
+  if(!cascade->load(path))
+  {
+    delete cascade;
+    return NULL;
+  }
+  return cascade;
+}
+
+/**
+ * @brief   Returns a classifier to the pool
+ * @param   path [const std::string&] The Haar training model path
+ * @param   cascade [cv::CascadeClassifier*] The classifier
+ */
+void CascadeRegistry::release(const std::string& path,
+  cv::CascadeClassifier* cascade)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  idle_[path].push_back(cascade);
+}
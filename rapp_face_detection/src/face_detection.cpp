@@ -31,6 +31,42 @@ FaceDetection::FaceDetection(void)
   // Creating the service server concerning the face detection functionality
   faceDetectionService_ = nh_.advertiseService(faceDetectionTopic_,
     &FaceDetection::faceDetectionCallback, this);
+
+  // Large images are scanned at a reduced resolution
+  int max_long_edge = 0;
+  bool refine = false;
+  if(!nh_.getParam("/rapp_face_detection_max_long_edge", max_long_edge))
+  {
+    ROS_WARN("Face detection max long edge param not found, not downscaling");
+  }
+  if(!nh_.getParam("/rapp_face_detection_refine", refine))
+  {
+    ROS_WARN("Face detection refine param not found, not refining");
+  }
+  face_detector_.setDetectionResolution(max_long_edge, refine);
+
+  // The batch requests are spread over a pool of detectors, one per core
+  // unless stated otherwise
+  int batch_threads = boost::thread::hardware_concurrency();
+  if(!nh_.getParam("/rapp_face_detection_batch_threads", batch_threads))
+  {
+    ROS_WARN("Face detection batch threads param not found, using %d",
+      batch_threads);
+  }
+  if(batch_threads < 1)
+  {
+    batch_threads = 1;
+  }
+  face_detector_pool_.reset(new FaceDetectorPool(batch_threads,
+    face_detector_));
+
+  if(!nh_.getParam("/rapp_face_detection_detect_faces_batch_topic",
+      faceDetectionBatchTopic_))
+  {
+    ROS_ERROR("Face detection batch topic param does not exist");
+  }
+  faceDetectionBatchService_ = nh_.advertiseService(faceDetectionBatchTopic_,
+    &FaceDetection::faceDetectionBatchCallback, this);
 }
 
 /**
@@ -43,10 +79,55 @@ bool FaceDetection::faceDetectionCallback(
   rapp_platform_ros_communications::FaceDetectionRosSrv::Request& req,
   rapp_platform_ros_communications::FaceDetectionRosSrv::Response& res)
 {
-  std::vector<unsigned int [4]> history;
-  std::vector<cv::Rect> faces = face_detector_.findFaces(req.imageFilename,
-    req.fast);
+  std::vector<cv::Rect> faces;
+  // In-message image data take precedence over the image file
+  if(!req.imageData.empty())
+  {
+    faces = face_detector_.findFaces(req.imageData, req.fast);
+  }
+  else
+  {
+    faces = face_detector_.findFaces(req.imageFilename, req.fast);
+  }
+  facesToPoints(faces, res.faces_up_left, res.faces_down_right);
 
+  return true;
+}
+
+/**
+ * @brief Serves the batch face detection ROS service callback
+ * @param req [rapp_platform_ros_communications::FaceDetectionBatchRosSrv::Request&] The ROS service request
+ * @param res [rapp_platform_ros_communications::FaceDetectionBatchRosSrv::Response&] The ROS service response
+ * @return bool - The success status of the call
+ */
+bool FaceDetection::faceDetectionBatchCallback(
+  rapp_platform_ros_communications::FaceDetectionBatchRosSrv::Request& req,
+  rapp_platform_ros_communications::FaceDetectionBatchRosSrv::Response& res)
+{
+  std::vector<std::vector<cv::Rect> > faces =
+    face_detector_pool_->findFaces(req.imageFilenames, req.fast);
+
+  res.faces.resize(faces.size());
+  for(unsigned int i = 0 ; i < faces.size() ; i++)
+  {
+    facesToPoints(faces[i], res.faces[i].faces_up_left,
+      res.faces[i].faces_down_right);
+  }
+
+  return true;
+}
+
+/**
+ * @brief Converts the detected faces to corner points, skipping duplicates
+ * @param faces [const std::vector<cv::Rect>&] The detected faces
+ * @param up_left [std::vector<geometry_msgs::PointStamped>&] The faces' up left corners
+ * @param down_right [std::vector<geometry_msgs::PointStamped>&] The faces' down right corners
+ */
+void FaceDetection::facesToPoints(const std::vector<cv::Rect>& faces,
+  std::vector<geometry_msgs::PointStamped>& up_left,
+  std::vector<geometry_msgs::PointStamped>& down_right)
+{
+  std::vector<unsigned int [4]> history;
   for(unsigned int i = 0 ; i < faces.size() ; i++)
   {
 
@@ -79,9 +160,7 @@ bool FaceDetection::faceDetectionCallback(
     down_right_corner.point.x = temp[2];
     down_right_corner.point.y = temp[3];
 
-    res.faces_up_left.push_back(up_left_corner);
-    res.faces_down_right.push_back(down_right_corner);
+    up_left.push_back(up_left_corner);
+    down_right.push_back(down_right_corner);
   }
-
-  return true;
 }
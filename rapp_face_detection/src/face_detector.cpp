@@ -19,12 +19,155 @@ limitations under the License.
 ******************************************************************************/
 
 #include <face_detection/face_detector.h>
+#include <face_detection/cascade_registry.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+
+/**< The frontal face Haar training model */
+const std::string FaceDetector::FRONTAL_CASCADE_PATH =
+  "/usr/share/opencv/haarcascades/haarcascade_frontalface_alt.xml";
+
+/**< The profile face Haar training model */
+const std::string FaceDetector::PROFILE_CASCADE_PATH =
+  "/usr/share/opencv/haarcascades/haarcascade_profileface.xml";
+
+/**
+ * @class FaceDetector::VerificationBody
+ * @brief The chunks of a candidate verification, run by cv::parallel_for_.
+ * Chunk t verifies the candidates t, t + chunks, t + 2 * chunks... An
+ * exception must not escape OpenCV's thread pool, thus the failure of a
+ * chunk is stored and rethrown by detectFaces.
+ */
+class FaceDetector::VerificationBody : public cv::ParallelLoopBody
+{
+  public:
+
+    VerificationBody(const FaceDetector& face_detector,
+      const cv::Mat& input_img, const std::string& haar_path,
+      const std::vector<cv::Rect>& faces, unsigned int chunks,
+      std::vector<char>* verified, std::vector<cv::Exception>* errors,
+      std::vector<char>* failed) :
+      face_detector_(face_detector),
+      input_img_(input_img),
+      haar_path_(haar_path),
+      faces_(faces),
+      chunks_(chunks),
+      verified_(verified),
+      errors_(errors),
+      failed_(failed)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+      for(int t = range.start ; t < range.end ; t++)
+      {
+        try
+        {
+          face_detector_.verifyFaces(input_img_, haar_path_, faces_, t,
+            chunks_, verified_);
+        }
+        catch(cv::Exception& e)
+        {
+          (*errors_)[t] = e;
+          (*failed_)[t] = 1;
+        }
+      }
+    }
+
+  private:
+
+    const FaceDetector& face_detector_;
+    const cv::Mat& input_img_;
+    const std::string& haar_path_;
+    const std::vector<cv::Rect>& faces_;
+    unsigned int chunks_;
+    std::vector<char>* verified_;
+    std::vector<cv::Exception>* errors_;
+    std::vector<char>* failed_;
+};
+
+/**
+ * @class FaceDetector::CascadeBody
+ * @brief The cascades of a detection, run by cv::parallel_for_. Index 0 is
+ * the frontal cascade, index 1 the profile one
+ */
+class FaceDetector::CascadeBody : public cv::ParallelLoopBody
+{
+  public:
+
+    CascadeBody(FaceDetector& face_detector, const cv::Mat& input_img,
+      std::vector<cv::Rect>* faces, cv::Exception* errors, bool* failed) :
+      face_detector_(face_detector),
+      input_img_(input_img),
+      faces_(faces),
+      errors_(errors),
+      failed_(failed)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+      for(int c = range.start ; c < range.end ; c++)
+      {
+        face_detector_.detectFacesInto(input_img_,
+          c == 0 ? FRONTAL_CASCADE_PATH : PROFILE_CASCADE_PATH, &faces_[c],
+          &errors_[c], &failed_[c]);
+      }
+    }
+
+  private:
+
+    FaceDetector& face_detector_;
+    const cv::Mat& input_img_;
+    std::vector<cv::Rect>* faces_;
+    cv::Exception* errors_;
+    bool* failed_;
+};
 
 /** 
- * @brief Default constructor
+ * @brief Default constructor. Loads the Haar cascades, so that the first
+ * request does not pay for reading them from disk.
+ */
+FaceDetector::FaceDetector(void) :
+  verification_threads_(boost::thread::hardware_concurrency()),
+  max_long_edge_(0),
+  refine_(false)
+{
+  if(verification_threads_ == 0)
+  {
+    verification_threads_ = 1;
+  }
+  CascadeRegistry::instance().preload(FRONTAL_CASCADE_PATH);
+  CascadeRegistry::instance().preload(PROFILE_CASCADE_PATH);
+}
+
+/**
+ * @brief   Sets the maximum number of chunks the candidate faces of a single
+ *          cascade run are split into, run in parallel by OpenCV's thread pool
+ * @param   threads [unsigned int] The number of chunks. 1 verifies the
+ *          candidates sequentially on the calling thread.
+ */
+void FaceDetector::setVerificationThreads(unsigned int threads)
+{
+  verification_threads_ = threads > 0 ? threads : 1;
+}
+
+/**
+ * @brief   Sets the resolution the detection runs at. Images with a longer
+ *          edge are downscaled before the detection and the faces are mapped
+ *          back to the original coordinates.
+ * @param   max_long_edge [int] The maximum long edge in pixels, 0 or
+ *          negative to always detect at the original resolution
+ * @param   refine [bool] True to refine every face found in a downscaled
+ *          image on the original resolution
  */
-FaceDetector::FaceDetector(void)
+void FaceDetector::setDetectionResolution(int max_long_edge, bool refine)
 {
+  max_long_edge_ = max_long_edge;
+  refine_ = refine;
 }
 
 /**
@@ -40,6 +183,24 @@ cv::Mat FaceDetector::loadImage(std::string file_name)
   return input_img;
 }
 
+/**
+ * @brief   Decodes an image from an in-memory encoded buffer
+ * @param   image_data [const std::vector<unsigned char>&] The encoded
+ *          image data (png, jpg etc)
+ * @return  [cv::Mat] The image in OpenCV representation
+ */
+cv::Mat FaceDetector::decodeImage(const std::vector<unsigned char>& image_data)
+{
+  cv::Mat input_img;
+  if(image_data.empty())
+  {
+    return input_img;
+  }
+  // Returns an empty matrix if the data cannot be decoded
+  input_img = cv::imdecode(image_data, CV_LOAD_IMAGE_COLOR);
+  return input_img;
+}
+
 /**
  * @brief   Detects faces from a cv::Mat
  * @param   input_img [const cv::Mat&] The input image
@@ -50,33 +211,172 @@ cv::Mat FaceDetector::loadImage(std::string file_name)
 std::vector<cv::Rect> FaceDetector::detectFaces(
   const cv::Mat& input_img, bool fast)
 {
-  std::vector<cv::Rect> front_faces, profile_faces, final_faces;
-  cv::Mat grayscale_img;
+  std::vector<cv::Rect> final_faces;
+  cv::Mat grayscale_img, detection_img;
   if( input_img.empty() )
   {
     return final_faces;
   }
   cv::cvtColor(input_img, grayscale_img, CV_BGR2GRAY);
-  cv::equalizeHist(grayscale_img, grayscale_img);
 
-  // Detect Front Faces
-  std::string haar_file_path =
-    "/usr/share/opencv/haarcascades/haarcascade_frontalface_alt.xml";
-  front_faces = detectFaces( grayscale_img, haar_file_path );
+  // Large images are scanned at a reduced resolution
+  double scale = detectionScale(grayscale_img.size());
+  if(scale < 1.0)
+  {
+    cv::resize(grayscale_img, detection_img, cv::Size(), scale, scale,
+      cv::INTER_AREA);
+  }
+  else
+  {
+    detection_img = grayscale_img;
+  }
+  cv::equalizeHist(detection_img, detection_img);
+
+  final_faces = runCascades(detection_img, fast);
+  if(scale >= 1.0)
+  {
+    return final_faces;
+  }
 
+  // Map the faces back to the original image's coordinates
+  for(unsigned int i = 0 ; i < final_faces.size() ; i++)
+  {
+    final_faces[i] = cv::Rect(
+      cvRound(final_faces[i].x / scale),
+      cvRound(final_faces[i].y / scale),
+      cvRound(final_faces[i].width / scale),
+      cvRound(final_faces[i].height / scale)) &
+      cv::Rect(0, 0, grayscale_img.cols, grayscale_img.rows);
+  }
+
+  if(refine_)
+  {
+    cv::equalizeHist(grayscale_img, grayscale_img);
+    for(unsigned int i = 0 ; i < final_faces.size() ; i++)
+    {
+      final_faces[i] = refineFace(grayscale_img, final_faces[i], fast);
+    }
+  }
+  return final_faces;
+}
+
+/**
+ * @brief   Runs the face detection pipeline on an equalized grayscale image
+ * @param   grayscale_img [const cv::Mat&] The equalized grayscale image
+ * @param   fast [bool] True for fast detection -- frontal only
+ * @return  [std::vector<cv::Rect>] A vector containing the detected faces.
+ *          Each face is represented by a rectangle.
+ */
+std::vector<cv::Rect> FaceDetector::runCascades(
+  const cv::Mat& grayscale_img, bool fast)
+{
   if(fast)
   {
-    return front_faces;
+    // Detect Front Faces
+    return detectFaces( grayscale_img, FRONTAL_CASCADE_PATH );
+  }
+
+  // The two cascades only read the shared grayscale image and each one uses
+  // its own classifier instance, thus the front and the profile faces are
+  // detected concurrently on OpenCV's thread pool. A failure of either
+  // cascade is rethrown here, the front one first, as the sequential
+  // detection would have thrown it.
+  std::vector<cv::Rect> faces[2];
+  cv::Exception errors[2];
+  bool failed[2] = {false, false};
+  cv::parallel_for_(cv::Range(0, 2), CascadeBody(*this, grayscale_img, faces,
+    errors, failed));
+  for(unsigned int c = 0 ; c < 2 ; c++)
+  {
+    if(failed[c])
+    {
+      throw errors[c];
+    }
   }
 
-  // Detect Profile Faces
-  haar_file_path = "/usr/share/opencv/haarcascades/haarcascade_profileface.xml";
-  profile_faces = detectFaces( grayscale_img, haar_file_path );
+  // Identify unique faces. The front faces always come first, so the result
+  // does not depend on which cascade finished first
+  return identifyUniqueFaces( faces[0], faces[1] );
+}
 
-  // Identify unique faces
-  final_faces = identifyUniqueFaces( front_faces, profile_faces );
+/**
+ * @brief   Computes the factor an image is scaled by before the detection
+ * @param   size [const cv::Size&] The image's size
+ * @return  [double] The scale factor, 1 if the image is scanned as is
+ */
+double FaceDetector::detectionScale(const cv::Size& size) const
+{
+  int long_edge = std::max(size.width, size.height);
+  if(max_long_edge_ <= 0 || long_edge <= max_long_edge_)
+  {
+    return 1.0;
+  }
+  return static_cast<double>(max_long_edge_) / long_edge;
+}
 
-  return final_faces;
+/**
+ * @brief   Refines a face found at a reduced resolution, by running the
+ *          cascade on the full resolution region around it
+ * @param   grayscale_img [const cv::Mat&] The full resolution equalized
+ *          grayscale image
+ * @param   face [const cv::Rect&] The face, in full resolution coordinates
+ * @param   fast [bool] True for fast detection -- frontal only
+ * @return  [cv::Rect] The refined face. The input face if the cascades
+ *          did not confirm it.
+ */
+cv::Rect FaceDetector::refineFace(const cv::Mat& grayscale_img,
+  const cv::Rect& face, bool fast)
+{
+  // The region around the face, padded by a quarter of its size
+  cv::Rect roi(face.x - face.width / 4, face.y - face.height / 4,
+    face.width + face.width / 2, face.height + face.height / 2);
+  roi &= cv::Rect(0, 0, grayscale_img.cols, grayscale_img.rows);
+  if(roi.area() == 0)
+  {
+    return face;
+  }
+
+  cv::Size min_size(face.width * 2 / 3, face.height * 2 / 3);
+  cv::Size max_size(roi.width, roi.height);
+
+  std::vector<std::string> cascades;
+  cascades.push_back(FRONTAL_CASCADE_PATH);
+  if(!fast)
+  {
+    cascades.push_back(PROFILE_CASCADE_PATH);
+  }
+
+  for(unsigned int c = 0 ; c < cascades.size() ; c++)
+  {
+    boost::shared_ptr<cv::CascadeClassifier> face_cascade =
+      CascadeRegistry::instance().acquire(cascades[c]);
+    if(!face_cascade)
+    {
+      continue;
+    }
+    std::vector<cv::Rect> found;
+    face_cascade->detectMultiScale(grayscale_img(roi), found, 1.05, 3, 0,
+      min_size, max_size);
+
+    // Keep the detection overlapping the coarse face the most
+    int best_overlap = 0;
+    cv::Rect best;
+    for(unsigned int i = 0 ; i < found.size() ; i++)
+    {
+      cv::Rect candidate = found[i] + roi.tl();
+      int overlap = (candidate & face).area();
+      if(overlap > best_overlap)
+      {
+        best_overlap = overlap;
+        best = candidate;
+      }
+    }
+    if(best_overlap > 0)
+    {
+      return best;
+    }
+  }
+  return face;
 }
 
 /**
@@ -91,21 +391,90 @@ std::vector<cv::Rect> FaceDetector::detectFaces(const cv::Mat& input_img,
 {
   std::vector<cv::Rect> faces, final_faces;
 
-  // The Haar cascade classifier
-  cv::CascadeClassifier face_cascade;
-  // Create the classifier
-  face_cascade.load(haar_path);
+  // The Haar cascade classifier, reused across requests
+  boost::shared_ptr<cv::CascadeClassifier> face_cascade =
+    CascadeRegistry::instance().acquire(haar_path);
+  if(!face_cascade)
+  {
+    return final_faces;
+  }
 
-  face_cascade.detectMultiScale(input_img, faces, 1.1, 4);
+  face_cascade->detectMultiScale(input_img, faces, 1.1, 4);
 
   // If no faces were found make the algorithm less strict
   if(faces.size() == 0)
   {
-    face_cascade.detectMultiScale(input_img, faces, 1.1, 3);
+    face_cascade->detectMultiScale(input_img, faces, 1.1, 3);
+  }
+  // Back to the registry, so that the verification below reuses it
+  face_cascade.reset();
+
+  // Check the faces again to eliminate false positives. Group photos yield
+  // many candidates, so they are split into a bounded number of strided
+  // chunks run by OpenCV's thread pool, each one with its own classifier.
+  // Every candidate gets its own flag, thus the surviving faces keep the
+  // order of the sequential pass. A failed chunk is rethrown here, as the
+  // sequential pass would have thrown it.
+  std::vector<char> verified(faces.size(), 0);
+  unsigned int chunks = (faces.size() + CANDIDATES_PER_THREAD - 1) /
+    CANDIDATES_PER_THREAD;
+  chunks = std::min(chunks, verification_threads_);
+  if(chunks > 1)
+  {
+    std::vector<cv::Exception> errors(chunks);
+    std::vector<char> failed(chunks, 0);
+    cv::parallel_for_(cv::Range(0, chunks), VerificationBody(*this,
+      input_img, haar_path, faces, chunks, &verified, &errors, &failed));
+    for(unsigned int t = 0 ; t < chunks ; t++)
+    {
+      if(failed[t])
+      {
+        throw errors[t];
+      }
+    }
+  }
+  else
+  {
+    verifyFaces(input_img, haar_path, faces, 0, 1, &verified);
   }
 
-  // Check the faces again to eliminate false positives
   for(unsigned int i = 0 ; i < faces.size() ; i++)
+  {
+    if(verified[i])
+    {
+      final_faces.push_back(faces[i]);
+    }
+  }
+  return final_faces;
+}
+
+/**
+ * @brief   Re-runs the cascade inside every candidate face of a strided
+ *          subset of the candidates, to eliminate false positives
+ * @param   input_img [const cv::Mat&] The input image
+ * @param   haar_path [const std::string&] The Haar training model path
+ * @param   faces [const std::vector<cv::Rect>&] The candidate faces
+ * @param   first [unsigned int] The first candidate to verify
+ * @param   stride [unsigned int] The distance between verified candidates
+ * @param   verified [std::vector<char>*] Set to 1 for every confirmed
+ *          candidate
+ */
+void FaceDetector::verifyFaces(const cv::Mat& input_img,
+  const std::string& haar_path, const std::vector<cv::Rect>& faces,
+  unsigned int first, unsigned int stride, std::vector<char>* verified) const
+{
+  if(first >= faces.size())
+  {
+    return;
+  }
+  boost::shared_ptr<cv::CascadeClassifier> face_cascade =
+    CascadeRegistry::instance().acquire(haar_path);
+  if(!face_cascade)
+  {
+    return;
+  }
+
+  for(unsigned int i = first ; i < faces.size() ; i += stride)
   {
     cv::Rect tmp_rect = faces[i];
     tmp_rect.x -= 10;
@@ -120,14 +489,40 @@ std::vector<cv::Rect> FaceDetector::detectFaces(const cv::Mat& input_img,
     }
     cv::Mat temp_map = input_img(faces[i]);
     std::vector<cv::Rect> tmp_faces;
-    face_cascade.detectMultiScale(temp_map, tmp_faces, 1.1, 3);
+    face_cascade->detectMultiScale(temp_map, tmp_faces, 1.1, 3);
     if(tmp_faces.size() == 0)
     {
       continue;
     }
-    final_faces.push_back(faces[i]);
+    (*verified)[i] = 1;
+  }
+}
+
+/**
+ * @brief   Detects faces from a cv::Mat, storing them in the given vector.
+ *          Used as the entry point of the concurrent cascade runs, thus
+ *          a failure is stored instead of thrown.
+ * @param   input_img [const cv::Mat&] The input image
+ * @param   haar_path [const std::string&] The Haar training model path
+ * @param   faces [std::vector<cv::Rect>*] Where the detected faces are stored
+ * @param   error [cv::Exception*] Where the failure is stored
+ * @param   failed [bool*] Set to true if the detection failed
+ */
+void FaceDetector::detectFacesInto(const cv::Mat& input_img,
+  const std::string& haar_path, std::vector<cv::Rect>* faces,
+  cv::Exception* error, bool* failed)
+{
+  // An exception must not escape OpenCV's thread pool, it is handed back to
+  // runCascades and rethrown there
+  try
+  {
+    *faces = detectFaces(input_img, haar_path);
+  }
+  catch(cv::Exception& e)
+  {
+    *error = e;
+    *failed = true;
   }
-  return final_faces;
 }
 
 /**
@@ -171,3 +566,19 @@ std::vector<cv::Rect> FaceDetector::findFaces(std::string file_name, bool fast)
   input_img = loadImage(file_name);
   return detectFaces(input_img, fast);
 }
+
+/**
+ * @brief   Finds faces in an in-memory encoded image
+ * @param   image_data [const std::vector<unsigned char>&] The encoded
+ *          image data (png, jpg etc)
+ * @param   fast [bool] True for fast detection -- frontal only
+ * @return  [std::vector<cv::Rect>] A vector containing the detected faces.
+ *          Each face is represented by a rectangle.
+ */
+std::vector<cv::Rect> FaceDetector::findFaces(
+  const std::vector<unsigned char>& image_data, bool fast)
+{
+  cv::Mat input_img;
+  input_img = decodeImage(image_data);
+  return detectFaces(input_img, fast);
+}
@@ -0,0 +1,159 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <face_detection/face_detector_pool.h>
+
+#include <boost/bind.hpp>
+
+#include <ros/ros.h>
+
+/**
+ * @brief   Constructor. Starts the worker threads.
+ * @param   workers [unsigned int] The number of worker threads. At least
+ *          one worker is always started.
+ * @param   prototype [const FaceDetector&] The detector every worker's
+ *          detector is copied from, carrying its configuration. The
+ *          workers verify the candidate faces sequentially.
+ */
+FaceDetectorPool::FaceDetectorPool(unsigned int workers,
+  const FaceDetector& prototype) :
+  stopping_(false)
+{
+  if(workers == 0)
+  {
+    workers = 1;
+  }
+  for(unsigned int i = 0 ; i < workers ; i++)
+  {
+    boost::shared_ptr<FaceDetector> face_detector(new FaceDetector(prototype));
+    // The workers already keep the cores busy, thus each one verifies its
+    // candidates sequentially
+    face_detector->setVerificationThreads(1);
+    face_detectors_.push_back(face_detector);
+    workers_.create_thread(
+      boost::bind(&FaceDetectorPool::work, this, face_detector));
+  }
+}
+
+/**
+ * @brief   Destructor. Stops and joins the worker threads.
+ */
+FaceDetectorPool::~FaceDetectorPool(void)
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopping_ = true;
+  }
+  jobs_available_.notify_all();
+  workers_.join_all();
+}
+
+/**
+ * @brief   Returns the number of worker threads
+ * @return  [unsigned int] The number of worker threads
+ */
+unsigned int FaceDetectorPool::size(void) const
+{
+  return face_detectors_.size();
+}
+
+/**
+ * @brief   Finds faces in a batch of images retrieved from file URLs.
+ *          Blocks until all the images are processed.
+ * @param   file_names [const std::vector<std::string>&] The image files' URLs
+ * @param   fast [bool] True for fast detection -- frontal only
+ * @return  [std::vector<std::vector<cv::Rect> >] The detected faces of
+ *          each image, in the order of the input files
+ */
+std::vector<std::vector<cv::Rect> > FaceDetectorPool::findFaces(
+  const std::vector<std::string>& file_names, bool fast)
+{
+  std::vector<std::vector<cv::Rect> > faces(file_names.size());
+  if(file_names.empty())
+  {
+    return faces;
+  }
+
+  unsigned int pending = file_names.size();
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for(unsigned int i = 0 ; i < file_names.size() ; i++)
+    {
+      Job job;
+      job.file_name = &file_names[i];
+      job.fast = fast;
+      job.faces = &faces[i];
+      job.pending = &pending;
+      jobs_.push_back(job);
+    }
+  }
+  jobs_available_.notify_all();
+
+  // Each job writes to its own slot of the result, thus the output order
+  // does not depend on which worker served which image
+  boost::mutex::scoped_lock lock(mutex_);
+  while(pending > 0)
+  {
+    batch_done_.wait(lock);
+  }
+  return faces;
+}
+
+/**
+ * @brief   The worker threads' loop
+ * @param   face_detector [boost::shared_ptr<FaceDetector>] The worker's detector
+ */
+void FaceDetectorPool::work(boost::shared_ptr<FaceDetector> face_detector)
+{
+  while(true)
+  {
+    Job job;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while(jobs_.empty() && !stopping_)
+      {
+        jobs_available_.wait(lock);
+      }
+      if(stopping_)
+      {
+        return;
+      }
+      job = jobs_.front();
+      jobs_.pop_front();
+    }
+
+    std::vector<cv::Rect> faces;
+    try
+    {
+      faces = face_detector->findFaces(*job.file_name, job.fast);
+    }
+    catch(cv::Exception& e)
+    {
+      // A broken image must not bring the whole pool down
+      ROS_ERROR("Face detection failed for %s: %s", job.file_name->c_str(),
+        e.what());
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    job.faces->swap(faces);
+    (*job.pending)--;
+    if(*job.pending == 0)
+    {
+      batch_done_.notify_all();
+    }
+  }
+}
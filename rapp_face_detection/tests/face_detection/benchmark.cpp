@@ -0,0 +1,267 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+
+#include <face_detection/face_detector.h>
+#include <ros/package.h>
+
+/**
+ * @brief Returns the milliseconds elapsed since the given tick count
+ */
+double elapsedMs(int64 start)
+{
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+/**
+ * @brief Builds a scene by tiling a face image, for a known number of faces
+ * @param face [const cv::Mat&] The image of a single face
+ * @param count [int] The number of faces in the scene
+ * @return [cv::Mat] The scene
+ */
+cv::Mat tileFaces(const cv::Mat& face, int count)
+{
+  int cols = std::min(count, 5);
+  int rows = (count + cols - 1) / cols;
+  cv::Mat scene(rows * face.rows, cols * face.cols, face.type(),
+    cv::Scalar(0, 0, 0));
+  for(int i = 0 ; i < count ; i++)
+  {
+    cv::Mat cell = scene(cv::Rect((i % cols) * face.cols,
+      (i / cols) * face.rows, face.cols, face.rows));
+    face.copyTo(cell);
+  }
+  return scene;
+}
+
+/**
+ * @brief Times the accurate detection of a scene with sequential and with
+ * threaded verification of the candidate faces, checking that both yield
+ * the same faces
+ * @param name [const char*] The scene's name
+ * @param scene [const cv::Mat&] The scene
+ * @param iterations [int] The number of timed runs
+ */
+void benchmarkVerification(const char* name, const cv::Mat& scene,
+  int iterations)
+{
+  FaceDetector sequential, threaded;
+  sequential.setVerificationThreads(1);
+
+  double sequential_ms = 0, threaded_ms = 0;
+  bool identical = true;
+  size_t faces = 0;
+  for(int i = 0 ; i < iterations ; i++)
+  {
+    int64 start = cv::getTickCount();
+    std::vector<cv::Rect> sequential_faces = sequential.detectFaces(scene);
+    sequential_ms += elapsedMs(start);
+
+    start = cv::getTickCount();
+    std::vector<cv::Rect> threaded_faces = threaded.detectFaces(scene);
+    threaded_ms += elapsedMs(start);
+
+    identical = identical && sequential_faces == threaded_faces;
+    faces = threaded_faces.size();
+  }
+  printf("%-22s %3zu faces  sequential %8.2f ms  threaded %8.2f ms  %s\n",
+    name, faces, sequential_ms / iterations, threaded_ms / iterations,
+    identical ? "identical" : "MISMATCH");
+}
+
+/**
+ * @brief Counts the reference rectangles matched by a detection, i.e.
+ * overlapping it by at least half of their union
+ */
+unsigned int countMatches(const std::vector<cv::Rect>& reference,
+  const std::vector<cv::Rect>& detected)
+{
+  unsigned int matches = 0;
+  for(unsigned int i = 0 ; i < reference.size() ; i++)
+  {
+    for(unsigned int j = 0 ; j < detected.size() ; j++)
+    {
+      double intersection = (reference[i] & detected[j]).area();
+      double uni = reference[i].area() + detected[j].area() - intersection;
+      if(uni > 0 && intersection / uni >= 0.5)
+      {
+        matches++;
+        break;
+      }
+    }
+  }
+  return matches;
+}
+
+/**
+ * @brief Compares the detection at the original resolution of large images
+ * against the detection at a reduced resolution, with and without
+ * refinement. The face samples are upscaled to emulate the 5-12 MP images
+ * of newer robots. The recall is the fraction of the faces found at the
+ * original resolution that are found again.
+ * @param path [const std::string&] The face samples' directory
+ * @param upscale [double] The factor the samples are upscaled by
+ * @param max_long_edge [int] The long edge of the reduced resolution
+ */
+void benchmarkResolution(const std::string& path, double upscale,
+  int max_long_edge)
+{
+  const char* samples[] = {"klpanagi_close_straight.jpg",
+    "klpanagi_medium_straight.jpg", "klpanagi_far_straight.jpg",
+    "etsardou_near.jpg", "etsardou_medium.jpg", "etsardou_close_angle.jpg",
+    "multi_faces_frames/multi_faces.jpg"};
+  const unsigned int samples_count = sizeof(samples) / sizeof(samples[0]);
+
+  const char* modes[] = {"original", "downscaled", "downscaled+refine"};
+  FaceDetector detectors[3];
+  detectors[1].setDetectionResolution(max_long_edge, false);
+  detectors[2].setDetectionResolution(max_long_edge, true);
+
+  double ms[3] = {0, 0, 0};
+  unsigned int matches[3] = {0, 0, 0};
+  unsigned int reference_faces = 0;
+  for(unsigned int s = 0 ; s < samples_count ; s++)
+  {
+    cv::Mat input_img = detectors[0].loadImage(path + samples[s]);
+    if(input_img.empty())
+    {
+      printf("Could not load %s\n", samples[s]);
+      continue;
+    }
+    cv::Mat large_img;
+    cv::resize(input_img, large_img, cv::Size(), upscale, upscale,
+      cv::INTER_LINEAR);
+
+    std::vector<cv::Rect> reference;
+    for(unsigned int m = 0 ; m < 3 ; m++)
+    {
+      int64 start = cv::getTickCount();
+      std::vector<cv::Rect> faces = detectors[m].detectFaces(large_img);
+      ms[m] += elapsedMs(start);
+      if(m == 0)
+      {
+        reference = faces;
+        reference_faces += reference.size();
+      }
+      matches[m] += countMatches(reference, faces);
+    }
+  }
+
+  printf("Images: %u, upscaled by %.1f, max long edge %d\n",
+    samples_count, upscale, max_long_edge);
+  for(unsigned int m = 0 ; m < 3 ; m++)
+  {
+    printf("%-20s %8.2f ms/image  recall %5.1f%%\n", modes[m],
+      ms[m] / samples_count,
+      reference_faces > 0 ? 100.0 * matches[m] / reference_faces : 100.0);
+  }
+}
+
+/**
+ * @brief Measures the per-request cost of loading the Haar cascades, which
+ * the detector used to pay on every call, against the per-request cost of
+ * the detection with the cached cascades.
+ * It then compares the sequential and the threaded verification of the
+ * candidate faces on scenes with 1, 5 and 20 faces, and the detection at
+ * the original against a reduced resolution on large images.
+ * Usage: face_detection_benchmark [iterations]
+ */
+int main(int argc, char **argv)
+{
+  int iterations = 20;
+  if(argc > 1)
+  {
+    iterations = atoi(argv[1]);
+  }
+
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path +
+    std::string("/test_data/face_samples/klpanagi_close_straight.jpg");
+
+  FaceDetector face_detector;
+  cv::Mat input_img = face_detector.loadImage(s);
+  if(input_img.empty())
+  {
+    printf("Could not load %s\n", s.c_str());
+    return 1;
+  }
+
+  double load_ms = 0;
+  for(int i = 0 ; i < iterations ; i++)
+  {
+    int64 start = cv::getTickCount();
+    cv::CascadeClassifier frontal, profile;
+    frontal.load(
+      "/usr/share/opencv/haarcascades/haarcascade_frontalface_alt.xml");
+    profile.load(
+      "/usr/share/opencv/haarcascades/haarcascade_profileface.xml");
+    load_ms += elapsedMs(start);
+  }
+
+  double fast_ms = 0, full_ms = 0;
+  std::vector<double> full_samples;
+  for(int i = 0 ; i < iterations ; i++)
+  {
+    int64 start = cv::getTickCount();
+    face_detector.detectFaces(input_img, true);
+    fast_ms += elapsedMs(start);
+
+    start = cv::getTickCount();
+    face_detector.detectFaces(input_img, false);
+    full_samples.push_back(elapsedMs(start));
+    full_ms += full_samples.back();
+  }
+  std::sort(full_samples.begin(), full_samples.end());
+  double full_p95 = 0;
+  if(!full_samples.empty())
+  {
+    full_p95 = full_samples[(full_samples.size() - 1) * 95 / 100];
+  }
+
+  printf("Iterations:                    %d\n", iterations);
+  printf("Cascade loading (saved):       %8.2f ms/request\n",
+    load_ms / iterations);
+  printf("Detection, fast (cached):      %8.2f ms/request\n",
+    fast_ms / iterations);
+  printf("Detection, accurate (cached):  %8.2f ms/request\n",
+    full_ms / iterations);
+  printf("Detection, accurate (p95):     %8.2f ms/request\n", full_p95);
+
+  // Candidate verification on scenes with 1, 5 and 20 faces
+  cv::Mat face;
+  cv::resize(input_img, face, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+  printf("\nCandidate verification, accurate detection:\n");
+  benchmarkVerification("1 face", tileFaces(face, 1), iterations);
+  benchmarkVerification("5 faces", tileFaces(face, 5), iterations);
+  benchmarkVerification("20 faces", tileFaces(face, 20), iterations);
+
+  cv::Mat group_img = face_detector.loadImage(path +
+    std::string("/test_data/face_samples/multi_faces_frames/multi_faces.jpg"));
+  if(!group_img.empty())
+  {
+    benchmarkVerification("multi_faces.jpg", group_img, iterations);
+  }
+
+  printf("\nDetection resolution, accurate detection:\n");
+  benchmarkResolution(path + std::string("/test_data/face_samples/"), 3.0,
+    1280);
+  return 0;
+}
@@ -25,7 +25,9 @@ import rospkg
 
 from rapp_platform_ros_communications.srv import (
   FaceDetectionRosSrv,
-  FaceDetectionRosSrvRequest
+  FaceDetectionRosSrvRequest,
+  FaceDetectionBatchRosSrv,
+  FaceDetectionBatchRosSrvRequest
   )
 
 
@@ -152,6 +154,56 @@ class FaceDetFunc(unittest.TestCase):
         faces_num = len(response.faces_up_left)
         self.assertEqual( faces_num, 0 )
 
+    ## Tests face detection with in-message image data. Should return 1 face
+    def test_faceExists_imageData(self):
+        rospack = rospkg.RosPack()
+        face_service = rospy.get_param("rapp_face_detection_detect_faces_topic")
+        rospy.wait_for_service(face_service)
+        fd_service = rospy.ServiceProxy(face_service, FaceDetectionRosSrv)
+        req = FaceDetectionRosSrvRequest()
+        with open(rospack.get_path('rapp_testing_tools') + \
+                '/test_data/Lenna.png', 'rb') as image_file:
+            req.imageData = image_file.read()
+        response = fd_service(req)
+        faces_num = len(response.faces_up_left)
+        self.assertEqual( faces_num, 1 )
+
+    ## Tests face detection with in-message data that is not an image. Should not crush and return 0 faces
+    def test_imageDataIsNotImage(self):
+        rospack = rospkg.RosPack()
+        face_service = rospy.get_param("rapp_face_detection_detect_faces_topic")
+        rospy.wait_for_service(face_service)
+        fd_service = rospy.ServiceProxy(face_service, FaceDetectionRosSrv)
+        req = FaceDetectionRosSrvRequest()
+        with open(rospack.get_path('rapp_testing_tools') + \
+                '/test_data/silence_sample.wav', 'rb') as image_file:
+            req.imageData = image_file.read()
+        response = fd_service(req)
+        faces_num = len(response.faces_up_left)
+        self.assertEqual( faces_num, 0 )
+
+    ## Tests batch face detection. Should return one result per image, in order
+    def test_faceExists_batch(self):
+        rospack = rospkg.RosPack()
+        face_service = rospy.get_param(
+                "rapp_face_detection_detect_faces_batch_topic")
+        rospy.wait_for_service(face_service)
+        fd_service = rospy.ServiceProxy(face_service, FaceDetectionBatchRosSrv)
+        req = FaceDetectionBatchRosSrvRequest()
+        test_data = rospack.get_path('rapp_testing_tools') + '/test_data/'
+        req.imageFilenames = [
+                test_data + 'Lenna.png',
+                test_data + 'qr_code_rapp.jpg',
+                test_data + 'face_samples/klpanagi_close_straight.jpg',
+                test_data + 'qr_code_rapp.png'
+                ]
+        response = fd_service(req)
+        self.assertEqual( len(response.faces), 4 )
+        self.assertEqual( len(response.faces[0].faces_up_left), 1 )
+        self.assertEqual( len(response.faces[1].faces_up_left), 0 )
+        self.assertEqual( len(response.faces[2].faces_up_left), 1 )
+        self.assertEqual( len(response.faces[3].faces_up_left), 0 )
+
 ## The main function. Initializes the functional tests
 if __name__ == '__main__':
     import rosunit
@@ -17,7 +17,11 @@ limitations under the License.
 
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <iterator>
+
 #include <face_detection/face_detector.h>
+#include <face_detection/face_detector_pool.h>
 #include <ros/package.h>
 
 /**
@@ -88,6 +92,31 @@ TEST_F(FaceDetectionTest, klpanagi_close_straight_fast_test)
 }
 
 
+/**
+ * @brief Tests face detection with an in-memory encoded image. Should be successful
+ */ 
+TEST_F(FaceDetectionTest, lenna_image_data_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/Lenna.png");
+  std::ifstream image_file(s.c_str(), std::ios::binary);
+  std::vector<unsigned char> image_data(
+    (std::istreambuf_iterator<char>(image_file)),
+    std::istreambuf_iterator<char>());
+  std::vector<cv::Rect> faces = face_detector_->findFaces(image_data);
+  EXPECT_EQ(1,faces.size());
+}
+
+/**
+ * @brief Tests face detection with empty image data. Should return 0 faces
+ */
+TEST_F(FaceDetectionTest, empty_image_data_test)
+{
+  std::vector<unsigned char> image_data;
+  std::vector<cv::Rect> faces = face_detector_->findFaces(image_data);
+  EXPECT_EQ(0,faces.size());
+}
+
 /**
  * @brief Tests face detection with a qr code. Should return 0 faces
  */
@@ -120,6 +149,74 @@ TEST_F(FaceDetectionTest, zero_sized_image_test)
   EXPECT_EQ(0,faces.size());
 }
 
+/**
+ * @brief Tests that threaded verification of the candidate faces yields the
+ * same faces as the sequential one
+ */
+TEST_F(FaceDetectionTest, threaded_verification_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path +
+    std::string("/test_data/face_samples/multi_faces_frames/multi_faces.jpg");
+  face_detector_->setVerificationThreads(1);
+  std::vector<cv::Rect> sequential_faces = face_detector_->findFaces(s);
+  face_detector_->setVerificationThreads(4);
+  std::vector<cv::Rect> threaded_faces = face_detector_->findFaces(s);
+  ASSERT_EQ(sequential_faces.size(), threaded_faces.size());
+  for(unsigned int i = 0 ; i < sequential_faces.size() ; i++)
+  {
+    EXPECT_EQ(sequential_faces[i], threaded_faces[i]);
+  }
+}
+
+/**
+ * @brief Tests face detection at a reduced resolution with refinement. The
+ * face should be found and lie within the original image
+ */
+TEST_F(FaceDetectionTest, lenna_downscaled_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/Lenna.png");
+  face_detector_->setDetectionResolution(256, true);
+  std::vector<cv::Rect> faces = face_detector_->findFaces(s);
+  ASSERT_EQ(1, faces.size());
+  EXPECT_GE(faces[0].x, 0);
+  EXPECT_GE(faces[0].y, 0);
+  EXPECT_LE(faces[0].x + faces[0].width, 512);
+  EXPECT_LE(faces[0].y + faces[0].height, 512);
+}
+
+/**
+ * @brief Tests batch face detection with a face, a qr code and a missing
+ * file. Results should follow the order of the input files
+ */
+TEST_F(FaceDetectionTest, batch_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::vector<std::string> files;
+  files.push_back(path + std::string("/test_data/Lenna.png"));
+  files.push_back(path + std::string("/test_data/qr_code_rapp.jpg"));
+  files.push_back(path + std::string("/test_data/not_existent_file.jpg"));
+
+  FaceDetectorPool pool(2);
+  std::vector<std::vector<cv::Rect> > faces = pool.findFaces(files);
+  ASSERT_EQ(3, faces.size());
+  EXPECT_EQ(1, faces[0].size());
+  EXPECT_EQ(0, faces[1].size());
+  EXPECT_EQ(0, faces[2].size());
+}
+
+/**
+ * @brief Tests batch face detection with an empty batch
+ */
+TEST_F(FaceDetectionTest, empty_batch_test)
+{
+  FaceDetectorPool pool(2);
+  std::vector<std::vector<cv::Rect> > faces =
+    pool.findFaces(std::vector<std::string>());
+  EXPECT_EQ(0, faces.size());
+}
+
 /**
  * @brief The main function. Initialized the unit tests
  */
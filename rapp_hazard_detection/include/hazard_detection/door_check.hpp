@@ -27,6 +27,8 @@ limitations under the License.
 
 #include <opencv2/opencv.hpp>
 
+#include <hazard_detection/line_buffer.hpp>
+
 /**
  * Parameters for door checking behaviour.
  */
@@ -61,7 +63,10 @@ struct DoorCheckParams {
   // Additional parameters
   // -------------------------------------------------------------------
   
-  /// Debug flag. If set, additional output is produced.
+  /// Maximal length of the longer image edge, larger images are reduced on load. 0 for the original resolution.
+  int max_long_edge;
+  
+  /// Debug flag. If set, the detected lines are saved to /tmp/door_out.png. Effective only in builds with the HAZARD_DETECTION_DEBUG option.
   bool debug;
   
   // -------------------------------------------------------------------
@@ -76,8 +81,46 @@ struct DoorCheckParams {
     hough_gap(20),
     hough_len(60),
     hough_thr(80),
+    max_long_edge(0),
     debug(false)
   {}
+  
+  /**
+   * Get the parameters matching an image scaled by the given factor. 
+   * Pixel-sized parameters are scaled, the threshold block is kept odd.
+   * 
+   * \param scale image scale factor
+   * 
+   * \return scaled parameters
+   */
+  DoorCheckParams scaled(double scale) const {
+    DoorCheckParams res = *this;
+    res.thr_block = cvRound(thr_block * scale) | 1;
+    if (res.thr_block < 3) res.thr_block = 3;
+    res.hough_gap = cvRound(hough_gap * scale);
+    res.hough_len = cvRound(hough_len * scale);
+    // votes are cast by the line pixels, so the threshold follows the length
+    res.hough_thr = cvRound(hough_thr * scale);
+    if (res.hough_thr < 1) res.hough_thr = 1;
+    return res;
+  }
+};
+
+/**
+ * Door frame lines chosen among the detected line segments.
+ */
+struct DoorFrame {
+  /// Index of the vertical door frame line, -1 if not found.
+  int center;
+
+  /// Index of the left floor/wall crossing line, -1 if not found.
+  int left;
+
+  /// Index of the right floor/wall crossing line, -1 if not found.
+  int right;
+
+  /// Default constructor, no lines found.
+  DoorFrame() : center(-1), left(-1), right(-1) {}
 };
 
 /**
@@ -96,6 +139,38 @@ public:
    */
   int process( const std::string & fname, DoorCheckParams params = DoorCheckParams() );
 
+  /**
+   * Estimate angle of the door on an already loaded image. The image is not
+   * modified, so it can be shared with other checks.
+   * 
+   * \param img input grayscale image
+   * \param params processing parameters, matching the image resolution
+   * 
+   * \return estimated door opening angle (in degrees), -1 if the image is empty
+   */
+  int process( const cv::Mat & img, DoorCheckParams params = DoorCheckParams() );
+
+  /**
+   * Choose the door frame lines among the line segments. The vertical line
+   * and both floor/wall crossing lines are scored in a single pass.
+   * 
+   * \param lines detected line segments
+   * \param size size of the image the segments were detected in
+   * 
+   * \return chosen door frame lines
+   */
+  DoorFrame find_frame( const LineBuffer & lines, cv::Size size );
+
+  /**
+   * Compute the door opening angle from the floor/wall crossing lines.
+   * 
+   * \param lines detected line segments
+   * \param frame door frame lines chosen among the segments
+   * 
+   * \return door opening angle (in degrees), 90 if any crossing line is missing
+   */
+  float frame_angle( const LineBuffer & lines, const DoorFrame & frame );
+
 protected:
 };
 
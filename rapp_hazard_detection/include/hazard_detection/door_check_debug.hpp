@@ -0,0 +1,47 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#ifndef RAPP_DOOR_CHECK_DEBUG
+#define RAPP_DOOR_CHECK_DEBUG
+
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+#include <hazard_detection/door_check.hpp>
+
+/**
+ * Debug visualization of the door angle estimation. Compiled only when the
+ * package is built with the HAZARD_DETECTION_DEBUG option, so that the
+ * production build carries no drawing code at all.
+ */
+class DoorCheckDebug {
+public:
+  /**
+   * Draw the detected line segments and the chosen door frame lines on a
+   * copy of the image and save it.
+   * 
+   * \param img processed grayscale image, left untouched
+   * \param lines detected line segments
+   * \param frame door frame lines chosen among the segments
+   * \param fname path of the output image
+   */
+  static void save( const cv::Mat & img, const LineBuffer & lines, const DoorFrame & frame,
+                    const std::string & fname = "/tmp/door_out.png" );
+};
+
+#endif /* RAPP_DOOR_CHECK_DEBUG */
@@ -22,6 +22,7 @@ limitations under the License.
 
 #include <rapp_platform_ros_communications/LightCheckRosSrv.h>
 #include <rapp_platform_ros_communications/DoorCheckRosSrv.h>
+#include <rapp_platform_ros_communications/HazardCheckRosSrv.h>
 
 #include <hazard_detection/light_check.hpp>
 #include <hazard_detection/door_check.hpp>
@@ -61,7 +62,46 @@ class HazardDetection
       rapp_platform_ros_communications::DoorCheckRosSrv::Response& res
       );
 
+    /**
+     * @brief Serves the combined hazard check ROS service callback. The image
+     * is decoded once and both checks run concurrently on it.
+     * @param req [rapp_platform_ros_communications::HazardCheckRosSrv::Request&] The ROS service request
+     * @param res [rapp_platform_ros_communications::HazardCheckRosSrv::Response&] The ROS service response
+     * @return bool - The success status of the call
+     */
+    bool hazardCheckCallback(
+      rapp_platform_ros_communications::HazardCheckRosSrv::Request& req,
+      rapp_platform_ros_communications::HazardCheckRosSrv::Response& res
+      );
+
   private:
+    /**< Runs the door and light checks of a combined hazard check on
+     * OpenCV's thread pool */
+    class CheckBody;
+
+    /**
+     * @brief Runs the door check, storing its result. A failure is reported
+     * through the error message instead of being thrown.
+     * @param img [const cv::Mat&] The grayscale image
+     * @param params [const DoorCheckParams&] The door check parameters
+     * @param door_angle [int*] Where the door angle is stored, -1 on failure
+     * @param error [std::string*] Where the failure is described
+     */
+    void doorCheckInto(const cv::Mat& img, const DoorCheckParams& params,
+      int* door_angle, std::string* error);
+
+    /**
+     * @brief Runs the light check, storing its results. A failure is
+     * reported through the error message instead of being thrown.
+     * @param img [const cv::Mat&] The grayscale image
+     * @param params [const LightCheckParams&] The light check parameters
+     * @param luminance_map [cv::Mat*] Where the luminance map is stored
+     * @param light_level [int*] Where the light level is stored, -1 on failure
+     * @param error [std::string*] Where the failure is described
+     */
+    void lightCheckInto(const cv::Mat& img, const LightCheckParams& params,
+      cv::Mat* luminance_map, int* light_level, std::string* error);
+
     /**< The ROS node handle */
     ros::NodeHandle nh_;
 
@@ -82,6 +122,15 @@ class HazardDetection
     
     /**< Door check implementation*/
     DoorCheck door_check;
+
+    /**< The combined hazard check service server */
+    ros::ServiceServer hazardCheckService_;
+
+    /**< Member variable holding the combined hazard check ROS service name */
+    std::string hazardCheckTopic_;
+
+    /**< Maximal long edge of the processed images, 0 for the original resolution */
+    int maxLongEdge_;
 };
 
 #endif // RAPP_HAZARD_DETECTION
@@ -0,0 +1,59 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#ifndef RAPP_IMAGE_LOADER
+#define RAPP_IMAGE_LOADER
+
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * Loads images for the hazard checks at a bounded working resolution.
+ * Whenever the decoder supports it (OpenCV 3 and newer), JPEG images are
+ * decoded directly at 1/2, 1/4 or 1/8 of their size using the DCT scaling,
+ * so the full resolution image is never materialized.
+ */
+class ImageLoader {
+public:
+  /**
+   * Load an image, limiting its longer edge.
+   * 
+   * \param fname path to the image file
+   * \param grayscale if set, the image is loaded as grayscale, otherwise as BGR
+   * \param max_long_edge maximal length of the longer image edge in pixels,
+   *        0 or negative to load the image at its original resolution
+   * \param scale if not NULL, set to the ratio of the loaded to the original
+   *        image size (1 if the image was not reduced)
+   * 
+   * \return loaded image, empty if the file can't be read
+   */
+  static cv::Mat load( const std::string & fname, bool grayscale, int max_long_edge, double * scale = NULL );
+
+  /**
+   * Read the image size from the PNG or JPEG file header, without decoding
+   * the image.
+   * 
+   * \param fname path to the image file
+   * \param size set to the image size
+   * 
+   * \return true if the size could be read
+   */
+  static bool read_size( const std::string & fname, cv::Size & size );
+};
+
+#endif /* RAPP_IMAGE_LOADER */
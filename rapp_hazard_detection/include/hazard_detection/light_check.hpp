@@ -27,6 +27,37 @@ limitations under the License.
 
 #include <opencv2/opencv.hpp>
 
+/**
+ * Parameters for light checking behaviour.
+ */
+struct LightCheckParams {
+  /// Smallest number of rows and columns of the luminance map grid.
+  static const int MIN_GRID = 3;
+
+  /// Largest number of rows and columns of the luminance map grid.
+  static const int MAX_GRID = 16;
+
+  /// Number of rows of the luminance map grid, clamped to [MIN_GRID..MAX_GRID].
+  int grid_rows;
+
+  /// Number of columns of the luminance map grid, clamped to [MIN_GRID..MAX_GRID].
+  int grid_cols;
+
+  /// Maximal length of the longer image edge, larger images are reduced on load. 0 for the original resolution.
+  int max_long_edge;
+
+  /// Debug flag. If set, additional output is produced.
+  bool debug;
+
+  /// Default constructor, 3x3 grid at the original resolution.
+  LightCheckParams() :
+    grid_rows(MIN_GRID),
+    grid_cols(MIN_GRID),
+    max_long_edge(0),
+    debug(false)
+  {}
+};
+
 /**
  * Class implementing methods related with light checking behaviour. 
  */
@@ -43,6 +74,33 @@ public:
    */
   int process( const std::string & fname, bool debug = false );
 
+  /**
+   * Check, whether the light is turned on, additionally computing the
+   * average luminance of each cell of a regular grid laid over the image.
+   * 
+   * \param fname path to the image file
+   * \param params light checking parameters
+   * \param luminance_map if not NULL, filled with the average luminance
+   *        [0..255] of each grid cell (grid_rows x grid_cols, CV_32F)
+   * 
+   * \return estimated light level [0..100], -1 if the image can't be read
+   */
+  int process( const std::string & fname, const LightCheckParams & params,
+               cv::Mat * luminance_map = NULL );
+
+  /**
+   * Check, whether the light is turned on, on an already loaded image.
+   * 
+   * \param img input image, BGR or grayscale
+   * \param params light checking parameters
+   * \param luminance_map if not NULL, filled with the average luminance
+   *        [0..255] of each grid cell (grid_rows x grid_cols, CV_32F)
+   * 
+   * \return estimated light level [0..100], -1 if the image is empty
+   */
+  int process( const cv::Mat & img, const LightCheckParams & params,
+               cv::Mat * luminance_map = NULL );
+
 protected:
   /**
    * Generate rectangle coordinates based on its center and size 
@@ -57,13 +115,15 @@ protected:
   cv::Rect centered_rect(int x, int y, int w, int h);
 
   /**
-   * Compute average light level on given (sub)image.
+   * Compute average light level on given image region in constant time.
    * 
-   * \param img input image
+   * \param integral integral image of the luminance (CV_64F), as produced
+   *        by cv::integral
+   * \param roi image region, clipped to the image
    * 
-   * \return average light level on the image
+   * \return average light level in the region
    */
-  float average_light(cv::Mat img);
+  float average_light(const cv::Mat & integral, cv::Rect roi);
 };
 
 #endif /* RAPP_LIGHT_CHECK */
@@ -0,0 +1,64 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#ifndef RAPP_HAZARD_DETECTION_LINE_BUFFER
+#define RAPP_HAZARD_DETECTION_LINE_BUFFER
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * Structure-of-arrays buffer of line segments. The properties used for
+ * scoring are computed once per segment, when the buffer is filled, and are
+ * stored in contiguous arrays, so that scoring loops read them sequentially.
+ */
+struct LineBuffer {
+  /// Segment start points.
+  std::vector<cv::Point> p1;
+
+  /// Segment end points.
+  std::vector<cv::Point> p2;
+
+  /// Absolute segment angle, in range [0, pi/2]. 0 for horizontal segments.
+  std::vector<float> abs_angle;
+
+  /// Segment angle, in range (-pi/2, pi/2], as returned by Line::getAngle.
+  std::vector<float> angle;
+
+  /// Segment length.
+  std::vector<float> length;
+
+  /// X coordinate of the segment midpoint.
+  std::vector<float> mid_x;
+
+  /**
+   * Fill the buffer with segments, as returned by cv::HoughLinesP.
+   * 
+   * \param segments line segments, (x1, y1, x2, y2) each
+   */
+  void assign( const std::vector<cv::Vec4i> & segments );
+
+  /**
+   * Get the number of segments in the buffer.
+   * 
+   * \return number of segments
+   */
+  size_t size() const { return length.size(); }
+};
+
+#endif /* RAPP_HAZARD_DETECTION_LINE_BUFFER */
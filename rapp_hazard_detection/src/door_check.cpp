@@ -19,166 +19,124 @@ limitations under the License.
 ******************************************************************************/
 
 #include <hazard_detection/door_check.hpp>
-#include <hazard_detection/Line.hpp>
+#include <hazard_detection/image_loader.hpp>
+#ifdef HAZARD_DETECTION_DEBUG
+#include <hazard_detection/door_check_debug.hpp>
+#endif
 
 
 
 int DoorCheck::process( const std::string & fname, DoorCheckParams params ) {
-  cv::Mat img = cv::imread(fname, CV_LOAD_IMAGE_GRAYSCALE);
+  double scale = 1;
+  cv::Mat img = ImageLoader::load(fname, true, params.max_long_edge, &scale);
   
   // check, whether image is properly loaded
   if (img.empty()) return -1;
+  
+  // line lengths and gaps are given for the original resolution
+  if (scale != 1) params = params.scaled(scale);
+  
+  return process(img, params);
+}
+
+int DoorCheck::process( const cv::Mat & img, DoorCheckParams params ) {
+  if (img.empty()) return -1;
 
   // adaptive thresholding - results similar to edge detection
   cv::Mat img_thr;
   cv::adaptiveThreshold(img, img_thr, 255, params.thr_method, cv::THRESH_BINARY_INV, params.thr_block, params.thr_c);
-  
-  int prop_width = img.size().width;
-  int prop_height = img.size().height;
 
   // detect line segments
   std::vector<cv::Vec4i> tmp_lines;
   cv::HoughLinesP( img_thr, tmp_lines, 1, CV_PI/180, params.hough_thr, params.hough_len, params.hough_gap);
 
-  std::vector<Line> lines;
-  for( size_t i = 0; i < tmp_lines.size(); i++ )
-  {
-    lines.push_back(Line(cv::Point(tmp_lines[i][0], tmp_lines[i][1]), cv::Point(tmp_lines[i][2], tmp_lines[i][3])));
-  }
+  LineBuffer lines;
+  lines.assign(tmp_lines);
   
   // estimate door angle
-  Line line;
-
-  std::vector<Line> lines_v, lines_h;
-
-  for (int i = 0; i < lines.size(); ++i) {
-    line = lines[i];
-
-    line.draw(img, cv::Scalar(255,255,255));
-    if (abs(line.getAngle()) < M_PI/6) {
-      lines_h.push_back(line);
-
-      line.draw(img, cv::Scalar(128)); 
-    } else
-    if (abs(line.getAngle()) > 2*M_PI/6) {
-      lines_v.push_back(line);
-    } else {
-      // skip line
-    }
-  }
-
-  std::vector<cv::Point2f> points_v, points_h;
-
-  /*for (int i = 0; i < 20; ++i) {
-    std::random_shuffle(lines_v.begin(), lines_v.end());
-  }*/
-
-  // center line - vertical door frame
-  Line * cl = NULL;
-
-  // score of center line
-  float cl_score = 0;
-
-  for (int i = 0; i < lines_v.size(); ++i) {
-    Line * tmp = &lines_v[i];
-
-    // angle score - 1 for perfectly vertical line
-    float angle_score = fabs(tmp->getAngle()) / (M_PI/2);
-    
-    // position score - 1 for centered line
-    float mean_x = (tmp->getP1().x + tmp->getP2().x) / 2;
-    float cx = 0.5 * prop_width;
-    float position_score = 1.0 - fabs(cx - mean_x) / cx;
-    
-    // length score - 1 for line at least half of image height
-    float length_score = 2 * tmp->length() / prop_height;
-    if (length_score > 1) length_score = 1;
-    
-    float tmp_score = angle_score * position_score * length_score;
-    if (tmp_score > cl_score) {
-      cl = tmp;
-      cl_score = tmp_score;
-    }
-  }
-
-  if (cl)
-    cl->draw(img, cv::Scalar(0, 0, 0));
+  DoorFrame frame = find_frame(lines, img.size());
+  float angle = frame_angle(lines, frame);
 
-  // left line - left floor/wall crossing
-  Line * ll = NULL;
+#ifdef HAZARD_DETECTION_DEBUG
+  if (params.debug)
+    DoorCheckDebug::save(img, lines, frame);
+#endif
 
-  // score of left line
-  float ll_score = 0;
+  return angle;
+}
 
-  for (int i = 0; i < lines_h.size(); ++i) {
-    Line * tmp = &lines_h[i];
-    
-    // angle score - 1 for perfectly horizontal line
-    float angle_score = (M_PI/2 - fabs(tmp->getAngle())) / (M_PI/2);
-    
-    // position score - 1 for line centered on the left part
-    float mean_x = (tmp->getP1().x + tmp->getP2().x) / 2;
-    float cx = 0.25 * prop_width;
-    float position_score = 1.0 - fabs(cx - mean_x) / cx;
-    // ignore lines laying on the right side 
-    if (mean_x > 0.5 * prop_width) position_score = 0;
+DoorFrame DoorCheck::find_frame( const LineBuffer & lines, cv::Size size ) {
+  DoorFrame frame;
+  
+  float prop_width = size.width;
+  float prop_height = size.height;
+  
+  // scores of the center line (vertical door frame) and of the left and
+  // right lines (floor/wall crossings)
+  float cl_score = 0, ll_score = 0, rl_score = 0;
+  
+  for (size_t i = 0; i < lines.size(); ++i) {
+    float abs_angle = lines.abs_angle[i];
+    float mean_x = lines.mid_x[i];
     
-    // length score - 1 for line at least half of image width
-    float length_score = 2 * tmp->length() / prop_width;
-    if (length_score > 1) length_score = 1;
+    // lines are split by abs() of their angle, as the original scoring did
+    double split_angle = abs((double) lines.angle[i]);
     
-    float tmp_score = angle_score * position_score * length_score;
-    if (tmp_score > ll_score) {
-      ll = tmp;
-      ll_score = tmp_score;
+    if (split_angle > 2*M_PI/6) {
+      // angle score - 1 for perfectly vertical line
+      float angle_score = abs_angle / (M_PI/2);
+      
+      // position score - 1 for centered line
+      float cx = 0.5 * prop_width;
+      float position_score = 1.0 - fabs(cx - mean_x) / cx;
+      
+      // length score - 1 for line at least half of image height
+      float length_score = 2 * lines.length[i] / prop_height;
+      if (length_score > 1) length_score = 1;
+      
+      float tmp_score = angle_score * position_score * length_score;
+      if (tmp_score > cl_score) {
+        frame.center = i;
+        cl_score = tmp_score;
+      }
+    } else if (split_angle < M_PI/6) {
+      // angle score - 1 for perfectly horizontal line
+      float angle_score = (M_PI/2 - abs_angle) / (M_PI/2);
+      
+      // length score - 1 for line at least half of image width
+      float length_score = 2 * lines.length[i] / prop_width;
+      if (length_score > 1) length_score = 1;
+      
+      // position score - 1 for line centered on the left part, lines
+      // laying on the right side are ignored
+      if (mean_x <= 0.5 * prop_width) {
+        float cx = 0.25 * prop_width;
+        float position_score = 1.0 - fabs(cx - mean_x) / cx;
+        float tmp_score = angle_score * position_score * length_score;
+        if (tmp_score > ll_score) {
+          frame.left = i;
+          ll_score = tmp_score;
+        }
+      }
+      
+      // position score - 1 for line centered on the right part, lines
+      // laying on the left side are ignored
+      if (mean_x >= 0.5 * prop_width) {
+        float cx = 0.75 * prop_width;
+        float position_score = 1.0 - fabs(cx - mean_x) / cx;
+        float tmp_score = angle_score * position_score * length_score;
+        if (tmp_score > rl_score) {
+          frame.right = i;
+          rl_score = tmp_score;
+        }
+      }
     }
   }
-
-  if (ll)
-    ll->draw(img, cv::Scalar(0));
-    
-  // right line - right floor/wall crossing
-  Line * rl = NULL;
-
-  // score of right line
-  float rl_score = 0;
-
-  for (int i = 0; i < lines_h.size(); ++i) {
-    Line * tmp = &lines_h[i];
-    
-    // angle score - 1 for perfectly horizontal line
-    float angle_score = (M_PI/2 - fabs(tmp->getAngle())) / (M_PI/2);
-    
-    // position score - 1 for line centered on the left part
-    float mean_x = (tmp->getP1().x + tmp->getP2().x) / 2;
-    float cx = 0.75 * prop_width;
-    float position_score = 1.0 - fabs(cx - mean_x) / cx;
-    // ignore lines laying on the left side 
-    if (mean_x < 0.5 * prop_width) position_score = 0;
   
-    // length score - 1 for line at least half of image width
-    float length_score = 2 * tmp->length() / prop_width;
-    if (length_score > 1) length_score = 1;
-    
-    float tmp_score = angle_score * position_score * length_score;
-    if (tmp_score > rl_score) {
-      rl = tmp;
-      rl_score = tmp_score;
-    }
-  }
-
-  if (rl)
-    rl->draw(img, cv::Scalar(0));
-
-  float angle = 0;
-  if (ll && rl) {
-    angle = fabs(ll->getAngle() - rl->getAngle()) * 180 / 3.1415;
-  } else {
-    angle = 90;
-  }
-
-  if (params.debug)
-    cv::imwrite("/tmp/door_out.png", img);
+  return frame;
+}
 
-  return angle;
+float DoorCheck::frame_angle( const LineBuffer & lines, const DoorFrame & frame ) {
+  if (frame.left < 0 || frame.right < 0) return 90;
+  return fabs(lines.angle[frame.left] - lines.angle[frame.right]) * 180 / 3.1415;
 }
@@ -0,0 +1,38 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <hazard_detection/door_check_debug.hpp>
+
+void DoorCheckDebug::save( const cv::Mat & img, const LineBuffer & lines, const DoorFrame & frame,
+                           const std::string & fname ) {
+  cv::Mat out = img.clone();
+  
+  // all segments white, horizontal ones gray
+  for (size_t i = 0; i < lines.size(); ++i) {
+    cv::Scalar color = lines.abs_angle[i] < M_PI/6 ? cv::Scalar(128) : cv::Scalar(255, 255, 255);
+    cv::line(out, lines.p1[i], lines.p2[i], color, 2);
+  }
+  
+  // chosen door frame lines black
+  int chosen[3] = {frame.center, frame.left, frame.right};
+  for (int i = 0; i < 3; ++i) {
+    if (chosen[i] >= 0)
+      cv::line(out, lines.p1[chosen[i]], lines.p2[chosen[i]], cv::Scalar(0), 2);
+  }
+  
+  cv::imwrite(fname, out);
+}
@@ -16,7 +16,62 @@ limitations under the License.
 ******************************************************************************/
 
 #include <hazard_detection/hazard_detection.hpp>
+#include <hazard_detection/image_loader.hpp>
 
+/**
+ * @class HazardDetection::CheckBody
+ * @brief The checks of a combined hazard check, run by cv::parallel_for_.
+ * Index 0 is the door check, index 1 the light check
+ */
+class HazardDetection::CheckBody : public cv::ParallelLoopBody
+{
+  public:
+
+    CheckBody(HazardDetection& hazard_detection, const cv::Mat& img,
+      const DoorCheckParams& door_params, const LightCheckParams& light_params,
+      int* door_angle, std::string* door_error, cv::Mat* luminance_map,
+      int* light_level, std::string* light_error) :
+      hazard_detection_(hazard_detection),
+      img_(img),
+      door_params_(door_params),
+      light_params_(light_params),
+      door_angle_(door_angle),
+      door_error_(door_error),
+      luminance_map_(luminance_map),
+      light_level_(light_level),
+      light_error_(light_error)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+      for(int i = range.start ; i < range.end ; i++)
+      {
+        if(i == 0)
+        {
+          hazard_detection_.doorCheckInto(img_, door_params_, door_angle_,
+            door_error_);
+        }
+        else
+        {
+          hazard_detection_.lightCheckInto(img_, light_params_,
+            luminance_map_, light_level_, light_error_);
+        }
+      }
+    }
+
+  private:
+
+    HazardDetection& hazard_detection_;
+    const cv::Mat& img_;
+    const DoorCheckParams& door_params_;
+    const LightCheckParams& light_params_;
+    int* door_angle_;
+    std::string* door_error_;
+    cv::Mat* luminance_map_;
+    int* light_level_;
+    std::string* light_error_;
+};
 
 HazardDetection::HazardDetection(void)
 {
@@ -39,14 +94,52 @@ HazardDetection::HazardDetection(void)
   // Creating the service server concerning the door_check functionality
   doorCheckService_ = nh_.advertiseService(doorCheckTopic_,
     &HazardDetection::doorCheckCallback, this);
+
+  // Fetching the service topic URI parameter
+  if(!nh_.getParam("/rapp_hazard_detection_hazard_check_topic", hazardCheckTopic_))
+  {
+    ROS_ERROR("Hazard check topic param does not exist");
+  }
+
+  // Creating the service server concerning the combined hazard check
+  hazardCheckService_ = nh_.advertiseService(hazardCheckTopic_,
+    &HazardDetection::hazardCheckCallback, this);
+
+  // Fetching the working resolution of the checks
+  maxLongEdge_ = 0;
+  if(!nh_.getParam("/rapp_hazard_detection_max_long_edge", maxLongEdge_))
+  {
+    ROS_WARN("Hazard detection max long edge param does not exist, using the original resolution");
+  }
 }
 
 bool HazardDetection::lightCheckCallback(
       rapp_platform_ros_communications::LightCheckRosSrv::Request& req,
       rapp_platform_ros_communications::LightCheckRosSrv::Response& res )
 {
-  int light_level = light_check.process(req.imageFilename);
+  LightCheckParams params;
+  params.max_long_edge = maxLongEdge_;
+  if(req.grid_rows > 0)
+  {
+    params.grid_rows = req.grid_rows;
+  }
+  if(req.grid_cols > 0)
+  {
+    params.grid_cols = req.grid_cols;
+  }
+
+  cv::Mat luminance_map;
+  int light_level = light_check.process(req.imageFilename, params, &luminance_map);
   res.light_level = light_level;
+  if(light_level < 0)
+  {
+    res.error = "Could not read image " + req.imageFilename;
+    return true;
+  }
+
+  res.grid_rows = luminance_map.rows;
+  res.grid_cols = luminance_map.cols;
+  res.luminance_map.assign(luminance_map.begin<float>(), luminance_map.end<float>());
   return true;
 }
 
@@ -54,7 +147,92 @@ bool HazardDetection::doorCheckCallback(
       rapp_platform_ros_communications::DoorCheckRosSrv::Request& req,
       rapp_platform_ros_communications::DoorCheckRosSrv::Response& res )
 {
-  int door_angle = door_check.process(req.imageFilename);
+  DoorCheckParams params;
+  params.max_long_edge = maxLongEdge_;
+  int door_angle = door_check.process(req.imageFilename, params);
+  res.door_angle = door_angle;
+  return true;
+}
+
+bool HazardDetection::hazardCheckCallback(
+      rapp_platform_ros_communications::HazardCheckRosSrv::Request& req,
+      rapp_platform_ros_communications::HazardCheckRosSrv::Response& res )
+{
+  // Both checks work on the luminance, so a single grayscale decode serves them
+  double scale = 1;
+  cv::Mat img = ImageLoader::load(req.imageFilename, true, maxLongEdge_, &scale);
+  if(img.empty())
+  {
+    res.light_level = -1;
+    res.door_angle = -1;
+    res.error = "Could not read image " + req.imageFilename;
+    return true;
+  }
+
+  LightCheckParams light_params;
+  if(req.grid_rows > 0)
+  {
+    light_params.grid_rows = req.grid_rows;
+  }
+  if(req.grid_cols > 0)
+  {
+    light_params.grid_cols = req.grid_cols;
+  }
+  DoorCheckParams door_params = DoorCheckParams().scaled(scale);
+
+  // Neither check modifies the image, both run concurrently on OpenCV's
+  // thread pool, which returns once both are done
+  cv::Mat luminance_map;
+  int light_level = -1;
+  int door_angle = -1;
+  std::string light_error, door_error;
+  cv::parallel_for_(cv::Range(0, 2), CheckBody(*this, img, door_params,
+    light_params, &door_angle, &door_error, &luminance_map, &light_level,
+    &light_error));
+
+  if(!door_error.empty())
+  {
+    res.error = "Door check failed: " + door_error;
+  }
+  if(!light_error.empty())
+  {
+    res.error += (res.error.empty() ? "" : "; ") +
+      std::string("Light check failed: ") + light_error;
+  }
   res.door_angle = door_angle;
+  res.light_level = light_level;
+  res.grid_rows = luminance_map.rows;
+  res.grid_cols = luminance_map.cols;
+  res.luminance_map.assign(luminance_map.begin<float>(), luminance_map.end<float>());
   return true;
 }
+
+void HazardDetection::doorCheckInto(const cv::Mat& img,
+  const DoorCheckParams& params, int* door_angle, std::string* error)
+{
+  try
+  {
+    *door_angle = door_check.process(img, params);
+  }
+  catch(cv::Exception& e)
+  {
+    *door_angle = -1;
+    *error = e.what();
+  }
+}
+
+void HazardDetection::lightCheckInto(const cv::Mat& img,
+  const LightCheckParams& params, cv::Mat* luminance_map, int* light_level,
+  std::string* error)
+{
+  try
+  {
+    *light_level = light_check.process(img, params, luminance_map);
+  }
+  catch(cv::Exception& e)
+  {
+    *light_level = -1;
+    luminance_map->release();
+    *error = e.what();
+  }
+}
@@ -0,0 +1,118 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <hazard_detection/image_loader.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+/// Read a big-endian 16-bit value.
+int read_u16( const unsigned char * p ) {
+  return (p[0] << 8) | p[1];
+}
+
+/// Read a big-endian 32-bit value.
+long read_u32( const unsigned char * p ) {
+  return ((long)p[0] << 24) | ((long)p[1] << 16) | ((long)p[2] << 8) | p[3];
+}
+
+}
+
+cv::Mat ImageLoader::load( const std::string & fname, bool grayscale, int max_long_edge, double * scale ) {
+  if (scale) *scale = 1;
+  
+  int flags = grayscale ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR;
+  if (max_long_edge <= 0) return cv::imread(fname, flags);
+  
+  cv::Size size;
+  int original_long_edge = 0;
+  if (read_size(fname, size)) {
+    original_long_edge = std::max(size.width, size.height);
+  }
+  
+  cv::Mat img;
+#if CV_MAJOR_VERSION >= 3
+  // largest decoder reduction that keeps the image above the working resolution
+  int denom = 1;
+  while (denom < 8 && original_long_edge / (denom * 2) >= max_long_edge) denom *= 2;
+  
+  if (denom == 2) {
+    img = cv::imread(fname, grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2);
+  } else if (denom == 4) {
+    img = cv::imread(fname, grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4);
+  } else if (denom == 8) {
+    img = cv::imread(fname, grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8);
+  }
+#endif
+  
+  if (img.empty()) {
+    img = cv::imread(fname, flags);
+    if (img.empty()) return img;
+    original_long_edge = std::max(img.cols, img.rows);
+  }
+  
+  // the decoder reduces by powers of two only, the rest is done here
+  int long_edge = std::max(img.cols, img.rows);
+  if (long_edge > max_long_edge) {
+    double f = (double)max_long_edge / long_edge;
+    cv::Mat reduced;
+    cv::resize(img, reduced, cv::Size(), f, f, cv::INTER_AREA);
+    img = reduced;
+  }
+  
+  if (scale && original_long_edge > 0) {
+    *scale = (double)std::max(img.cols, img.rows) / original_long_edge;
+  }
+  
+  return img;
+}
+
+bool ImageLoader::read_size( const std::string & fname, cv::Size & size ) {
+  std::ifstream file(fname.c_str(), std::ios::binary);
+  if (!file) return false;
+  
+  unsigned char buf[24];
+  if (!file.read((char*)buf, 24)) return false;
+  
+  // PNG - the IHDR chunk is always first
+  const unsigned char png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  if (std::equal(png_signature, png_signature + 8, buf)) {
+    if (!std::equal(buf + 12, buf + 16, "IHDR")) return false;
+    size = cv::Size(read_u32(buf + 16), read_u32(buf + 20));
+    return true;
+  }
+  
+  // JPEG - walk the segments up to the first start-of-frame marker
+  if (buf[0] != 0xFF || buf[1] != 0xD8) return false;
+  file.seekg(2);
+  while (file.read((char*)buf, 4)) {
+    if (buf[0] != 0xFF) return false;
+    int marker = buf[1];
+    int length = read_u16(buf + 2);
+    bool sof = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+    if (sof) {
+      if (!file.read((char*)buf, 5)) return false;
+      size = cv::Size(read_u16(buf + 3), read_u16(buf + 1));
+      return true;
+    }
+    if (length < 2) return false;
+    file.seekg(length - 2, std::ios::cur);
+  }
+  return false;
+}
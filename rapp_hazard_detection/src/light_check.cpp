@@ -19,17 +19,41 @@ limitations under the License.
 ******************************************************************************/
 
 #include <hazard_detection/light_check.hpp>
+#include <hazard_detection/image_loader.hpp>
+
+#include <algorithm>
 
 int LightCheck::process( const std::string & fname, bool debug ) {
-  cv::Mat img = cv::imread(fname);
-  
+  LightCheckParams params;
+  params.debug = debug;
+  return process(fname, params);
+}
+
+int LightCheck::process( const std::string & fname, const LightCheckParams & params, cv::Mat * luminance_map ) {
+  // only the luminance is used, thus the colour is not even decoded
+  cv::Mat img = ImageLoader::load(fname, true, params.max_long_edge);
+  return process(img, params, luminance_map);
+}
+
+int LightCheck::process( const cv::Mat & img, const LightCheckParams & params, cv::Mat * luminance_map ) {
   if (img.empty()) return -1;
   
+  // Luminance instead of the blue channel, so that coloured light sources
+  // are judged by their brightness
+  cv::Mat gray;
+  if (img.channels() == 1) {
+    gray = img;
+  } else {
+    cv::cvtColor(img, gray, CV_BGR2GRAY);
+  }
+  
+  // Every region mean below costs four lookups, whatever the region size
+  cv::Mat integral;
+  cv::integral(gray, integral, CV_64F);
+  
   std::vector<cv::Rect> rois;
   std::vector<float> values;
   
-  cv::Mat out = img.clone();
-  
   int sx = img.size().width / 4;
   int sy = img.size().height / 4;
   int ss = img.size().height / 10;
@@ -48,28 +72,15 @@ int LightCheck::process( const std::string & fname, bool debug ) {
   
   rois.push_back(centered_rect(2*sx, 2*sy, sl, sl));
   
-  char buf[256];
-  
   float vmax = 0, vmin = 255, vsum = 0;
   for (int i = 0; i < rois.size(); ++i) {
-    float val = average_light(img(rois[i]));
+    float val = average_light(integral, rois[i]);
     values.push_back(val);
     
     if (val < vmin) vmin = val;
     if (val > vmax) vmax = val;
     
     vsum += val;
-        
-    if (debug) {
-      sprintf(buf, "%6.0f", values[i]);
-      if (i < rois.size() - 1) {
-        cv::rectangle(out, rois[i], cv::Scalar(0, 0, 256), 3);
-      } else {
-        cv::rectangle(out, rois[i], cv::Scalar(256, 0, 0), 3);
-      }
-      cv::putText(out, buf, cv::Point(rois[i].x + 5, rois[i].y + rois[i].height - 5), cv::FONT_HERSHEY_PLAIN, 2, cv::Scalar(255, 255, 255));
-      std::cout << values[i] << std::endl;
-    } // if (debug)
   }
   
   float center_val = values.back();
@@ -80,15 +91,40 @@ int LightCheck::process( const std::string & fname, bool debug ) {
   if (res < 0) res = 0;
   if (res > 100) res = 100;
   
-  if (debug) {
+  int rows = std::min(std::max(params.grid_rows, (int)LightCheckParams::MIN_GRID), (int)LightCheckParams::MAX_GRID);
+  int cols = std::min(std::max(params.grid_cols, (int)LightCheckParams::MIN_GRID), (int)LightCheckParams::MAX_GRID);
+  if (luminance_map) {
+    luminance_map->create(rows, cols, CV_32F);
+    for (int r = 0; r < rows; ++r) {
+      int y0 = r * img.rows / rows;
+      int y1 = (r + 1) * img.rows / rows;
+      for (int c = 0; c < cols; ++c) {
+        int x0 = c * img.cols / cols;
+        int x1 = (c + 1) * img.cols / cols;
+        luminance_map->at<float>(r, c) = average_light(integral, cv::Rect(x0, y0, x1 - x0, y1 - y0));
+      }
+    }
+  }
+  
+  if (params.debug) {
+    cv::Mat out = img.clone();
+    char buf[256];
+    for (int i = 0; i < rois.size(); ++i) {
+      sprintf(buf, "%6.0f", values[i]);
+      if (i < rois.size() - 1) {
+        cv::rectangle(out, rois[i], cv::Scalar(0, 0, 256), 3);
+      } else {
+        cv::rectangle(out, rois[i], cv::Scalar(256, 0, 0), 3);
+      }
+      cv::putText(out, buf, cv::Point(rois[i].x + 5, rois[i].y + rois[i].height - 5), cv::FONT_HERSHEY_PLAIN, 2, cv::Scalar(255, 255, 255));
+      std::cout << values[i] << std::endl;
+    }
+    
     std::cout << "C: " << center_val << "\n";
     std::cout << "m: " << vmin << "\n";
     std::cout << "M: " << vmax << "\n";
     std::cout << "s: " << vsum << "\n";
-  }
-  
-  if (debug) {
-    out.copyTo(img);
+    
     cv::imshow("out", out);
     cv::waitKey(10000);
   }
@@ -101,6 +137,13 @@ cv::Rect LightCheck::centered_rect(int x, int y, int w, int h) {
   return cv::Rect(x-w/2, y-h/2, w, h);
 }
 
-float LightCheck::average_light(cv::Mat img) {
-  return cv::mean(img)[0];
+float LightCheck::average_light(const cv::Mat & integral, cv::Rect roi) {
+  roi &= cv::Rect(0, 0, integral.cols - 1, integral.rows - 1);
+  if (roi.area() == 0) return 0;
+  
+  double sum = integral.at<double>(roi.y + roi.height, roi.x + roi.width)
+             - integral.at<double>(roi.y, roi.x + roi.width)
+             - integral.at<double>(roi.y + roi.height, roi.x)
+             + integral.at<double>(roi.y, roi.x);
+  return sum / roi.area();
 }
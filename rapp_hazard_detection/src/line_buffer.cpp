@@ -0,0 +1,47 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <hazard_detection/line_buffer.hpp>
+
+#include <cmath>
+
+void LineBuffer::assign( const std::vector<cv::Vec4i> & segments ) {
+  size_t n = segments.size();
+  p1.resize(n);
+  p2.resize(n);
+  abs_angle.resize(n);
+  angle.resize(n);
+  length.resize(n);
+  mid_x.resize(n);
+  
+  for (size_t i = 0; i < n; ++i) {
+    const cv::Vec4i & s = segments[i];
+    p1[i] = cv::Point(s[0], s[1]);
+    p2[i] = cv::Point(s[2], s[3]);
+    
+    int dx = s[2] - s[0];
+    int dy = s[3] - s[1];
+    
+    // same convention as Line::getAngle - vertical segments have angle pi/2
+    double a = (dx == 0) ? M_PI_2 : atan(dy / (double) dx);
+    angle[i] = a;
+    abs_angle[i] = fabs(a);
+    length[i] = sqrt((double) dx * dx + (double) dy * dy);
+    // integer midpoint, as computed by the original scoring
+    mid_x[i] = (s[0] + s[2]) / 2;
+  }
+}
@@ -0,0 +1,391 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include <hazard_detection/light_check.hpp>
+#include <hazard_detection/door_check.hpp>
+#include <hazard_detection/image_loader.hpp>
+#include <hazard_detection/Line.hpp>
+#include <ros/package.h>
+
+/**
+ * @brief Returns the milliseconds elapsed since the given tick count
+ */
+double elapsedMs(int64 start)
+{
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+/**
+ * @brief Writes an upscaled copy of a sample as JPEG, to emulate the 12 MP
+ * images of newer robots
+ * @param src [const std::string&] The sample's path
+ * @param dst [const std::string&] The path of the upscaled copy
+ * @return [bool] True if the copy was written
+ */
+bool writeLarge(const std::string& src, const std::string& dst)
+{
+  cv::Mat img = cv::imread(src);
+  if(img.empty())
+  {
+    return false;
+  }
+  cv::Mat large;
+  double f = 4000.0 / std::max(img.cols, img.rows);
+  cv::resize(img, large, cv::Size(), f, f, cv::INTER_LINEAR);
+  return cv::imwrite(dst, large);
+}
+
+/**
+ * @brief The door frame line scoring as it was done before the line buffer,
+ * copied from the original DoorCheck::process without the debug drawing:
+ * the segments are copied into Line objects, which are then scanned three
+ * times, recomputing their angles, lengths and midpoints on every scan.
+ * Only the indices of the chosen lines are recorded on top of it
+ * @param tmp_lines [const std::vector<cv::Vec4i>&] The line segments
+ * @param size [cv::Size] The image size
+ * @param frame [DoorFrame*] Receives the indices of the chosen lines
+ * @return [float] The door opening angle
+ */
+float legacyFrameAngle(const std::vector<cv::Vec4i>& tmp_lines, cv::Size size,
+  DoorFrame* frame)
+{
+  int prop_width = size.width;
+  int prop_height = size.height;
+
+  std::vector<Line> lines;
+  for( size_t i = 0; i < tmp_lines.size(); i++ )
+  {
+    lines.push_back(Line(cv::Point(tmp_lines[i][0], tmp_lines[i][1]), cv::Point(tmp_lines[i][2], tmp_lines[i][3])));
+  }
+  
+  // estimate door angle
+  Line line;
+
+  std::vector<Line> lines_v, lines_h;
+  std::vector<int> index_v, index_h;
+
+  for (int i = 0; i < lines.size(); ++i) {
+    line = lines[i];
+
+    if (abs(line.getAngle()) < M_PI/6) {
+      lines_h.push_back(line);
+      index_h.push_back(i);
+    } else
+    if (abs(line.getAngle()) > 2*M_PI/6) {
+      lines_v.push_back(line);
+      index_v.push_back(i);
+    } else {
+      // skip line
+    }
+  }
+
+  std::vector<cv::Point2f> points_v, points_h;
+
+  /*for (int i = 0; i < 20; ++i) {
+    std::random_shuffle(lines_v.begin(), lines_v.end());
+  }*/
+
+  // center line - vertical door frame
+  Line * cl = NULL;
+
+  // score of center line
+  float cl_score = 0;
+
+  for (int i = 0; i < lines_v.size(); ++i) {
+    Line * tmp = &lines_v[i];
+
+    // angle score - 1 for perfectly vertical line
+    float angle_score = fabs(tmp->getAngle()) / (M_PI/2);
+    
+    // position score - 1 for centered line
+    float mean_x = (tmp->getP1().x + tmp->getP2().x) / 2;
+    float cx = 0.5 * prop_width;
+    float position_score = 1.0 - fabs(cx - mean_x) / cx;
+    
+    // length score - 1 for line at least half of image height
+    float length_score = 2 * tmp->length() / prop_height;
+    if (length_score > 1) length_score = 1;
+    
+    float tmp_score = angle_score * position_score * length_score;
+    if (tmp_score > cl_score) {
+      cl = tmp;
+      cl_score = tmp_score;
+      frame->center = index_v[i];
+    }
+  }
+
+  // left line - left floor/wall crossing
+  Line * ll = NULL;
+
+  // score of left line
+  float ll_score = 0;
+
+  for (int i = 0; i < lines_h.size(); ++i) {
+    Line * tmp = &lines_h[i];
+    
+    // angle score - 1 for perfectly horizontal line
+    float angle_score = (M_PI/2 - fabs(tmp->getAngle())) / (M_PI/2);
+    
+    // position score - 1 for line centered on the left part
+    float mean_x = (tmp->getP1().x + tmp->getP2().x) / 2;
+    float cx = 0.25 * prop_width;
+    float position_score = 1.0 - fabs(cx - mean_x) / cx;
+    // ignore lines laying on the right side 
+    if (mean_x > 0.5 * prop_width) position_score = 0;
+    
+    // length score - 1 for line at least half of image width
+    float length_score = 2 * tmp->length() / prop_width;
+    if (length_score > 1) length_score = 1;
+    
+    float tmp_score = angle_score * position_score * length_score;
+    if (tmp_score > ll_score) {
+      ll = tmp;
+      ll_score = tmp_score;
+      frame->left = index_h[i];
+    }
+  }
+
+  // right line - right floor/wall crossing
+  Line * rl = NULL;
+
+  // score of right line
+  float rl_score = 0;
+
+  for (int i = 0; i < lines_h.size(); ++i) {
+    Line * tmp = &lines_h[i];
+    
+    // angle score - 1 for perfectly horizontal line
+    float angle_score = (M_PI/2 - fabs(tmp->getAngle())) / (M_PI/2);
+    
+    // position score - 1 for line centered on the left part
+    float mean_x = (tmp->getP1().x + tmp->getP2().x) / 2;
+    float cx = 0.75 * prop_width;
+    float position_score = 1.0 - fabs(cx - mean_x) / cx;
+    // ignore lines laying on the left side 
+    if (mean_x < 0.5 * prop_width) position_score = 0;
+  
+    // length score - 1 for line at least half of image width
+    float length_score = 2 * tmp->length() / prop_width;
+    if (length_score > 1) length_score = 1;
+    
+    float tmp_score = angle_score * position_score * length_score;
+    if (tmp_score > rl_score) {
+      rl = tmp;
+      rl_score = tmp_score;
+      frame->right = index_h[i];
+    }
+  }
+
+  float angle = 0;
+  if (ll && rl) {
+    angle = fabs(ll->getAngle() - rl->getAngle()) * 180 / 3.1415;
+  } else {
+    angle = 90;
+  }
+
+  return angle;
+}
+
+/**
+ * @brief Checks that the single pass over the line buffer chooses the same
+ * door frame lines as the legacy scoring, and the same door angle. The
+ * angles are computed from the same segments, the buffer holds them in
+ * single precision, thus they may differ by float rounding only
+ * @param segments [const std::vector<cv::Vec4i>&] The line segments
+ * @param size [cv::Size] The image size
+ * @return [bool] True if both choose the same lines and angle
+ */
+bool sameFrame(const std::vector<cv::Vec4i>& segments, cv::Size size)
+{
+  DoorCheck door_check;
+  DoorFrame legacy_frame;
+  float legacy_angle = legacyFrameAngle(segments, size, &legacy_frame);
+  LineBuffer lines;
+  lines.assign(segments);
+  DoorFrame frame = door_check.find_frame(lines, size);
+  float angle = door_check.frame_angle(lines, frame);
+  return frame.center == legacy_frame.center &&
+    frame.left == legacy_frame.left && frame.right == legacy_frame.right &&
+    fabs(angle - legacy_angle) <= 1e-3;
+}
+
+/**
+ * @brief Detects the line segments of a door sample, as DoorCheck::process
+ * does with the default parameters
+ * @param fname [const std::string&] The sample's path
+ * @param size [cv::Size*] Receives the image size
+ * @return [std::vector<cv::Vec4i>] The line segments
+ */
+std::vector<cv::Vec4i> doorSegments(const std::string& fname, cv::Size* size)
+{
+  DoorCheckParams params;
+  cv::Mat img = ImageLoader::load(fname, true, 0, NULL);
+  std::vector<cv::Vec4i> segments;
+  *size = img.size();
+  if(img.empty())
+  {
+    return segments;
+  }
+  cv::Mat img_thr;
+  cv::adaptiveThreshold(img, img_thr, 255, params.thr_method,
+    cv::THRESH_BINARY_INV, params.thr_block, params.thr_c);
+  cv::HoughLinesP(img_thr, segments, 1, CV_PI/180, params.hough_thr,
+    params.hough_len, params.hough_gap);
+  return segments;
+}
+
+/**
+ * @brief Compares the legacy door frame line scoring against the single pass
+ * over the line buffer, on random segments such as those Hough produces on
+ * cluttered scenes
+ * @param count [int] The number of segments
+ * @param iterations [int] The number of timed runs
+ * @return [bool] True if both chose the same lines and angle
+ */
+bool benchmarkLineScoring(int count, int iterations)
+{
+  cv::Size size(1280, 960);
+  cv::RNG rng(count);
+  std::vector<cv::Vec4i> segments(count);
+  for(int i = 0 ; i < count ; i++)
+  {
+    int x = rng.uniform(0, size.width), y = rng.uniform(0, size.height);
+    int len = rng.uniform(30, 400);
+    double a = rng.uniform(-CV_PI / 2, CV_PI / 2);
+    segments[i] = cv::Vec4i(x, y, x + cvRound(len * cos(a)),
+      y + cvRound(len * sin(a)));
+  }
+
+  DoorCheck door_check;
+  double legacy_ms = 0, fused_ms = 0;
+  for(int i = 0 ; i < iterations ; i++)
+  {
+    DoorFrame legacy_frame;
+    int64 start = cv::getTickCount();
+    legacyFrameAngle(segments, size, &legacy_frame);
+    legacy_ms += elapsedMs(start);
+
+    start = cv::getTickCount();
+    LineBuffer lines;
+    lines.assign(segments);
+    door_check.frame_angle(lines, door_check.find_frame(lines, size));
+    fused_ms += elapsedMs(start);
+  }
+  bool same = sameFrame(segments, size);
+  printf("%6d segments  legacy %8.3f ms  single pass %8.3f ms  %s\n", count,
+    legacy_ms / iterations, fused_ms / iterations,
+    same ? "identical" : "MISMATCH");
+  return same;
+}
+
+/**
+ * @brief Compares the decode+process latency of the hazard checks at the
+ * original resolution against a reduced working resolution, on a lamp and a
+ * door sample upscaled to 12 MP, then the door frame line scoring on
+ * thousands of segments. Fails if the single pass over the line buffer
+ * chooses other door frame lines than the legacy scoring, on the segments of
+ * a door sample or on the random ones.
+ * Usage: hazard_detection_benchmark [iterations] [max_long_edge]
+ */
+int main(int argc, char **argv)
+{
+  int iterations = 10;
+  int max_long_edge = 640;
+  if(argc > 1)
+  {
+    iterations = atoi(argv[1]);
+  }
+  if(argc > 2)
+  {
+    max_long_edge = atoi(argv[2]);
+  }
+
+  std::string path = ros::package::getPath("rapp_testing_tools") +
+    std::string("/test_data/hazard_detection_samples/");
+  std::string lamp = "/tmp/hazard_benchmark_lamp.jpg";
+  std::string door = "/tmp/hazard_benchmark_door.jpg";
+  if(!writeLarge(path + "lamp_on.jpg", lamp) ||
+    !writeLarge(path + "door_2.png", door))
+  {
+    printf("Could not prepare the samples\n");
+    return 1;
+  }
+
+  LightCheck light_check;
+  DoorCheck door_check;
+  LightCheckParams light_params[2];
+  DoorCheckParams door_params[2];
+  light_params[1].max_long_edge = max_long_edge;
+  door_params[1].max_long_edge = max_long_edge;
+
+  double light_ms[2] = {0, 0}, door_ms[2] = {0, 0};
+  int light_level[2] = {0, 0}, door_angle[2] = {0, 0};
+  for(int i = 0 ; i < iterations ; i++)
+  {
+    for(int m = 0 ; m < 2 ; m++)
+    {
+      int64 start = cv::getTickCount();
+      light_level[m] = light_check.process(lamp, light_params[m]);
+      light_ms[m] += elapsedMs(start);
+
+      start = cv::getTickCount();
+      door_angle[m] = door_check.process(door, door_params[m]);
+      door_ms[m] += elapsedMs(start);
+    }
+  }
+
+  printf("Iterations: %d, 4000x3000 JPEG input\n", iterations);
+  printf("Light check, original:        %8.2f ms  level %d\n",
+    light_ms[0] / iterations, light_level[0]);
+  printf("Light check, long edge %4d:  %8.2f ms  level %d\n", max_long_edge,
+    light_ms[1] / iterations, light_level[1]);
+  printf("Door check, original:         %8.2f ms  angle %d\n",
+    door_ms[0] / iterations, door_angle[0]);
+  printf("Door check, long edge %4d:   %8.2f ms  angle %d\n", max_long_edge,
+    door_ms[1] / iterations, door_angle[1]);
+
+  bool same = true;
+  printf("\nDoor frame lines of the samples:\n");
+  const char* samples[] = {"door_1.png", "door_2.png", "door_3.png",
+    "door_4.png"};
+  for(int i = 0 ; i < 4 ; i++)
+  {
+    cv::Size size;
+    std::vector<cv::Vec4i> segments = doorSegments(path + samples[i], &size);
+    bool sample_same = sameFrame(segments, size);
+    printf("%s  %6d segments  %s\n", samples[i], (int)segments.size(),
+      sample_same ? "identical" : "MISMATCH");
+    same = same && sample_same;
+  }
+
+  printf("\nDoor frame line scoring:\n");
+  same = benchmarkLineScoring(100, iterations * 10) && same;
+  same = benchmarkLineScoring(1000, iterations * 10) && same;
+  same = benchmarkLineScoring(5000, iterations * 10) && same;
+  same = benchmarkLineScoring(20000, iterations * 10) && same;
+  if(!same)
+  {
+    printf("The single pass chose other door frame lines than the legacy "
+      "scoring\n");
+    return 1;
+  }
+  return 0;
+}
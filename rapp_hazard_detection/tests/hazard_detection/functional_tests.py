@@ -27,7 +27,9 @@ from rapp_platform_ros_communications.srv import (
   LightCheckRosSrv,
   LightCheckRosSrvRequest,
   DoorCheckRosSrv,
-  DoorCheckRosSrvRequest
+  DoorCheckRosSrvRequest,
+  HazardCheckRosSrv,
+  HazardCheckRosSrvRequest
   )
 
 
@@ -167,6 +169,35 @@ class HazardDetectionFunc(unittest.TestCase):
         door_angle = response.door_angle
         self.assertEqual( door_angle, -1 )
 
+    ## Tests the combined hazard check with door opened
+    def test_hazardCheck(self):
+        rospack = rospkg.RosPack()
+        hazard_service = rospy.get_param("rapp_hazard_detection_hazard_check_topic")
+        rospy.wait_for_service(hazard_service)
+        hc_service = rospy.ServiceProxy(hazard_service, HazardCheckRosSrv)
+        req = HazardCheckRosSrvRequest()
+        req.imageFilename = rospack.get_path('rapp_testing_tools') + \
+                '/test_data/hazard_detection_samples/door_2.png'
+        req.grid_rows = 4
+        req.grid_cols = 4
+        response = hc_service(req)
+        self.assertGreater( response.door_angle, 1 )
+        self.assertGreaterEqual( response.light_level, 0 )
+        self.assertEqual( len(response.luminance_map), 16 )
+
+    ## Tests the combined hazard check with a non existent image. Should return -1
+    def test_hazard_fileDoesNotExist(self):
+        rospack = rospkg.RosPack()
+        hazard_service = rospy.get_param("rapp_hazard_detection_hazard_check_topic")
+        rospy.wait_for_service(hazard_service)
+        hc_service = rospy.ServiceProxy(hazard_service, HazardCheckRosSrv)
+        req = HazardCheckRosSrvRequest()
+        req.imageFilename = rospack.get_path('rapp_testing_tools') + \
+                '/test_data/not_existent_file.jpg'
+        response = hc_service(req)
+        self.assertEqual( response.light_level, -1 )
+        self.assertEqual( response.door_angle, -1 )
+
 
 ## The main function. Initializes the functional tests
 if __name__ == '__main__':
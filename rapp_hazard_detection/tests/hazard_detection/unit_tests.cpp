@@ -19,6 +19,7 @@ limitations under the License.
 
 #include <hazard_detection/light_check.hpp>
 #include <hazard_detection/door_check.hpp>
+#include <hazard_detection/image_loader.hpp>
 #include <ros/package.h>
 
 /**
@@ -91,6 +92,78 @@ TEST_F(LightCheckTest, test_size)
   EXPECT_EQ(light_level_1, light_level_2);
 }
 
+/**
+ * @brief Tests the luminance map size, including the clamping of the grid
+ */
+TEST_F(LightCheckTest, luminance_map_size_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/hazard_detection_samples/lamp_on.jpg");
+  LightCheckParams params;
+  cv::Mat luminance_map;
+  light_check_->process(s, params, &luminance_map);
+  EXPECT_EQ(3, luminance_map.rows);
+  EXPECT_EQ(3, luminance_map.cols);
+
+  params.grid_rows = 16;
+  params.grid_cols = 4;
+  light_check_->process(s, params, &luminance_map);
+  EXPECT_EQ(16, luminance_map.rows);
+  EXPECT_EQ(4, luminance_map.cols);
+
+  params.grid_rows = 1;
+  params.grid_cols = 100;
+  light_check_->process(s, params, &luminance_map);
+  EXPECT_EQ(LightCheckParams::MIN_GRID, luminance_map.rows);
+  EXPECT_EQ(LightCheckParams::MAX_GRID, luminance_map.cols);
+}
+
+/**
+ * @brief Tests that the luminance map cells match the directly computed means
+ */
+TEST_F(LightCheckTest, luminance_map_values_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/hazard_detection_samples/lamp_on.jpg");
+  cv::Mat img = cv::imread(s);
+  ASSERT_FALSE(img.empty());
+  cv::Mat gray;
+  cv::cvtColor(img, gray, CV_BGR2GRAY);
+
+  LightCheckParams params;
+  params.grid_rows = 4;
+  params.grid_cols = 5;
+  cv::Mat luminance_map;
+  int light_level = light_check_->process(img, params, &luminance_map);
+  EXPECT_EQ(light_check_->process(s), light_level);
+
+  for (int r = 0; r < 4; ++r) {
+    for (int c = 0; c < 5; ++c) {
+      cv::Rect cell(c * img.cols / 5, r * img.rows / 4,
+        (c + 1) * img.cols / 5 - c * img.cols / 5,
+        (r + 1) * img.rows / 4 - r * img.rows / 4);
+      EXPECT_NEAR(cv::mean(gray(cell))[0], luminance_map.at<float>(r, c), 0.01);
+    }
+  }
+}
+
+/**
+ * @brief Tests light detection at a reduced working resolution
+ */
+TEST_F(LightCheckTest, reduced_resolution_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  LightCheckParams params;
+  params.max_long_edge = 320;
+  int light_on = light_check_->process(path +
+    std::string("/test_data/hazard_detection_samples/lamp_on.jpg"), params);
+  int light_off = light_check_->process(path +
+    std::string("/test_data/hazard_detection_samples/lamp_off.jpg"), params);
+  EXPECT_GT(light_on, 50);
+  EXPECT_LT(light_off, 50);
+  EXPECT_GE(light_off, 0);
+}
+
 /**
  * @brief Tests light detection with a missing file. Should return 0
  */
@@ -161,6 +234,114 @@ TEST_F(DoorCheckTest, door_open_test)
   EXPECT_GT(door_angle, 1);
 }
 
+/**
+ * @brief Tests door angle detection at a reduced working resolution
+ */
+TEST_F(DoorCheckTest, reduced_resolution_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/hazard_detection_samples/door_1.png");
+  DoorCheckParams params;
+  params.max_long_edge = 320;
+  int door_angle = door_check_->process(s, params);
+  EXPECT_GT(door_angle, 1);
+}
+
+/**
+ * @brief Tests that the door angle detection leaves a shared image untouched
+ */
+TEST_F(DoorCheckTest, shared_image_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/hazard_detection_samples/door_1.png");
+  cv::Mat img = cv::imread(s, CV_LOAD_IMAGE_GRAYSCALE);
+  ASSERT_FALSE(img.empty());
+  cv::Mat copy = img.clone();
+  EXPECT_EQ(door_check_->process(s), door_check_->process(img));
+  EXPECT_EQ(0, cv::norm(img, copy, cv::NORM_INF));
+}
+
+/**
+ * @brief Tests choosing the door frame lines among synthetic segments
+ */
+TEST_F(DoorCheckTest, find_frame_test)
+{
+  std::vector<cv::Vec4i> segments;
+  segments.push_back(cv::Vec4i(100, 50, 140, 300));  // off-center vertical
+  segments.push_back(cv::Vec4i(320, 20, 320, 400));  // door frame
+  segments.push_back(cv::Vec4i(40, 420, 280, 420));  // left crossing
+  segments.push_back(cv::Vec4i(360, 420, 600, 380)); // right crossing
+  segments.push_back(cv::Vec4i(560, 100, 600, 100)); // short, right side
+  LineBuffer lines;
+  lines.assign(segments);
+
+  DoorFrame frame = door_check_->find_frame(lines, cv::Size(640, 480));
+  EXPECT_EQ(2, frame.left);
+  EXPECT_EQ(3, frame.right);
+  EXPECT_EQ(9, (int)door_check_->frame_angle(lines, frame));
+
+  lines.assign(std::vector<cv::Vec4i>(1, segments[1]));
+  frame = door_check_->find_frame(lines, cv::Size(640, 480));
+  EXPECT_EQ(-1, frame.left);
+  EXPECT_EQ(90, (int)door_check_->frame_angle(lines, frame));
+}
+
+/**
+ * @brief Tests the scaling of the door check parameters
+ */
+TEST(DoorCheckParamsTest, scaled_test)
+{
+  DoorCheckParams params;
+  params.thr_block = 7;
+  DoorCheckParams half = params.scaled(0.5);
+  EXPECT_EQ(30, half.hough_len);
+  EXPECT_EQ(10, half.hough_gap);
+  EXPECT_EQ(40, half.hough_thr);
+  EXPECT_EQ(5, half.thr_block);
+
+  DoorCheckParams tiny = params.scaled(0.01);
+  EXPECT_EQ(3, tiny.thr_block);
+  EXPECT_GE(tiny.hough_thr, 1);
+}
+
+/**
+ * @brief Tests reading the image size from the file headers
+ */
+TEST(ImageLoaderTest, read_size_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools") +
+    std::string("/test_data/hazard_detection_samples/");
+  cv::Size size;
+  ASSERT_TRUE(ImageLoader::read_size(path + "lamp_on.jpg", size));
+  EXPECT_EQ(1280, size.width);
+  EXPECT_EQ(960, size.height);
+  ASSERT_TRUE(ImageLoader::read_size(path + "door_1.png", size));
+  EXPECT_EQ(585, size.width);
+  EXPECT_EQ(439, size.height);
+  EXPECT_FALSE(ImageLoader::read_size(path + "not_existent_file.jpg", size));
+}
+
+/**
+ * @brief Tests loading an image at a reduced resolution
+ */
+TEST(ImageLoaderTest, load_reduced_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools") +
+    std::string("/test_data/hazard_detection_samples/");
+  double scale = 0;
+  cv::Mat img = ImageLoader::load(path + "lamp_on.jpg", true, 320, &scale);
+  ASSERT_FALSE(img.empty());
+  EXPECT_EQ(1, img.channels());
+  EXPECT_EQ(320, img.cols);
+  EXPECT_EQ(240, img.rows);
+  EXPECT_DOUBLE_EQ(0.25, scale);
+
+  img = ImageLoader::load(path + "door_1.png", false, 0, &scale);
+  EXPECT_EQ(585, img.cols);
+  EXPECT_EQ(3, img.channels());
+  EXPECT_DOUBLE_EQ(1, scale);
+}
+
 /**
  * @brief The main function. Initialized the unit tests
  */
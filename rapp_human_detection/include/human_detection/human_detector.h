@@ -27,6 +27,29 @@ limitations under the License.
 #include <opencv2/ml/ml.hpp> // for the svm algorithm
 #include "opencv2/objdetect/objdetect.hpp" // for HOGDescriptor
 
+#include <boost/thread/tss.hpp>
+
+/**
+ * @struct HumanDetectionTimings
+ * @brief Time spent in each stage of a human detection, in milliseconds
+ */
+struct HumanDetectionTimings
+{
+  HumanDetectionTimings(void) :
+    load(0), hog(0), haar(0), grouping(0)
+  {
+  }
+
+  /**< Image loading, preprocessing and first use construction of the models */
+  double load;
+  /**< HOG pedestrian detection, including the refinement */
+  double hog;
+  /**< Haar upper body detection and verification */
+  double haar;
+  /**< Merging of the two sets of humans and mapping to the image coordinates */
+  double grouping;
+};
+
 /**
  * @class HumanDetector
  * @brief Class that implements a human detection algorithm based on
@@ -51,30 +74,100 @@ class HumanDetector
     /**
      * @brief   Finds humans in an image retrieved from a file URL
      * @param   file_name [std::string] The image file's URL
+     * @param   fast [bool] True for fast detection -- coarse HOG only
+     * @param   timings [HumanDetectionTimings*] If not NULL, receives the
+     *          time spent in each stage
      * @return  [std::vector<cv::Rect>] A vector containing the detected humans.
      *          Each human is represented by a rectangle.
      */
-    std::vector<cv::Rect> findHuman2D(std::string file_name);
+    std::vector<cv::Rect> findHuman2D(std::string file_name, bool fast = false,
+      HumanDetectionTimings* timings = NULL);
 
     /**
      * @brief   Detects humans from a cv::Mat
      * @param   input_img [const cv::Mat&] The input image
+     * @param   fast [bool] True for fast detection -- coarse HOG only
+     * @param   timings [HumanDetectionTimings*] If not NULL, receives the
+     *          time spent in each stage
      * @return  [std::vector<cv::Rect>] A vector containing the detected humans.
      *          Each human is represented by a rectangle.
      */
-    std::vector<cv::Rect> detectHuman2D(const cv::Mat& input_img);
+    std::vector<cv::Rect> detectHuman2D(const cv::Mat& input_img,
+      bool fast = false, HumanDetectionTimings* timings = NULL);
+
+    /**
+     * @brief   Sets the resolution the detection runs at. Images with a longer
+     *          edge are downscaled before the detection and the humans are mapped
+     *          back to the original coordinates.
+     * @param   max_long_edge [int] The maximum long edge in pixels, 0 or
+     *          negative to always detect at the original resolution
+     * @param   refine [bool] True to refine every human found in a downscaled
+     *          image on the original resolution
+     */
+    void setDetectionResolution(int max_long_edge, bool refine = false);
 
   private:
 
+    /**< The upper body Haar training model path */
+    static const std::string UPPERBODY_CASCADE_PATH;
+
+    /**< The HOG pedestrian detector of each thread, built on first use */
+    boost::thread_specific_ptr<cv::HOGDescriptor> hog_;
+
+    /**< The upper body classifier of each thread, loaded on first use */
+    boost::thread_specific_ptr<cv::CascadeClassifier> upperbody_cascade_;
+
+    /**
+     * @brief   Returns the calling thread's HOG pedestrian detector,
+     *          building it on the first call
+     * @return  [cv::HOGDescriptor&] The detector
+     */
+    cv::HOGDescriptor& hog(void);
+
+    /**
+     * @brief   Returns the calling thread's upper body classifier, loading
+     *          it on the first call
+     * @return  [cv::CascadeClassifier&] The classifier. Empty if the cascade
+     *          could not be loaded.
+     */
+    cv::CascadeClassifier& upperbodyCascade(void);
+
+    /**< The maximum long edge of the scanned image, 0 for no downscaling */
+    int max_long_edge_;
+
+    /**< True to refine the humans found in a downscaled image */
+    bool refine_;
+
+    /**
+     * @brief   Computes the factor an image is scaled by before the detection
+     * @param   size [const cv::Size&] The image's size
+     * @return  [double] The scale factor, 1 if the image is scanned as is
+     */
+    double detectionScale(const cv::Size& size) const;
+
+    /**
+     * @brief   Refines a human found at a reduced resolution, by running the
+     *          HOG pedestrian detector on the full resolution region around it
+     * @param   grayscale_img [const cv::Mat&] The full resolution equalized
+     *          grayscale image
+     * @param   human [const cv::Rect&] The human, in full resolution coordinates
+     * @param   hog [const cv::HOGDescriptor&] The pedestrian detector
+     * @return  [cv::Rect] The refined human. The input human if the detector
+     *          did not confirm it.
+     */
+    cv::Rect refineHuman(const cv::Mat& grayscale_img, const cv::Rect& human,
+      const cv::HOGDescriptor& hog);
+
     /**
      * @brief   Detects humans from a cv::Mat
      * @param   input_img [const cv::Mat&] The input image
-     * @param   haar_path [const std::string] The Haar training model path
+     * @param   human_cascade [cv::CascadeClassifier&] The Haar classifier
+     * @param   scale [double] The factor the image was downscaled by
      * @return  [std::vector<cv::Rect>] A vector containing the detected humans.
      *          Each human is represented by a rectangle.
      */
     std::vector<cv::Rect> detectHuman2D(const cv::Mat& input_img,
-      const std::string& haar_path);
+      cv::CascadeClassifier& human_cascade, double scale = 1.0);
 
     /**
      * @brief   Identify unique humans from two sets of humans
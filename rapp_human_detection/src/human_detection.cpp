@@ -31,6 +31,19 @@ HumanDetection::HumanDetection(void)
   // Creating the service server concerning the human detection functionality
   humanDetectionService_ = nh_.advertiseService(humanDetectionTopic_,
     &HumanDetection::humanDetectionCallback, this);
+
+  // Large images are scanned at a reduced resolution
+  int max_long_edge = 0;
+  bool refine = false;
+  if(!nh_.getParam("/rapp_human_detection_max_long_edge", max_long_edge))
+  {
+    ROS_WARN("Human detection max long edge param not found, not downscaling");
+  }
+  if(!nh_.getParam("/rapp_human_detection_refine", refine))
+  {
+    ROS_WARN("Human detection refine param not found, not refining");
+  }
+  human_detector_.setDetectionResolution(max_long_edge, refine);
 }
 
 /**
@@ -44,7 +57,12 @@ bool HumanDetection::humanDetectionCallback(
   rapp_platform_ros_communications::HumanDetectionRosSrv::Response& res)
 {
   std::vector<unsigned int [4]> history;
-  std::vector<cv::Rect> humans = human_detector_.findHuman2D(req.imageFilename); // run detectHuman2D
+  HumanDetectionTimings timings;
+  std::vector<cv::Rect> humans = human_detector_.findHuman2D(req.imageFilename,
+    req.fast, &timings); // run detectHuman2D
+  ROS_DEBUG("Human detection timings [ms]: load %.2f, HOG %.2f, Haar %.2f, "
+    "grouping %.2f", timings.load, timings.hog, timings.haar,
+    timings.grouping);
   for(unsigned int i = 0 ; i < humans.size() ; i++)
   {
 
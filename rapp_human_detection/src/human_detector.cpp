@@ -17,11 +17,77 @@ limitations under the License.
 
 #include <human_detection/human_detector.h>
 
+#include <algorithm>
+
+/**< The upper body Haar training model */
+const std::string HumanDetector::UPPERBODY_CASCADE_PATH =
+  "/usr/share/opencv/haarcascades/haarcascade_upperbody.xml";
+
+/**
+ * @brief   Returns the milliseconds elapsed since the given tick count
+ * @param   start [int64] The tick count
+ * @return  [double] The elapsed milliseconds
+ */
+static double elapsedMs(int64 start)
+{
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
 /** 
  * @brief Default constructor
  */
-HumanDetector::HumanDetector(void)
+HumanDetector::HumanDetector(void) :
+  max_long_edge_(0),
+  refine_(false)
+{
+}
+
+/**
+ * @brief   Sets the resolution the detection runs at. Images with a longer
+ *          edge are downscaled before the detection and the humans are mapped
+ *          back to the original coordinates.
+ * @param   max_long_edge [int] The maximum long edge in pixels, 0 or
+ *          negative to always detect at the original resolution
+ * @param   refine [bool] True to refine every human found in a downscaled
+ *          image on the original resolution
+ */
+void HumanDetector::setDetectionResolution(int max_long_edge, bool refine)
+{
+  max_long_edge_ = max_long_edge;
+  refine_ = refine;
+}
+
+/**
+ * @brief   Returns the calling thread's HOG pedestrian detector,
+ *          building it on the first call
+ * @return  [cv::HOGDescriptor&] The detector
+ */
+cv::HOGDescriptor& HumanDetector::hog(void)
+{
+  // Copying the default people detector into the descriptor is costly, thus
+  // it happens once per serving thread instead of once per request
+  if(hog_.get() == NULL)
+  {
+    hog_.reset(new cv::HOGDescriptor);
+    hog_->setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+  }
+  return *hog_;
+}
+
+/**
+ * @brief   Returns the calling thread's upper body classifier, loading
+ *          it on the first call
+ * @return  [cv::CascadeClassifier&] The classifier. Empty if the cascade
+ *          could not be loaded.
+ */
+cv::CascadeClassifier& HumanDetector::upperbodyCascade(void)
 {
+  if(upperbody_cascade_.get() == NULL)
+  {
+    upperbody_cascade_.reset(new cv::CascadeClassifier);
+    upperbody_cascade_->load(UPPERBODY_CASCADE_PATH);
+  }
+  return *upperbody_cascade_;
 }
 
 /**
@@ -40,57 +106,197 @@ cv::Mat HumanDetector::loadImage(std::string file_name)
 /**
  * @brief   Detects humans from a cv::Mat
  * @param   input_img [const cv::Mat&] The input image
+ * @param   fast [bool] True for fast detection -- coarse HOG only
+ * @param   timings [HumanDetectionTimings*] If not NULL, receives the
+ *          time spent in each stage
  * @return  [std::vector<cv::Rect>] A vector containing the detected humans.
  *          Each human is represented by a rectangle.
  */
-std::vector<cv::Rect> HumanDetector::detectHuman2D(const cv::Mat& input_img)
+std::vector<cv::Rect> HumanDetector::detectHuman2D(const cv::Mat& input_img,
+  bool fast, HumanDetectionTimings* timings)
 {
+  HumanDetectionTimings local_timings;
+  if(timings == NULL)
+  {
+    timings = &local_timings;
+  }
+
   std::vector<cv::Rect> pedestrian, upperbody, final_humans;
-  cv::Mat grayscale_img;
+  cv::Mat grayscale_img, detection_img;
   if( input_img.empty() )
   {
     return final_humans;
   }
+  int64 start = cv::getTickCount();
   cv::cvtColor(input_img, grayscale_img, CV_BGR2GRAY);
-  cv::equalizeHist(grayscale_img, grayscale_img);
-
-  // Detect Pedestrians
-  //std::vector<cv::Rect> found, found_filtered;
-  cv::HOGDescriptor hog;
-  hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
-  hog.detectMultiScale(grayscale_img, pedestrian, 0, cv::Size(8, 8), cv::Size(32, 32), 1.05, 2);
-  
-  // Detect Human Upperbody
-  std::string haar_file_path = "/usr/share/opencv/haarcascades/haarcascade_upperbody.xml";
-  upperbody = detectHuman2D( grayscale_img, haar_file_path );
-  
+
+  // Large images are scanned at a reduced resolution
+  double scale = detectionScale(grayscale_img.size());
+  if(scale < 1.0)
+  {
+    cv::resize(grayscale_img, detection_img, cv::Size(), scale, scale,
+      cv::INTER_AREA);
+  }
+  else
+  {
+    detection_img = grayscale_img;
+  }
+  cv::equalizeHist(detection_img, detection_img);
+
+  // The models are built on their first use by this thread
+  const cv::HOGDescriptor& pedestrian_hog = hog();
+  timings->load += elapsedMs(start);
+
+  if(fast)
+  {
+    // A single coarse HOG scan: a bigger scale step and no padding. The
+    // window stride stays at one cell, a stride of two cells misses most
+    // pedestrians. The HOG grouping is the only filtering, there is no
+    // upper body detection and no verification.
+    start = cv::getTickCount();
+    pedestrian_hog.detectMultiScale(detection_img, pedestrian, 0,
+      cv::Size(8, 8), cv::Size(0, 0), 1.1, 2);
+    timings->hog += elapsedMs(start);
+  }
+  else
+  {
+    start = cv::getTickCount();
+    cv::CascadeClassifier& human_cascade = upperbodyCascade();
+    timings->load += elapsedMs(start);
+
+    // Detect Pedestrians
+    start = cv::getTickCount();
+    pedestrian_hog.detectMultiScale(detection_img, pedestrian, 0, cv::Size(8, 8), cv::Size(32, 32), 1.05, 2);
+    timings->hog += elapsedMs(start);
+
+    // Detect Human Upperbody
+    start = cv::getTickCount();
+    if(!human_cascade.empty())
+    {
+      upperbody = detectHuman2D( detection_img, human_cascade, scale );
+    }
+    timings->haar += elapsedMs(start);
+  }
+
   // Identify unique humans
-  final_humans = identifyUniqueHumans( pedestrian, upperbody );
+  start = cv::getTickCount();
+  if(fast)
+  {
+    final_humans = pedestrian;
+  }
+  else
+  {
+    final_humans = identifyUniqueHumans( pedestrian, upperbody );
+  }
+  if(scale >= 1.0)
+  {
+    timings->grouping += elapsedMs(start);
+    return final_humans;
+  }
 
+  // Map the humans back to the original image's coordinates
+  for(unsigned int i = 0 ; i < final_humans.size() ; i++)
+  {
+    final_humans[i] = cv::Rect(
+      cvRound(final_humans[i].x / scale),
+      cvRound(final_humans[i].y / scale),
+      cvRound(final_humans[i].width / scale),
+      cvRound(final_humans[i].height / scale)) &
+      cv::Rect(0, 0, grayscale_img.cols, grayscale_img.rows);
+  }
+  timings->grouping += elapsedMs(start);
+
+  // The refinement is part of the accurate detection only
+  if(refine_ && !fast)
+  {
+    start = cv::getTickCount();
+    cv::equalizeHist(grayscale_img, grayscale_img);
+    for(unsigned int i = 0 ; i < final_humans.size() ; i++)
+    {
+      final_humans[i] = refineHuman(grayscale_img, final_humans[i],
+        pedestrian_hog);
+    }
+    timings->hog += elapsedMs(start);
+  }
   return final_humans;
 }
 
+/**
+ * @brief   Computes the factor an image is scaled by before the detection
+ * @param   size [const cv::Size&] The image's size
+ * @return  [double] The scale factor, 1 if the image is scanned as is
+ */
+double HumanDetector::detectionScale(const cv::Size& size) const
+{
+  int long_edge = std::max(size.width, size.height);
+  if(max_long_edge_ <= 0 || long_edge <= max_long_edge_)
+  {
+    return 1.0;
+  }
+  return static_cast<double>(max_long_edge_) / long_edge;
+}
+
+/**
+ * @brief   Refines a human found at a reduced resolution, by running the
+ *          HOG pedestrian detector on the full resolution region around it
+ * @param   grayscale_img [const cv::Mat&] The full resolution equalized
+ *          grayscale image
+ * @param   human [const cv::Rect&] The human, in full resolution coordinates
+ * @param   hog [const cv::HOGDescriptor&] The pedestrian detector
+ * @return  [cv::Rect] The refined human. The input human if the detector
+ *          did not confirm it.
+ */
+cv::Rect HumanDetector::refineHuman(const cv::Mat& grayscale_img,
+  const cv::Rect& human, const cv::HOGDescriptor& hog)
+{
+  // The region around the human, padded by a quarter of its size
+  cv::Rect roi(human.x - human.width / 4, human.y - human.height / 4,
+    human.width + human.width / 2, human.height + human.height / 2);
+  roi &= cv::Rect(0, 0, grayscale_img.cols, grayscale_img.rows);
+  if(roi.width < hog.winSize.width || roi.height < hog.winSize.height)
+  {
+    return human;
+  }
+
+  std::vector<cv::Rect> found;
+  hog.detectMultiScale(grayscale_img(roi), found, 0, cv::Size(8, 8),
+    cv::Size(0, 0), 1.05, 2);
+
+  // Keep the detection overlapping the coarse human the most
+  int best_overlap = 0;
+  cv::Rect best = human;
+  for(unsigned int i = 0 ; i < found.size() ; i++)
+  {
+    cv::Rect candidate = found[i] + roi.tl();
+    int overlap = (candidate & human).area();
+    if(overlap > best_overlap)
+    {
+      best_overlap = overlap;
+      best = candidate;
+    }
+  }
+  return best;
+}
+
 /**
  * @brief   Detects humans from a cv::Mat
  * @param   input_img [const cv::Mat&] The input image
- * @param   haar_path [const std::string] The Haar training model path
+ * @param   human_cascade [cv::CascadeClassifier&] The Haar classifier
+ * @param   scale [double] The factor the image was downscaled by
  * @return  [std::vector<cv::Rect>] A vector containing the detected humans.
  *          Each human is represented by a rectangle.
  */
 std::vector<cv::Rect> HumanDetector::detectHuman2D(const cv::Mat& input_img,
-  const std::string& haar_path)
+  cv::CascadeClassifier& human_cascade, double scale)
 {
   std::vector<cv::Rect> found, final_humans;
 
-  // The Haar cascade classifier
-  cv::CascadeClassifier human_cascade; // body_cascade
-  // Create the classifier
-  human_cascade.load(haar_path);
-
   // Parameters of detectMultiscale Cascade Classifier
   int groundThreshold = 2;
   double scaleStep = 1.1;
-  cv::Size minimalObjectSize = cv::Size(100, 100); // minimal size of the detected object
+  // minimal size of the detected object, shrunk along with the image
+  int minimal_side = std::max(cvRound(100 * scale), 24);
+  cv::Size minimalObjectSize = cv::Size(minimal_side, minimal_side);
   cv::Size maximalObjectSize = cv::Size(800, 800); // maximal size of the detected object
   // Detect humans
   human_cascade.detectMultiScale(input_img, found, scaleStep, groundThreshold, 0 | cv::CASCADE_SCALE_IMAGE, minimalObjectSize);//, maximalObjectSize);
@@ -160,15 +366,24 @@ std::vector<cv::Rect> HumanDetector::identifyUniqueHumans(
 /**
  * @brief   Finds humans in an image retrieved from a file URL
  * @param   file_name [std::string] The image file's URL
+ * @param   fast [bool] True for fast detection -- coarse HOG only
+ * @param   timings [HumanDetectionTimings*] If not NULL, receives the
+ *          time spent in each stage
  * @return  [std::vector<cv::Rect>] A vector containing the detected humans.
  *          Each human is represented by a rectangle.
  */
-std::vector<cv::Rect> HumanDetector::findHuman2D(std::string file_name)
+std::vector<cv::Rect> HumanDetector::findHuman2D(std::string file_name,
+  bool fast, HumanDetectionTimings* timings)
 {
   cv::Mat input_img;
+  int64 start = cv::getTickCount();
   input_img = loadImage(file_name);
+  if(timings != NULL)
+  {
+    timings->load += elapsedMs(start);
+  }
   //std::vector<cv::Rect> final_humans;
   //final_humans = detectHuman2D(input_img);
-  return detectHuman2D(input_img);
+  return detectHuman2D(input_img, fast, timings);
 }
 
@@ -0,0 +1,174 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <human_detection/human_detector.h>
+#include <ros/package.h>
+
+/**
+ * @brief Returns the milliseconds elapsed since the given tick count
+ */
+double elapsedMs(int64 start)
+{
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+/**
+ * @brief Counts the reference rectangles matched by a detection, i.e.
+ * overlapping it by at least half of their union
+ */
+unsigned int countMatches(const std::vector<cv::Rect>& reference,
+  const std::vector<cv::Rect>& detected)
+{
+  unsigned int matches = 0;
+  for(unsigned int i = 0 ; i < reference.size() ; i++)
+  {
+    for(unsigned int j = 0 ; j < detected.size() ; j++)
+    {
+      double intersection = (reference[i] & detected[j]).area();
+      double uni = reference[i].area() + detected[j].area() - intersection;
+      if(uni > 0 && intersection / uni >= 0.5)
+      {
+        matches++;
+        break;
+      }
+    }
+  }
+  return matches;
+}
+
+/**
+ * @brief Compares the human detection at the original resolution of large
+ * images against the detection at a reduced resolution, with and without
+ * refinement. The human_detection_samples are upscaled to emulate the
+ * 5-12 MP images of newer robots. The recall is the fraction of the humans
+ * found at the original resolution that are found again. Finally it breaks
+ * the latency of the original samples down per stage and compares the fast
+ * mode against the accurate one.
+ * Usage: human_detection_benchmark [upscale] [max_long_edge]
+ */
+int main(int argc, char **argv)
+{
+  double upscale = 3.0;
+  int max_long_edge = 1280;
+  if(argc > 1)
+  {
+    upscale = atof(argv[1]);
+  }
+  if(argc > 2)
+  {
+    max_long_edge = atoi(argv[2]);
+  }
+
+  std::string path = ros::package::getPath("rapp_testing_tools") +
+    std::string("/test_data/human_detection_samples/");
+  const char* samples[] = {"NAO_picture_3.png", "NAO_picture_5.png",
+    "NAO_picture_6.png", "NAO_picture_8.png", "NAO_picture_10.png",
+    "NAO_picture_14.png"};
+  const unsigned int samples_count = sizeof(samples) / sizeof(samples[0]);
+
+  const char* modes[] = {"original", "downscaled", "downscaled+refine"};
+  HumanDetector detectors[3];
+  detectors[1].setDetectionResolution(max_long_edge, false);
+  detectors[2].setDetectionResolution(max_long_edge, true);
+
+  double ms[3] = {0, 0, 0};
+  unsigned int matches[3] = {0, 0, 0};
+  unsigned int reference_humans = 0;
+  for(unsigned int s = 0 ; s < samples_count ; s++)
+  {
+    cv::Mat input_img = detectors[0].loadImage(path + samples[s]);
+    if(input_img.empty())
+    {
+      printf("Could not load %s\n", samples[s]);
+      continue;
+    }
+    cv::Mat large_img;
+    cv::resize(input_img, large_img, cv::Size(), upscale, upscale,
+      cv::INTER_LINEAR);
+
+    std::vector<cv::Rect> reference;
+    for(unsigned int m = 0 ; m < 3 ; m++)
+    {
+      int64 start = cv::getTickCount();
+      std::vector<cv::Rect> humans = detectors[m].detectHuman2D(large_img);
+      ms[m] += elapsedMs(start);
+      if(m == 0)
+      {
+        reference = humans;
+        reference_humans += reference.size();
+      }
+      matches[m] += countMatches(reference, humans);
+    }
+  }
+
+  printf("Images: %u, upscaled by %.1f, max long edge %d\n",
+    samples_count, upscale, max_long_edge);
+  for(unsigned int m = 0 ; m < 3 ; m++)
+  {
+    printf("%-20s %8.2f ms/image  recall %5.1f%%\n", modes[m],
+      ms[m] / samples_count,
+      reference_humans > 0 ? 100.0 * matches[m] / reference_humans : 100.0);
+  }
+
+  // Per stage breakdown on the original samples. The first request of a
+  // detector builds the models, the rest reuse them.
+  HumanDetector human_detector;
+  HumanDetectionTimings first, rest;
+  for(unsigned int s = 0 ; s < samples_count ; s++)
+  {
+    human_detector.findHuman2D(path + samples[s], false,
+      s == 0 ? &first : &rest);
+  }
+  unsigned int rest_count = samples_count > 1 ? samples_count - 1 : 1;
+  printf("\nStage breakdown [ms]    load      HOG     Haar  grouping\n");
+  printf("first request       %8.2f %8.2f %8.2f %8.2f\n", first.load,
+    first.hog, first.haar, first.grouping);
+  printf("later requests      %8.2f %8.2f %8.2f %8.2f\n",
+    rest.load / rest_count, rest.hog / rest_count, rest.haar / rest_count,
+    rest.grouping / rest_count);
+
+  // The fast mode against the accurate one on the original samples. The
+  // recall is the fraction of the accurate mode's humans found again.
+  double accurate_ms = 0, fast_ms = 0;
+  unsigned int accurate_humans = 0, fast_humans = 0, fast_matches = 0;
+  for(unsigned int s = 0 ; s < samples_count ; s++)
+  {
+    cv::Mat input_img = human_detector.loadImage(path + samples[s]);
+    int64 start = cv::getTickCount();
+    std::vector<cv::Rect> accurate =
+      human_detector.detectHuman2D(input_img, false);
+    accurate_ms += elapsedMs(start);
+
+    start = cv::getTickCount();
+    std::vector<cv::Rect> fast = human_detector.detectHuman2D(input_img, true);
+    fast_ms += elapsedMs(start);
+
+    accurate_humans += accurate.size();
+    fast_humans += fast.size();
+    fast_matches += countMatches(accurate, fast);
+  }
+  printf("\nMode        ms/image  humans  recall\n");
+  printf("accurate    %8.2f  %6u  100.0%%\n", accurate_ms / samples_count,
+    accurate_humans);
+  printf("fast        %8.2f  %6u  %5.1f%%\n", fast_ms / samples_count,
+    fast_humans,
+    accurate_humans > 0 ? 100.0 * fast_matches / accurate_humans : 100.0);
+  return 0;
+}
@@ -74,6 +74,20 @@ class HumanDetFunc(unittest.TestCase):
             humans_num = len(response.humans_up_left)
             self.assertEqual( humans_num, 1 )
 
+    ## Tests fast human detection with an image that does not contain humans. Should return 0 humans
+    def test_humanDoesNotExist_fast(self):
+        rospack = rospkg.RosPack()
+        human_service = rospy.get_param("rapp_human_detection_detect_humans_topic")
+        rospy.wait_for_service(human_service)
+        fd_service = rospy.ServiceProxy(human_service, HumanDetectionRosSrv)
+        req = HumanDetectionRosSrvRequest()
+        req.imageFilename = rospack.get_path('rapp_testing_tools') + \
+                '/test_data/qr_code_rapp.jpg'
+        req.fast = True
+        response = fd_service(req)
+        humans_num = len(response.humans_up_left)
+        self.assertEqual( humans_num, 0 )
+
     ## Tests human detection with an image that does not contain humans. Should return 0 humans
     def test_humanDoesNotExist(self):
         rospack = rospkg.RosPack()
@@ -87,6 +87,46 @@ TEST_F(HumanDetectionTest, file_not_exists_test)
   EXPECT_EQ(0,humans.size());
 }
 
+/**
+ * @brief Tests fast human detection with a NAO captured image. Should find
+ * the same human as the accurate detection
+ */
+TEST_F(HumanDetectionTest, human_fast_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/human_detection_samples/NAO_picture_3.png");
+  std::vector<cv::Rect> humans = human_detector_->findHuman2D(s, true);
+  ASSERT_EQ(1,humans.size());
+  std::vector<cv::Rect> accurate_humans = human_detector_->findHuman2D(s);
+  ASSERT_EQ(1,accurate_humans.size());
+  cv::Rect overlap = humans[0] & accurate_humans[0];
+  EXPECT_GT(overlap.area(), accurate_humans[0].area() / 2);
+}
+
+/**
+ * @brief Tests fast human detection with a qr code. Should return 0 humans
+ */
+TEST_F(HumanDetectionTest, qr_fast_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/qr_code_rapp.jpg");
+  std::vector<cv::Rect> humans = human_detector_->findHuman2D(s, true);
+  EXPECT_EQ(0,humans.size());
+}
+
+/**
+ * @brief Tests that the fast human detection skips the upper body stage
+ */
+TEST_F(HumanDetectionTest, fast_timings_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/human_detection_samples/NAO_picture_3.png");
+  HumanDetectionTimings timings;
+  human_detector_->findHuman2D(s, true, &timings);
+  EXPECT_GT(timings.hog, 0);
+  EXPECT_EQ(0, timings.haar);
+}
+
 /**
  * @brief Tests human detection with an empty image. Should return 0 humans
  */
@@ -56,6 +56,29 @@ void loadMapFromFile(nav_msgs::GetMap::Response* resp,
                      const char* fname, double res, bool negate,
                      double occ_th, double free_th, double* origin,
                      bool trinary=true);
+
+/** Convert the pixels of an 8-bit image to occupancy values, looking the
+ * value of every pixel up in a table built from the thresholds.
+ *
+ * @param pixels The image's pixels, rows top to bottom
+ * @param width The image's width
+ * @param height The image's height
+ * @param rowstride The size of an image row in bytes
+ * @param n_channels The number of channels, 1 to 4; unless trinary, the
+ *                   last channel of multi-channel images is alpha
+ * @param negate If true, then whiter pixels are occupied, and blacker
+ *               pixels are free
+ * @param occ_th Threshold above which pixels are occupied
+ * @param free_th Threshold below which pixels are free
+ * @param trinary If true, only outputs Occupied/Free/Unknown
+ * @param data The width * height occupancy values are written into here,
+ *             bottom row first
+ * @throws std::runtime_error If the number of channels is not supported
+ * */
+void convertPixels(const unsigned char* pixels, unsigned int width,
+                   unsigned int height, int rowstride, int n_channels,
+                   bool negate, double occ_th, double free_th, bool trinary,
+                   int8_t* data);
 }
 
 #endif
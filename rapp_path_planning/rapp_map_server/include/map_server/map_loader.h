@@ -0,0 +1,150 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#ifndef MAP_SERVER_MAP_LOADER_H
+#define MAP_SERVER_MAP_LOADER_H
+
+#include <string>
+
+#include "nav_msgs/OccupancyGrid.h"
+#include "rapp_platform_ros_communications/MapServerUploadMapRosSrv.h"
+
+namespace map_server
+{
+
+/** Description of a map, as read from its YAML file */
+struct MapMetadata
+{
+  /** The image file, resolved against the YAML file's directory */
+  std::string image;
+  /** The size of a cell [meters/pixel] */
+  double resolution;
+  /** 2-D pose of the lower-left corner of the image */
+  double origin[3];
+  /** If true, whiter pixels are occupied and blacker pixels are free */
+  int negate;
+  /** Threshold above which pixels are occupied */
+  double occupied_thresh;
+  /** Threshold below which pixels are free */
+  double free_thresh;
+  /** If true, only outputs Occupied/Free/Unknown */
+  bool trinary;
+};
+
+/** Read the description of a map from its YAML file.
+ *
+ * @param yaml_path The map YAML file
+ * @return The map description
+ * @throws std::runtime_error If the file can't be read or a tag is missing
+ */
+MapMetadata loadMapMetadata(const std::string& yaml_path);
+
+/** Load a map from its YAML file and the image it refers to, without
+ * going through a map_server node. The binary form of the map is read
+ * instead when it is up to date, and written otherwise if the map is a
+ * user's map.
+ *
+ * @param yaml_path The map YAML file
+ * @param map The map will be written into here
+ * @param frame_id The frame the map is expressed in
+ * @throws std::runtime_error If the description or the image can't be loaded
+ */
+void loadMap(const std::string& yaml_path, nav_msgs::OccupancyGrid* map,
+             const std::string& frame_id = "map");
+
+/** Whether a map belongs to a user, i.e. lies below
+ * $HOME/rapp_platform_files/maps. The files derived from a map, such as
+ * its binary form, are only written next to users' maps, never into the
+ * maps shipped with the platform.
+ *
+ * @param yaml_path The map YAML file
+ * @return True if the map is a user's map
+ */
+bool isUserMap(const std::string& yaml_path);
+
+/** The path of the binary form of a map, <map_name>.grid next to its YAML
+ * file. The binary form is a header followed by the occupancy grid, as
+ * converted from the image.
+ *
+ * @param yaml_path The map YAML file
+ * @return The path of the binary map
+ */
+std::string binaryMapPath(const std::string& yaml_path);
+
+/** Read the binary form of a map, if it is newer than both the YAML file
+ * and the image the map was converted from. The file is memory-mapped and
+ * the grid copied once into the map.
+ *
+ * @param yaml_path The map YAML file
+ * @param map The map will be written into here
+ * @return True if the map was read, false if the binary map is missing,
+ *         out of date or broken
+ */
+bool loadBinaryMap(const std::string& yaml_path, nav_msgs::OccupancyGrid* map);
+
+/** Write the binary form of a map. It is written to a temporary file and
+ * renamed, so that readers never see a partial map.
+ *
+ * @param yaml_path The map YAML file
+ * @param image_path The image file the map was converted from
+ * @param map The converted map
+ * @throws std::runtime_error If the binary map can't be written
+ */
+void saveBinaryMap(const std::string& yaml_path, const std::string& image_path,
+                   const nav_msgs::OccupancyGrid& map);
+
+/** Whether a user or map name can be used as a file or directory name:
+ * not empty, not hidden and without path separators. The names of the
+ * uploaded maps are checked with it, so that no upload is written outside
+ * its user's maps directory.
+ *
+ * @param name The user or map name
+ * @return True if the name is valid
+ */
+bool validName(const std::string& name);
+
+/** Store an uploaded map as <directory>/<map_name>.yaml and
+ * <directory>/<map_name>.png, creating the directory if needed, and
+ * convert it to its binary form. Each file is written to a temporary file,
+ * synced and renamed into place.
+ *
+ * @param directory The user's maps directory
+ * @param req The upload request carrying the map description and image
+ * @return The path of the stored YAML file
+ * @throws std::runtime_error If the user or map name is invalid or a file
+ *         can't be written
+ */
+std::string saveUploadedMap(const std::string& directory,
+    const rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request& req);
+
+/** Store the description of an uploaded map, whose image is already
+ * stored as <directory>/<map_name>.png, as <directory>/<map_name>.yaml,
+ * and convert the map to its binary form.
+ *
+ * @param directory The user's maps directory
+ * @param req The upload request carrying the map description; its data
+ *            is ignored
+ * @return The path of the stored YAML file
+ * @throws std::runtime_error If the user or map name is invalid or the YAML
+ *         file can't be written
+ */
+std::string saveUploadedMapDescription(const std::string& directory,
+    const rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request& req);
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#ifndef MAP_SERVER_MAP_UPLOADER_H
+#define MAP_SERVER_MAP_UPLOADER_H
+
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
+#include <boost/crc.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "ros/ros.h"
+#include "rapp_platform_ros_communications/MapServerUploadMapRosSrv.h"
+#include "rapp_platform_ros_communications/MapServerUploadMapChunkRosSrv.h"
+
+namespace map_server
+{
+
+/** Receives maps uploaded in chunks, through the
+ * MapServerUploadMapChunkRosSrv begin/append/commit protocol. The image of
+ * an upload is appended to a temporary file in the user's maps directory,
+ * which is synced and renamed into place when the upload is committed, so
+ * that no map is ever seen half written. Uploads idle for longer than a
+ * timeout are dropped, and so are the temporary files an earlier run left
+ * behind.
+ */
+class MapUploader
+{
+  public:
+    /** Constructor
+     *
+     * @param maps_directory The directory holding the users' maps
+     *                       directories
+     * @param timeout Time after which idle uploads are dropped [s]
+     */
+    explicit MapUploader(const std::string& maps_directory,
+                         double timeout = 600.0);
+
+    /** Destructor. Drops the pending uploads. */
+    ~MapUploader(void);
+
+    /** Serve a request of the chunked upload service
+     *
+     * @param req The request
+     * @param res The response will be written into here
+     * @return The path of the map's YAML file if the request committed an
+     *         upload, an empty string otherwise
+     */
+    std::string handle(
+        const rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request& req,
+        rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Response* res);
+
+  private:
+    /** A pending upload */
+    struct Upload
+    {
+      /** The map description, without data */
+      rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request description;
+      /** The user's maps directory */
+      std::string directory;
+      /** The temporary file the image is appended to */
+      std::string tmp_path;
+      int fd;
+      /** Bytes of the image received so far */
+      uint64_t received;
+      /** CRC-32 of the bytes received so far */
+      boost::crc_32_type crc;
+      /** Time of the last request of the upload */
+      ros::WallTime last_activity;
+    };
+
+    /** Start an upload, returning its id */
+    std::string begin(
+        const rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request& req);
+
+    /** Append a chunk to an upload */
+    void append(Upload& upload,
+        const rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request& req);
+
+    /** Move the image of a complete upload into place */
+    void commit(Upload& upload,
+        const rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request& req);
+
+    /** Close and remove the temporary file of an upload */
+    void discard(Upload& upload);
+
+    /** Drop the uploads idle for longer than the timeout */
+    void expire(void);
+
+    /** Remove the temporary files of uploads lost by an earlier run, idle
+     * for longer than the timeout */
+    void removeStaleFiles(void);
+
+    /** Not copyable, the temporary files are owned */
+    MapUploader(const MapUploader&);
+    MapUploader& operator=(const MapUploader&);
+
+    std::string maps_directory_;
+    double timeout_;
+    /** Guards the uploads */
+    boost::mutex mutex_;
+    /** The pending uploads, by id */
+    std::map<std::string, Upload> uploads_;
+    unsigned long next_id_;
+};
+
+}
+
+#endif
@@ -35,6 +35,7 @@
 
 #include <cstring>
 #include <stdexcept>
+#include <vector>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -51,6 +52,125 @@
 namespace map_server
 {
 
+namespace
+{
+
+// Sums the first AVG_CHANNELS channels of every pixel and looks the
+// occupancy value up, writing the rows bottom-up. The channel counts are
+// template parameters, thus the sum is unrolled and the alpha test is
+// compiled out when the alpha channel is averaged.
+template <int N_CHANNELS, int AVG_CHANNELS>
+void
+convertRows(const unsigned char* pixels, unsigned int width,
+            unsigned int height, int rowstride, const unsigned char* lut,
+            int transparent_offset, int8_t* data)
+{
+  for(unsigned int j = 0; j < height; j++)
+  {
+    const unsigned char* p = pixels + j*rowstride;
+    int8_t* row = data + MAP_IDX(width, 0, height - j - 1);
+    for (unsigned int i = 0; i < width; i++, p += N_CHANNELS)
+    {
+      int color_sum = p[0];
+      if (AVG_CHANNELS > 1)
+        color_sum += p[1];
+      if (AVG_CHANNELS > 2)
+        color_sum += p[2];
+      if (AVG_CHANNELS > 3)
+        color_sum += p[3];
+      // The last channel is alpha when it is not averaged, and only fully
+      // transparent pixels differ
+      if (AVG_CHANNELS < N_CHANNELS && p[N_CHANNELS - 1] == 0)
+        color_sum += transparent_offset;
+      row[i] = lut[color_sum];
+    }
+  }
+}
+
+}
+
+void
+convertPixels(const unsigned char* pixels, unsigned int width,
+              unsigned int height, int rowstride, int n_channels,
+              bool negate, double occ_th, double free_th, bool trinary,
+              int8_t* data)
+{
+  int avg_channels;
+  if (trinary || n_channels == 1)
+    avg_channels = n_channels;
+  else
+    avg_channels = n_channels - 1;
+
+  // For 8-bit channels the occupancy value depends only on the sum of the
+  // averaged channels and on whether the pixel is transparent, thus it is
+  // computed once per sum, the same way it used to be computed per pixel.
+  // The values of transparent pixels follow the ones of opaque pixels
+  int sums = 255 * avg_channels + 1;
+  std::vector<unsigned char> lut(2 * sums);
+  for (int color_sum = 0; color_sum < sums; color_sum++)
+  {
+    double color_avg = color_sum / (double)avg_channels;
+    double occ;
+
+    // If negate is true, we consider blacker pixels free, and whiter
+    // pixels free.  Otherwise, it's vice versa.
+    if(negate)
+      occ = color_avg / 255.0;
+    else
+      occ = (255 - color_avg) / 255.0;
+
+    // Apply thresholds to RGB means to determine occupancy values for
+    // map.
+    unsigned char value, transparent_value;
+    if(occ > occ_th)
+      value = transparent_value = +100;
+    else if(occ < free_th)
+      value = transparent_value = 0;
+    else
+    {
+      double ratio = (occ - free_th) / (occ_th - free_th);
+      if(trinary)
+        value = -1;
+      else
+        value = 99 * ratio;
+      transparent_value = -1;
+    }
+    lut[color_sum] = value;
+    lut[sums + color_sum] = transparent_value;
+  }
+
+  // Note that we invert the graphics-ordering of the pixels to produce a
+  // map with cell (0,0) in the lower-left corner.
+  const unsigned char* l = &lut[0];
+  int t = sums;
+  switch (n_channels * 8 + avg_channels)
+  {
+    case 1*8 + 1:
+      convertRows<1, 1>(pixels, width, height, rowstride, l, t, data);
+      break;
+    case 2*8 + 1:
+      convertRows<2, 1>(pixels, width, height, rowstride, l, t, data);
+      break;
+    case 2*8 + 2:
+      convertRows<2, 2>(pixels, width, height, rowstride, l, t, data);
+      break;
+    case 3*8 + 2:
+      convertRows<3, 2>(pixels, width, height, rowstride, l, t, data);
+      break;
+    case 3*8 + 3:
+      convertRows<3, 3>(pixels, width, height, rowstride, l, t, data);
+      break;
+    case 4*8 + 3:
+      convertRows<4, 3>(pixels, width, height, rowstride, l, t, data);
+      break;
+    case 4*8 + 4:
+      convertRows<4, 4>(pixels, width, height, rowstride, l, t, data);
+      break;
+    default:
+      throw std::runtime_error("unsupported number of image channels");
+  }
+}
+
 void
 loadMapFromFile(nav_msgs::GetMap::Response* resp,
                 const char* fname, double res, bool negate,
@@ -59,17 +179,6 @@ loadMapFromFile(nav_msgs::GetMap::Response* resp,
 {
   SDL_Surface* img;
 
-  unsigned char* pixels;
-  unsigned char* p;
-  unsigned char value;
-  int rowstride, n_channels, avg_channels;
-  unsigned int i,j;
-  int k;
-  double occ;
-  int alpha;
-  int color_sum;
-  double color_avg;
-
   // Load the image using SDL.  If we get NULL back, the image load failed.
   if(!(img = IMG_Load(fname)))
   {
@@ -95,56 +204,19 @@ loadMapFromFile(nav_msgs::GetMap::Response* resp,
   // Allocate space to hold the data
   resp->map.data.resize(resp->map.info.width * resp->map.info.height);
 
-  // Get values that we'll need to iterate through the pixels
-  rowstride = img->pitch;
-  n_channels = img->format->BytesPerPixel;
-
-  if (trinary || n_channels == 1)
-    avg_channels = n_channels;
-  else
-    avg_channels = n_channels - 1;
-
   // Copy pixel data into the map structure
-  pixels = (unsigned char*)(img->pixels);
-  for(j = 0; j < resp->map.info.height; j++)
+  try
   {
-    for (i = 0; i < resp->map.info.width; i++)
-    {
-      // Compute mean of RGB for this pixel
-      p = pixels + j*rowstride + i*n_channels;
-      color_sum = 0;
-      for(k=0;k<avg_channels;k++)
-        color_sum += *(p + (k));
-      color_avg = color_sum / (double)avg_channels;
-
-      if (n_channels == 1)
-          alpha = 1;
-      else
-          alpha = *(p+n_channels-1);
-
-      // If negate is true, we consider blacker pixels free, and whiter
-      // pixels free.  Otherwise, it's vice versa.
-      if(negate)
-        occ = color_avg / 255.0;
-      else
-        occ = (255 - color_avg) / 255.0;
-      
-      // Apply thresholds to RGB means to determine occupancy values for
-      // map.  Note that we invert the graphics-ordering of the pixels to
-      // produce a map with cell (0,0) in the lower-left corner.
-      if(occ > occ_th)
-        value = +100;
-      else if(occ < free_th)
-        value = 0;
-      else if(trinary || alpha < 1.0)
-        value = -1;
-      else {
-        double ratio = (occ - free_th) / (occ_th - free_th);
-        value = 99 * ratio;
-      }
-           
-      resp->map.data[MAP_IDX(resp->map.info.width,i,resp->map.info.height - j - 1)] = value;
-    }
+    if (!resp->map.data.empty())
+      convertPixels((unsigned char*)(img->pixels), resp->map.info.width,
+                    resp->map.info.height, img->pitch,
+                    img->format->BytesPerPixel, negate, occ_th, free_th,
+                    trinary, &resp->map.data[0]);
+  }
+  catch (std::runtime_error&)
+  {
+    SDL_FreeSurface(img);
+    throw;
   }
 
   SDL_FreeSurface(img);
@@ -50,32 +50,29 @@
 #include "ros/ros.h"
 #include "ros/console.h"
 #include "map_server/image_loader.h"
+#include "map_server/map_loader.h"
+#include "map_server/map_uploader.h"
+#include <boost/scoped_ptr.hpp>
 #include "nav_msgs/MapMetaData.h"
-#include "yaml-cpp/yaml.h"
 #include "rapp_platform_ros_communications/MapServerGetMapRosSrv.h"
 #include "rapp_platform_ros_communications/MapServerUploadMapRosSrv.h"
+#include "rapp_platform_ros_communications/MapServerUploadMapChunkRosSrv.h"
 #include "std_srvs/Empty.h"
 //get rapp-platform home directory
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <pwd.h>
 
 
-#ifdef HAVE_NEW_YAMLCPP
-// The >> operator disappeared in yaml-cpp 0.5, so this function is
-// added to provide support for code written under the yaml-cpp 0.3 API.
-template<typename T>
-void operator >> (const YAML::Node& node, T& i)
-{
-  i = node.as<T>();
-}
-#endif
-
 class MapServer
 {
   public:
     /** Trivial constructor */
-    MapServer(std::string fname)
+    MapServer(std::string fname) :
+      loaded_mtime_(0),
+      loaded_mtime_nsec_(0),
+      loaded_size_(0)
     {
       if ((homedir = getenv("HOME")) == NULL) {
       homedir = getpwuid(getuid())->pw_dir;
@@ -97,6 +94,8 @@ class MapServer
       }
       if (upload_map_trigger){
         upload_service = n.advertiseService(node_name+"/upload_map", &MapServer::mapUploadCallback, this);
+        map_uploader_.reset(new map_server::MapUploader(std::string(homedir)+"/rapp_platform_files/maps"));
+        upload_chunk_service = n.advertiseService(node_name+"/upload_map_chunk", &MapServer::mapUploadChunkCallback, this);
       }
       // Latched publisher for metadata
       metadata_pub= n.advertise<nav_msgs::MapMetaData>("map_metadata", 1, true);
@@ -114,49 +113,33 @@ class MapServer
     ros::NodeHandle n;
     ros::Publisher map_pub;
     ros::Publisher metadata_pub;
-    ros::ServiceServer get_service,upload_service,test_service;
+    ros::ServiceServer get_service,upload_service,upload_chunk_service,test_service;
+    boost::scoped_ptr<map_server::MapUploader> map_uploader_;
     std::string fname;
-    bool deprecated;
 
     bool mapUploadCallback(rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request  &req,
                      rapp_platform_ros_communications::MapServerUploadMapRosSrv::Response &res)
     {
-
-    YAML::Node yaml_node;
-    yaml_node["image"] = req.map_name+".png";
-    yaml_node["resolution"] = req.resolution;
-    yaml_node["origin"] = req.origin;
-    yaml_node["negate"] = req.negate;
-    yaml_node["occupied_thresh"] = req.occupied_thresh;
-
-
-    std::ostringstream ss;
-    yaml_node["free_thresh"] = req.free_thresh;
-
-    std::string user = req.user_name;
-    std::string map = req.map_name;
-    std::string homedir_str = homedir;
-    std::string map_path = homedir_str+"/rapp_platform_files/maps/"+user;
-
-    boost::filesystem::create_directories(map_path);
-    std::string yaml_path = map_path+"/"+map+".yaml";
-    std::ofstream fout(yaml_path.c_str());
-    fout << yaml_node;
-    std::string png_path = map_path+"/"+map+".png";
-
-    std::ofstream outfile (png_path.c_str(),std::ofstream::binary);
-
-    char* buffer = reinterpret_cast<char*>(req.data.data());
-    long size = strlen(buffer);
-    // write to outfile
-    ROS_INFO_STREAM ("User: "<<user<< " saved map: "<< png_path << "\n size of the map: " << req.file_size << " bytes" );
-
-    outfile.write (buffer,req.file_size);
-
-      // // release dynamically-allocated memory
-    outfile.close();
-    res.status = true;
-    return true;
+      std::string homedir_str = homedir;
+      std::string map_path = homedir_str+"/rapp_platform_files/maps/"+req.user_name;
+      try
+      {
+        std::string yaml_path = map_server::saveUploadedMap(map_path, req);
+        ROS_INFO_STREAM ("User: "<<req.user_name<< " saved map: "<< yaml_path << "\n size of the map: " << req.file_size << " bytes" );
+        res.status = true;
+      }
+      catch(std::runtime_error& e)
+      {
+        ROS_ERROR("Map upload failed: %s", e.what());
+        res.status = false;
+      }
+      return true;
+    }
+    bool mapUploadChunkCallback(rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request  &req,
+                     rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Response &res)
+    {
+      map_uploader_->handle(req, &res);
+      return true;
     }
     /** Callback invoked when someone requests our service */
     bool mapCallback(rapp_platform_ros_communications::MapServerGetMapRosSrv::Request  &req,
@@ -170,106 +153,42 @@ class MapServer
 
       if (n.hasParam(param_name_char)){
          n.getParam(param_name_char,fname);
-        updateMap(req.map_path,0);
+        if (isLoaded(req.map_path))
+          ROS_DEBUG("Map \"%s\" is already loaded", req.map_path.c_str());
+        else
+          updateMap(req.map_path,0);
       }
       res.map = map_resp_.map;
       return true;
     }
+    /** True if the map file was loaded and not modified since */
+    bool isLoaded(const std::string& fname)
+    {
+      struct stat buffer;
+      return fname == loaded_path_ && stat(fname.c_str(), &buffer) == 0 &&
+          buffer.st_mtim.tv_sec == loaded_mtime_ &&
+          buffer.st_mtim.tv_nsec == loaded_mtime_nsec_ &&
+          buffer.st_size == loaded_size_;
+    }
     bool updateMap(const std::string fname, double res){
-      std::string mapfname = "";   
-      double origin[3];
-      int negate;
-      double occ_th, free_th;
-      bool trinary = true;
       std::string frame_id;
       ros::NodeHandle private_nh("~");
       private_nh.param("frame_id", frame_id, std::string("map"));
-      deprecated = false;//(res != 0);
-      if (!deprecated) {
-        std::ifstream fin(fname.c_str());
-        if (fin.fail()) {
-          ROS_ERROR("Map_server could not open %s.", fname.c_str());
-          exit(-1);
-        }
-#ifdef HAVE_NEW_YAMLCPP
-        // The document loading process changed in yaml-cpp 0.5.
-        YAML::Node doc = YAML::Load(fin);
-#else
-        YAML::Parser parser(fin);
-        YAML::Node doc;
-        parser.GetNextDocument(doc);
-#endif
-        try { 
-          doc["resolution"] >> res; 
-        } catch (YAML::InvalidScalar) { 
-          ROS_ERROR("The map does not contain a resolution tag or it is invalid.");
-          exit(-1);
-        }
-        try { 
-          doc["negate"] >> negate; 
-        } catch (YAML::InvalidScalar) { 
-          ROS_ERROR("The map does not contain a negate tag or it is invalid.");
-          exit(-1);
-        }
-        try { 
-          doc["occupied_thresh"] >> occ_th; 
-        } catch (YAML::InvalidScalar) { 
-          ROS_ERROR("The map does not contain an occupied_thresh tag or it is invalid.");
-          exit(-1);
-        }
-        try { 
-          doc["free_thresh"] >> free_th; 
-        } catch (YAML::InvalidScalar) { 
-          ROS_ERROR("The map does not contain a free_thresh tag or it is invalid.");
-          exit(-1);
-        }
-        try { 
-          doc["trinary"] >> trinary; 
-        } catch (YAML::Exception) { 
-          ROS_DEBUG("The map does not contain a trinary tag or it is invalid... assuming true");
-          trinary = true;
-        }
-        try { 
-          doc["origin"][0] >> origin[0]; 
-          doc["origin"][1] >> origin[1]; 
-          doc["origin"][2] >> origin[2]; 
-        } catch (YAML::InvalidScalar) { 
-          ROS_ERROR("The map does not contain an origin tag or it is invalid.");
-          exit(-1);
-        }
-        try { 
-          doc["image"] >> mapfname; 
-          // TODO: make this path-handling more robust
-          if(mapfname.size() == 0)
-          {
-            ROS_ERROR("The image tag cannot be an empty string.");
-            exit(-1);
-          }
-          if(mapfname[0] != '/')
-          {
-            // dirname can modify what you pass it
-            char* fname_copy = strdup(fname.c_str());
-            mapfname = std::string(dirname(fname_copy)) + '/' + mapfname;
-            free(fname_copy);
-          }
-        } catch (YAML::InvalidScalar) { 
-          ROS_ERROR("The map does not contain an image tag or it is invalid.");
-          exit(-1);
-        }
-      } else {
-        private_nh.param("negate", negate, 0);
-        private_nh.param("occupied_thresh", occ_th, 0.65);
-        private_nh.param("free_thresh", free_th, 0.196);
-        mapfname = fname;
-        origin[0] = origin[1] = origin[2] = 0.0;
+      // The map file is stat'ed before it is read, thus a map modified
+      // while it is loaded is loaded again by the next request
+      struct stat buffer;
+      bool stat_ok = stat(fname.c_str(), &buffer) == 0;
+      try
+      {
+        ROS_INFO("Loading map \"%s\"", fname.c_str());
+        map_server::loadMap(fname, &map_resp_.map, frame_id);
+      }
+      catch(std::runtime_error& e)
+      {
+        ROS_ERROR("Map_server could not load %s: %s", fname.c_str(), e.what());
+        exit(-1);
       }
 
-      ROS_INFO("Loading map from image \"%s\"", mapfname.c_str());
-      map_server::loadMapFromFile(&map_resp_,mapfname.c_str(),res,negate,occ_th,free_th, origin, trinary);
-
-      map_resp_.map.info.map_load_time = ros::Time::now();
-      map_resp_.map.header.frame_id = frame_id;
-      map_resp_.map.header.stamp = ros::Time::now();
       ROS_INFO("Read a %d X %d map @ %.3lf m/cell",
                map_resp_.map.info.width,
                map_resp_.map.info.height,
@@ -277,12 +196,28 @@ class MapServer
       meta_data_message_ = map_resp_.map.info;
       map_pub.publish( map_resp_.map );
 
+      if (stat_ok){
+        loaded_path_ = fname;
+        loaded_mtime_ = buffer.st_mtim.tv_sec;
+        loaded_mtime_nsec_ = buffer.st_mtim.tv_nsec;
+        loaded_size_ = buffer.st_size;
+      }else{
+        loaded_path_.clear();
+      }
+
       return true;
     }
     /** The map data is cached here, to be sent out to service callers
      */
     nav_msgs::MapMetaData meta_data_message_;
     nav_msgs::GetMap::Response map_resp_;
+    /** The map file map_resp_ was loaded from, with its modification time
+     * and size when it was loaded
+     */
+    std::string loaded_path_;
+    time_t loaded_mtime_;
+    long loaded_mtime_nsec_;
+    off_t loaded_size_;
 
 };
 int main(int argc, char **argv)
@@ -0,0 +1,442 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+/*
+ * Loads and stores maps described by map_server YAML files, so that the
+ * map_server node and the in-process path planner share the same code.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pwd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "ros/ros.h"
+#include "map_server/image_loader.h"
+#include "map_server/map_loader.h"
+#include "yaml-cpp/yaml.h"
+
+#ifdef HAVE_NEW_YAMLCPP
+// The >> operator disappeared in yaml-cpp 0.5, so this function is
+// added to provide support for code written under the yaml-cpp 0.3 API.
+template<typename T>
+void operator >> (const YAML::Node& node, T& i)
+{
+  i = node.as<T>();
+}
+#endif
+
+namespace map_server
+{
+
+namespace
+{
+
+const char BINARY_MAP_MAGIC[8] = {'R', 'A', 'P', 'P', 'G', 'R', 'I', 'D'};
+const uint32_t BINARY_MAP_VERSION = 1;
+
+/** The header of a binary map, followed by the path of the image the map
+ * was converted from and by the width * height cells of the grid */
+struct BinaryMapHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t image_path_length;
+  double resolution;
+  double position[3];
+  double orientation[4];
+};
+
+/** True if the first file was modified at the same time as or after the
+ * second one */
+bool
+notOlder(const struct stat& a, const struct stat& b)
+{
+  if (a.st_mtim.tv_sec != b.st_mtim.tv_sec)
+    return a.st_mtim.tv_sec > b.st_mtim.tv_sec;
+  return a.st_mtim.tv_nsec >= b.st_mtim.tv_nsec;
+}
+
+/** Write the whole buffer, retrying short writes */
+bool
+writeAll(int fd, const void* buffer, size_t size)
+{
+  const char* data = static_cast<const char*>(buffer);
+  while (size > 0)
+  {
+    ssize_t written = write(fd, data, size);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+/** A part of the contents of a file */
+struct FilePart
+{
+  const void* data;
+  size_t size;
+};
+
+FilePart
+filePart(const void* data, size_t size)
+{
+  FilePart part;
+  part.data = data;
+  part.size = size;
+  return part;
+}
+
+/** Replace a file: its contents are written to a temporary file next to
+ * it, optionally synced to disk, and renamed over it, so that readers see
+ * either the old or the new contents */
+void
+replaceFile(const std::string& path, const std::vector<FilePart>& parts,
+            bool sync)
+{
+  std::vector<char> tmp_path(path.begin(), path.end());
+  const char suffix[] = ".XXXXXX";
+  tmp_path.insert(tmp_path.end(), suffix, suffix + sizeof(suffix));
+  int fd = mkstemp(&tmp_path[0]);
+  if (fd < 0)
+    throw std::runtime_error("could not create " + path + ": " + strerror(errno));
+  fchmod(fd, 0644);
+  bool written = true;
+  for (size_t i = 0; i < parts.size() && written; i++)
+    written = writeAll(fd, parts[i].data, parts[i].size);
+  if (written && sync)
+    written = fsync(fd) == 0;
+  if (close(fd) != 0)
+    written = false;
+  if (!written || rename(&tmp_path[0], path.c_str()) != 0)
+  {
+    std::string error = strerror(errno);
+    unlink(&tmp_path[0]);
+    throw std::runtime_error("could not write " + path + ": " + error);
+  }
+}
+
+/** Reject an upload whose user or map name would lead its files out of
+ * the user's maps directory */
+void
+checkUploadNames(const rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request& req)
+{
+  if (!validName(req.user_name) || !validName(req.map_name))
+    throw std::runtime_error("invalid user or map name");
+}
+
+}
+
+MapMetadata
+loadMapMetadata(const std::string& yaml_path)
+{
+  std::ifstream fin(yaml_path.c_str());
+  if (fin.fail())
+    throw std::runtime_error("could not open " + yaml_path);
+
+  MapMetadata meta;
+#ifdef HAVE_NEW_YAMLCPP
+  // The document loading process changed in yaml-cpp 0.5.
+  YAML::Node doc = YAML::Load(fin);
+#else
+  YAML::Parser parser(fin);
+  YAML::Node doc;
+  parser.GetNextDocument(doc);
+#endif
+  try {
+    doc["resolution"] >> meta.resolution;
+  } catch (YAML::Exception&) {
+    throw std::runtime_error("the map does not contain a resolution tag or it is invalid");
+  }
+  try {
+    doc["negate"] >> meta.negate;
+  } catch (YAML::Exception&) {
+    throw std::runtime_error("the map does not contain a negate tag or it is invalid");
+  }
+  try {
+    doc["occupied_thresh"] >> meta.occupied_thresh;
+  } catch (YAML::Exception&) {
+    throw std::runtime_error("the map does not contain an occupied_thresh tag or it is invalid");
+  }
+  try {
+    doc["free_thresh"] >> meta.free_thresh;
+  } catch (YAML::Exception&) {
+    throw std::runtime_error("the map does not contain a free_thresh tag or it is invalid");
+  }
+  try {
+    doc["trinary"] >> meta.trinary;
+  } catch (YAML::Exception&) {
+    ROS_DEBUG("The map does not contain a trinary tag or it is invalid... assuming true");
+    meta.trinary = true;
+  }
+  try {
+    doc["origin"][0] >> meta.origin[0];
+    doc["origin"][1] >> meta.origin[1];
+    doc["origin"][2] >> meta.origin[2];
+  } catch (YAML::Exception&) {
+    throw std::runtime_error("the map does not contain an origin tag or it is invalid");
+  }
+  try {
+    doc["image"] >> meta.image;
+  } catch (YAML::Exception&) {
+    throw std::runtime_error("the map does not contain an image tag or it is invalid");
+  }
+  // TODO: make this path-handling more robust
+  if (meta.image.size() == 0)
+    throw std::runtime_error("the image tag cannot be an empty string");
+  if (meta.image[0] != '/')
+  {
+    // dirname can modify what you pass it
+    char* fname_copy = strdup(yaml_path.c_str());
+    meta.image = std::string(dirname(fname_copy)) + '/' + meta.image;
+    free(fname_copy);
+  }
+  return meta;
+}
+
+bool
+isUserMap(const std::string& yaml_path)
+{
+  const char* homedir = getenv("HOME");
+  if (homedir == NULL)
+  {
+    struct passwd* pw = getpwuid(getuid());
+    if (pw == NULL)
+      return false;
+    homedir = pw->pw_dir;
+  }
+  std::string maps_directory = std::string(homedir) + "/rapp_platform_files/maps/";
+  return yaml_path.compare(0, maps_directory.size(), maps_directory) == 0;
+}
+
+void
+loadMap(const std::string& yaml_path, nav_msgs::OccupancyGrid* map,
+        const std::string& frame_id)
+{
+  if (!loadBinaryMap(yaml_path, map))
+  {
+    MapMetadata meta = loadMapMetadata(yaml_path);
+
+    nav_msgs::GetMap::Response resp;
+    loadMapFromFile(&resp, meta.image.c_str(), meta.resolution, meta.negate,
+                    meta.occupied_thresh, meta.free_thresh, meta.origin,
+                    meta.trinary);
+
+    map->info = resp.map.info;
+    map->data.swap(resp.map.data);
+
+    // The binary map only speeds the next loads up. The maps shipped with
+    // the platform live in the source tree, which is left untouched
+    if (isUserMap(yaml_path))
+    {
+      try
+      {
+        saveBinaryMap(yaml_path, meta.image, *map);
+      }
+      catch (std::runtime_error& e)
+      {
+        ROS_WARN_ONCE("Binary map not saved: %s", e.what());
+      }
+    }
+  }
+  map->info.map_load_time = ros::Time::now();
+  map->header.frame_id = frame_id;
+  map->header.stamp = ros::Time::now();
+}
+
+std::string
+binaryMapPath(const std::string& yaml_path)
+{
+  std::string base = yaml_path;
+  std::string::size_type dot = base.rfind('.');
+  if (dot != std::string::npos && base.find('/', dot) == std::string::npos)
+    base.erase(dot);
+  return base + ".grid";
+}
+
+bool
+loadBinaryMap(const std::string& yaml_path, nav_msgs::OccupancyGrid* map)
+{
+  std::string path = binaryMapPath(yaml_path);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat grid_stat, yaml_stat;
+  if (fstat(fd, &grid_stat) != 0 ||
+      (size_t) grid_stat.st_size < sizeof(BinaryMapHeader) ||
+      stat(yaml_path.c_str(), &yaml_stat) != 0 ||
+      !notOlder(grid_stat, yaml_stat))
+  {
+    close(fd);
+    return false;
+  }
+  void* data = mmap(NULL, grid_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping outlives the descriptor
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  const BinaryMapHeader& header = *static_cast<const BinaryMapHeader*>(data);
+  const char* image_path = static_cast<const char*>(data) + sizeof(header);
+  size_t cells = (size_t) header.width * header.height;
+  struct stat image_stat;
+  bool valid =
+      memcmp(header.magic, BINARY_MAP_MAGIC, sizeof(BINARY_MAP_MAGIC)) == 0 &&
+      header.version == BINARY_MAP_VERSION &&
+      (size_t) grid_stat.st_size ==
+          sizeof(header) + header.image_path_length + cells &&
+      stat(std::string(image_path, header.image_path_length).c_str(),
+           &image_stat) == 0 &&
+      notOlder(grid_stat, image_stat);
+  if (valid)
+  {
+    map->info.width = header.width;
+    map->info.height = header.height;
+    map->info.resolution = header.resolution;
+    map->info.origin.position.x = header.position[0];
+    map->info.origin.position.y = header.position[1];
+    map->info.origin.position.z = header.position[2];
+    map->info.origin.orientation.x = header.orientation[0];
+    map->info.origin.orientation.y = header.orientation[1];
+    map->info.origin.orientation.z = header.orientation[2];
+    map->info.origin.orientation.w = header.orientation[3];
+    const int8_t* grid = reinterpret_cast<const int8_t*>(
+        image_path + header.image_path_length);
+    map->data.assign(grid, grid + cells);
+  }
+  munmap(data, grid_stat.st_size);
+  return valid;
+}
+
+void
+saveBinaryMap(const std::string& yaml_path, const std::string& image_path,
+              const nav_msgs::OccupancyGrid& map)
+{
+  BinaryMapHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BINARY_MAP_MAGIC, sizeof(BINARY_MAP_MAGIC));
+  header.version = BINARY_MAP_VERSION;
+  header.width = map.info.width;
+  header.height = map.info.height;
+  header.image_path_length = image_path.size();
+  header.resolution = map.info.resolution;
+  header.position[0] = map.info.origin.position.x;
+  header.position[1] = map.info.origin.position.y;
+  header.position[2] = map.info.origin.position.z;
+  header.orientation[0] = map.info.origin.orientation.x;
+  header.orientation[1] = map.info.origin.orientation.y;
+  header.orientation[2] = map.info.origin.orientation.z;
+  header.orientation[3] = map.info.origin.orientation.w;
+  size_t cells = (size_t) header.width * header.height;
+  if (map.data.size() != cells)
+    throw std::runtime_error("the map data does not match its size");
+
+  std::vector<FilePart> parts;
+  parts.push_back(filePart(&header, sizeof(header)));
+  parts.push_back(filePart(image_path.data(), image_path.size()));
+  if (cells > 0)
+    parts.push_back(filePart(&map.data[0], cells));
+  replaceFile(binaryMapPath(yaml_path), parts, false);
+}
+
+bool
+validName(const std::string& name)
+{
+  return !name.empty() && name[0] != '.' && name.find('/') == std::string::npos;
+}
+
+std::string
+saveUploadedMap(const std::string& directory,
+    const rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request& req)
+{
+  // The callers build the directory from the user name
+  checkUploadNames(req);
+  boost::filesystem::create_directories(directory);
+
+  // The image is binary, thus its size is the declared one and not the
+  // position of its first zero byte
+  std::string png_path = directory+"/"+req.map_name+".png";
+  size_t size = std::min<size_t>(req.file_size, req.data.size());
+  std::vector<FilePart> parts;
+  if (size > 0)
+    parts.push_back(filePart(&req.data[0], size));
+  replaceFile(png_path, parts, true);
+
+  return saveUploadedMapDescription(directory, req);
+}
+
+std::string
+saveUploadedMapDescription(const std::string& directory,
+    const rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request& req)
+{
+  checkUploadNames(req);
+
+  YAML::Node yaml_node;
+  yaml_node["image"] = req.map_name+".png";
+  yaml_node["resolution"] = req.resolution;
+  yaml_node["origin"] = req.origin;
+  yaml_node["negate"] = req.negate;
+  yaml_node["occupied_thresh"] = req.occupied_thresh;
+  yaml_node["free_thresh"] = req.free_thresh;
+  std::ostringstream yaml;
+  yaml << yaml_node;
+  std::string contents = yaml.str();
+
+  // The YAML file is written last, thus its modification time tells the
+  // map's caches when the whole map was replaced
+  std::string yaml_path = directory+"/"+req.map_name+".yaml";
+  std::vector<FilePart> parts;
+  parts.push_back(filePart(contents.data(), contents.size()));
+  replaceFile(yaml_path, parts, true);
+
+  // Loading the map writes its binary form
+  try
+  {
+    nav_msgs::OccupancyGrid map;
+    loadMap(yaml_path, &map);
+  }
+  catch (std::runtime_error& e)
+  {
+    ROS_WARN("Uploaded map %s could not be converted: %s", yaml_path.c_str(), e.what());
+  }
+  return yaml_path;
+}
+
+}
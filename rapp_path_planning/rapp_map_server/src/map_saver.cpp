@@ -29,11 +29,14 @@
  */
 
 #include <cstdio>
+#include <cstring>
+#include <stdexcept>
 #include "ros/ros.h"
 #include "ros/console.h"
 #include "nav_msgs/GetMap.h"
 #include "tf/LinearMath/Matrix3x3.h"
 #include "geometry_msgs/Quaternion.h"
+#include "map_server/map_loader.h"
 
 using namespace std;
  
@@ -106,11 +109,41 @@ free_thresh: 0.196
       double yaw, pitch, roll;
       mat.getEulerYPR(yaw, pitch, roll);
 
+      // The image is found relative to the YAML file, which is next to it
+      std::string mapdatafile_name = mapdatafile.substr(mapdatafile.find_last_of('/') + 1);
       fprintf(yaml, "image: %s\nresolution: %f\norigin: [%f, %f, %f]\nnegate: 0\noccupied_thresh: 0.65\nfree_thresh: 0.196\n\n",
-              mapdatafile.c_str(), map->info.resolution, map->info.origin.position.x, map->info.origin.position.y, yaw);
+              mapdatafile_name.c_str(), map->info.resolution, map->info.origin.position.x, map->info.origin.position.y, yaw);
 
       fclose(yaml);
 
+      // The binary map holds the map as it is read back from the image:
+      // the image only keeps free, occupied and unknown cells
+      nav_msgs::OccupancyGrid saved_map;
+      saved_map.info = map->info;
+      saved_map.info.origin.position.z = 0.0;
+      tf::Quaternion q;
+      q.setRPY(0, 0, yaw);
+      saved_map.info.origin.orientation.x = q.x();
+      saved_map.info.origin.orientation.y = q.y();
+      saved_map.info.origin.orientation.z = q.z();
+      saved_map.info.origin.orientation.w = q.w();
+      saved_map.data.resize(map->data.size());
+      for(size_t i = 0; i < map->data.size(); i++) {
+        if (map->data[i] == 0 || map->data[i] == +100)
+          saved_map.data[i] = map->data[i];
+        else
+          saved_map.data[i] = -1;
+      }
+      ROS_INFO("Writing the binary map to %s", map_server::binaryMapPath(mapmetadatafile).c_str());
+      try
+      {
+        map_server::saveBinaryMap(mapmetadatafile, mapdatafile, saved_map);
+      }
+      catch(std::runtime_error& e)
+      {
+        ROS_ERROR("Couldn't save the binary map: %s", e.what());
+      }
+
       ROS_INFO("Done\n");
       saved_map_ = true;
     }
@@ -0,0 +1,320 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "map_server/map_loader.h"
+#include "map_server/map_uploader.h"
+
+namespace map_server
+{
+
+typedef rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request ChunkRequest;
+typedef rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Response ChunkResponse;
+
+namespace
+{
+
+/** True if the name is the one of an upload's temporary file,
+ * <map_name>.png.XXXXXX */
+bool
+tmpName(const std::string& name)
+{
+  const std::string suffix = ".png.XXXXXX";
+  return name.size() > suffix.size() &&
+      name.compare(name.size() - suffix.size(), 5, ".png.") == 0;
+}
+
+}
+
+MapUploader::MapUploader(const std::string& maps_directory, double timeout) :
+  maps_directory_(maps_directory),
+  timeout_(timeout),
+  next_id_(0)
+{
+  removeStaleFiles();
+}
+
+MapUploader::~MapUploader(void)
+{
+  for (std::map<std::string, Upload>::iterator it = uploads_.begin();
+       it != uploads_.end(); ++it)
+    discard(it->second);
+}
+
+std::string
+MapUploader::handle(const ChunkRequest& req, ChunkResponse* res)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  expire();
+  res->status = false;
+  res->upload_id = req.upload_id;
+  res->received = 0;
+  res->error.clear();
+
+  std::string yaml_path;
+  try
+  {
+    if (req.action == ChunkRequest::BEGIN)
+    {
+      res->upload_id = begin(req);
+    }
+    else
+    {
+      std::map<std::string, Upload>::iterator it = uploads_.find(req.upload_id);
+      // The ids are sequential, thus an upload only serves its own user
+      if (it == uploads_.end() || it->second.description.user_name != req.user_name)
+        throw std::runtime_error("unknown upload " + req.upload_id);
+      Upload& upload = it->second;
+      upload.last_activity = ros::WallTime::now();
+      res->received = upload.received;
+      if (req.action == ChunkRequest::APPEND)
+      {
+        try
+        {
+          append(upload, req);
+        }
+        catch (std::runtime_error&)
+        {
+          // The part of the chunk written before the failure is kept, the
+          // client resumes after it
+          res->received = upload.received;
+          throw;
+        }
+        res->received = upload.received;
+      }
+      else if (req.action == ChunkRequest::COMMIT)
+      {
+        try
+        {
+          commit(upload, req);
+        }
+        catch (std::runtime_error&)
+        {
+          // A commit fails either before the image is complete, and the
+          // upload goes on, or for good, and its file is closed
+          if (upload.fd < 0)
+            uploads_.erase(it);
+          throw;
+        }
+        Upload committed = upload;
+        uploads_.erase(it);
+
+        // The map is described and converted without the lock, thus a large
+        // map does not hold up the other uploads
+        lock.unlock();
+        yaml_path = saveUploadedMapDescription(committed.directory, committed.description);
+        ROS_INFO("User: %s saved map: %s, size of the map: %lu bytes",
+                 committed.description.user_name.c_str(), yaml_path.c_str(),
+                 (unsigned long) committed.received);
+      }
+      else if (req.action == ChunkRequest::ABORT)
+      {
+        discard(upload);
+        uploads_.erase(it);
+      }
+      else
+      {
+        throw std::runtime_error("unknown action");
+      }
+    }
+    res->status = true;
+  }
+  catch (std::runtime_error& e)
+  {
+    ROS_ERROR("Map upload %s failed: %s", req.upload_id.c_str(), e.what());
+    res->error = e.what();
+  }
+  return yaml_path;
+}
+
+std::string
+MapUploader::begin(const ChunkRequest& req)
+{
+  if (!validName(req.user_name) || !validName(req.map_name))
+    throw std::runtime_error("invalid user or map name");
+
+  Upload upload;
+  upload.description.user_name = req.user_name;
+  upload.description.map_name = req.map_name;
+  upload.description.resolution = req.resolution;
+  upload.description.origin = req.origin;
+  upload.description.negate = req.negate;
+  upload.description.occupied_thresh = req.occupied_thresh;
+  upload.description.free_thresh = req.free_thresh;
+  upload.directory = maps_directory_ + "/" + req.user_name;
+  upload.received = 0;
+  upload.last_activity = ros::WallTime::now();
+
+  // The temporary file is next to the image, thus it is renamed over it
+  // within the same file system
+  boost::filesystem::create_directories(upload.directory);
+  std::string png_path = upload.directory + "/" + req.map_name + ".png";
+  std::vector<char> tmp_path(png_path.begin(), png_path.end());
+  const char suffix[] = ".XXXXXX";
+  tmp_path.insert(tmp_path.end(), suffix, suffix + sizeof(suffix));
+  upload.fd = mkstemp(&tmp_path[0]);
+  if (upload.fd < 0)
+    throw std::runtime_error("could not create " + png_path + ": " + strerror(errno));
+  fchmod(upload.fd, 0644);
+  upload.tmp_path = &tmp_path[0];
+
+  std::string id = boost::lexical_cast<std::string>(++next_id_);
+  uploads_[id] = upload;
+  ROS_INFO("User: %s began uploading map: %s (upload %s)",
+           req.user_name.c_str(), req.map_name.c_str(), id.c_str());
+  return id;
+}
+
+void
+MapUploader::append(Upload& upload, const ChunkRequest& req)
+{
+  // A chunk lost or repeated by the client is rejected, the client
+  // resumes from the received bytes of the response
+  if (req.offset != upload.received)
+    throw std::runtime_error("chunk at offset " +
+        boost::lexical_cast<std::string>(req.offset) + ", expected " +
+        boost::lexical_cast<std::string>(upload.received));
+
+  const unsigned char* data = req.data.empty() ? NULL : &req.data[0];
+  size_t size = req.data.size();
+  while (size > 0)
+  {
+    ssize_t written = write(upload.fd, data, size);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      // The file may hold part of the chunk, thus the upload is rewound
+      // to the bytes accounted for
+      std::string error = strerror(errno);
+      if (ftruncate(upload.fd, upload.received) != 0 ||
+          lseek(upload.fd, upload.received, SEEK_SET) < 0)
+        throw std::runtime_error("could not rewind " + upload.tmp_path);
+      throw std::runtime_error("could not write " + upload.tmp_path + ": " + error);
+    }
+    upload.crc.process_bytes(data, written);
+    upload.received += written;
+    data += written;
+    size -= written;
+  }
+}
+
+void
+MapUploader::commit(Upload& upload, const ChunkRequest& req)
+{
+  if (upload.received != req.file_size)
+    throw std::runtime_error("received " +
+        boost::lexical_cast<std::string>(upload.received) + " bytes of " +
+        boost::lexical_cast<std::string>(req.file_size));
+  if (upload.crc.checksum() != req.crc32)
+  {
+    // The image is corrupt, the client uploads it again
+    discard(upload);
+    throw std::runtime_error("checksum mismatch, upload dropped");
+  }
+
+  int fd = upload.fd;
+  upload.fd = -1;
+  bool synced = fsync(fd) == 0;
+  if (close(fd) != 0)
+    synced = false;
+  std::string png_path = upload.directory + "/" + upload.description.map_name + ".png";
+  if (!synced || rename(upload.tmp_path.c_str(), png_path.c_str()) != 0)
+  {
+    std::string error = strerror(errno);
+    discard(upload);
+    throw std::runtime_error("could not write " + png_path + ": " + error);
+  }
+  upload.tmp_path.clear();
+}
+
+void
+MapUploader::discard(Upload& upload)
+{
+  if (upload.fd >= 0)
+  {
+    close(upload.fd);
+    upload.fd = -1;
+  }
+  if (!upload.tmp_path.empty())
+  {
+    unlink(upload.tmp_path.c_str());
+    upload.tmp_path.clear();
+  }
+}
+
+void
+MapUploader::removeStaleFiles(void)
+{
+  // The temporary files of uploads cut short by a crash or a restart. Files
+  // modified within the timeout are kept, they may belong to an upload of
+  // another node sharing the maps directory
+  namespace fs = boost::filesystem;
+  boost::system::error_code error;
+  time_t stale = time(NULL) - (time_t) timeout_;
+  for (fs::directory_iterator user(maps_directory_, error), end;
+       !error && user != end; user.increment(error))
+  {
+    boost::system::error_code user_error;
+    if (!fs::is_directory(user->path(), user_error))
+      continue;
+    for (fs::directory_iterator file(user->path(), user_error);
+         !user_error && file != end; file.increment(user_error))
+    {
+      boost::system::error_code file_error;
+      if (!tmpName(file->path().filename().string()) ||
+          fs::last_write_time(file->path(), file_error) > stale || file_error)
+        continue;
+      if (fs::remove(file->path(), file_error))
+        ROS_INFO("Removed stale map upload %s", file->path().string().c_str());
+    }
+  }
+}
+
+void
+MapUploader::expire(void)
+{
+  ros::WallTime now = ros::WallTime::now();
+  std::map<std::string, Upload>::iterator it = uploads_.begin();
+  while (it != uploads_.end())
+  {
+    if ((now - it->second.last_activity).toSec() > timeout_)
+    {
+      ROS_WARN("Map upload %s timed out", it->first.c_str());
+      discard(it->second);
+      uploads_.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+}
@@ -0,0 +1,177 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ros/ros.h"
+#include "map_server/image_loader.h"
+
+/**
+ * @brief Returns the milliseconds elapsed since the given wall time
+ */
+double elapsedMs(ros::WallTime start)
+{
+  return (ros::WallTime::now() - start).toSec() * 1000.0;
+}
+
+/**
+ * @brief The per-pixel conversion loadMapFromFile used before the lookup
+ * table, kept as the reference the table is checked against
+ */
+void convertReference(const unsigned char* pixels, unsigned int width,
+  unsigned int height, int rowstride, int n_channels, bool negate,
+  double occ_th, double free_th, bool trinary, int8_t* data)
+{
+  int avg_channels;
+  if (trinary || n_channels == 1)
+    avg_channels = n_channels;
+  else
+    avg_channels = n_channels - 1;
+
+  for(unsigned int j = 0; j < height; j++)
+  {
+    for (unsigned int i = 0; i < width; i++)
+    {
+      const unsigned char* p = pixels + j*rowstride + i*n_channels;
+      int color_sum = 0;
+      for(int k = 0; k < avg_channels; k++)
+        color_sum += *(p + (k));
+      double color_avg = color_sum / (double)avg_channels;
+
+      int alpha;
+      if (n_channels == 1)
+          alpha = 1;
+      else
+          alpha = *(p+n_channels-1);
+
+      double occ;
+      if(negate)
+        occ = color_avg / 255.0;
+      else
+        occ = (255 - color_avg) / 255.0;
+
+      unsigned char value;
+      if(occ > occ_th)
+        value = +100;
+      else if(occ < free_th)
+        value = 0;
+      else if(trinary || alpha < 1.0)
+        value = -1;
+      else {
+        double ratio = (occ - free_th) / (occ_th - free_th);
+        value = 99 * ratio;
+      }
+
+      data[width * (height - j - 1) + i] = value;
+    }
+  }
+}
+
+/**
+ * @brief Builds the pixels of a floor plan: free rooms, walls every 200
+ * pixels, an unknown area and some noise. The alpha channel of 2 and 4
+ * channel images has transparent spots.
+ * @param width [unsigned int] The image's width
+ * @param height [unsigned int] The image's height
+ * @param n_channels [int] The number of channels
+ * @return [std::vector<unsigned char>] The pixels, rows top to bottom
+ */
+std::vector<unsigned char> makeFloorPlan(unsigned int width,
+  unsigned int height, int n_channels)
+{
+  std::vector<unsigned char> pixels((size_t) width * height * n_channels);
+  srand(42);
+  size_t k = 0;
+  for(unsigned int j = 0; j < height; j++)
+  {
+    for(unsigned int i = 0; i < width; i++)
+    {
+      unsigned char gray = 254;
+      if(i % 200 < 4 || j % 200 < 4)
+        gray = 0;
+      else if(i < width / 8 && j < height / 8)
+        gray = 205;
+      else if(rand() % 50 == 0)
+        gray = rand() % 256;
+      for(int c = 0; c < n_channels; c++)
+        pixels[k + c] = gray;
+      if(n_channels == 2 || n_channels == 4)
+        pixels[k + n_channels - 1] = rand() % 100 == 0 ? 0 : 255;
+      k += n_channels;
+    }
+  }
+  return pixels;
+}
+
+/**
+ * @brief Times the reference and the table driven conversion of a floor
+ * plan, checking that both yield the same map
+ */
+void benchmark(unsigned int size, int n_channels, bool trinary,
+  int iterations)
+{
+  std::vector<unsigned char> pixels = makeFloorPlan(size, size, n_channels);
+  std::vector<int8_t> reference((size_t) size * size), converted(reference.size());
+
+  double reference_ms = 0, converted_ms = 0;
+  for(int i = 0; i < iterations; i++)
+  {
+    ros::WallTime start = ros::WallTime::now();
+    convertReference(&pixels[0], size, size, size * n_channels, n_channels,
+      false, 0.65, 0.196, trinary, &reference[0]);
+    reference_ms += elapsedMs(start);
+
+    start = ros::WallTime::now();
+    map_server::convertPixels(&pixels[0], size, size, size * n_channels,
+      n_channels, false, 0.65, 0.196, trinary, &converted[0]);
+    converted_ms += elapsedMs(start);
+  }
+  printf("%5ux%-5u %d ch %-8s per-pixel %9.2f ms  table %9.2f ms  %5.1fx  %s\n",
+    size, size, n_channels, trinary ? "trinary" : "scale",
+    reference_ms / iterations, converted_ms / iterations,
+    reference_ms / converted_ms,
+    reference == converted ? "identical" : "MISMATCH");
+}
+
+/**
+ * @brief Compares the per-pixel conversion of map images to occupancy
+ * values against the lookup table conversion, on 4k x 4k and 10k x 10k
+ * floor plans of 1, 3 and 4 channels.
+ * Usage: map_server_benchmark [iterations]
+ */
+int main(int argc, char **argv)
+{
+  int iterations = 3;
+  if(argc > 1)
+  {
+    iterations = atoi(argv[1]);
+  }
+
+  unsigned int sizes[] = {4096, 10000};
+  int channels[] = {1, 3, 4};
+  for(unsigned int s = 0; s < 2; s++)
+  {
+    for(unsigned int c = 0; c < 3; c++)
+    {
+      benchmark(sizes[s], channels[c], true, iterations);
+      benchmark(sizes[s], channels[c], false, iterations);
+    }
+  }
+  return 0;
+}
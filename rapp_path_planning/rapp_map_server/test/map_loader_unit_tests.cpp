@@ -0,0 +1,196 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <ctime>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+#include <ros/package.h>
+
+#include "map_server/map_loader.h"
+
+/**
+ * @class BinaryMapTest
+ * @brief Writes and reads the binary form of a map in a temporary directory
+ */
+class BinaryMapTest : public ::testing::Test
+{
+  protected:
+
+    /**
+     * @brief Default constructor
+     */
+    BinaryMapTest()
+    {
+    }
+
+    /**
+     * @brief Copies a map image and describes it in a new temporary directory
+     */
+    virtual void SetUp()
+    {
+      directory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+      boost::filesystem::create_directories(directory_);
+      yaml_path_ = (directory_ / "map.yaml").string();
+      image_path_ = (directory_ / "map.png").string();
+      boost::filesystem::copy_file(
+          ros::package::getPath("rapp_map_server") + "/maps/empty.png", image_path_);
+      std::ofstream(yaml_path_.c_str()) << "image: map.png" << std::endl
+        << "resolution: 0.02" << std::endl << "origin: [1.0, 2.0, 0.0]" << std::endl
+        << "negate: 0" << std::endl << "occupied_thresh: 0.65" << std::endl
+        << "free_thresh: 0.196" << std::endl;
+
+      map_.info.width = 4;
+      map_.info.height = 3;
+      map_.info.resolution = 0.02;
+      map_.info.origin.position.x = 1.0;
+      map_.info.origin.position.y = 2.0;
+      map_.info.origin.orientation.w = 1.0;
+      for (int i = 0; i < 12; i++)
+        map_.data.push_back(i % 3 == 0 ? 100 : (i % 3 == 1 ? 0 : -1));
+    }
+
+    /**
+     * @brief Removes the temporary directory
+     */
+    virtual void TearDown()
+    {
+      boost::filesystem::remove_all(directory_);
+    }
+
+    /**
+     * @brief Sets the modification time of a file to the given seconds from now
+     */
+    void touch(const std::string& path, int seconds)
+    {
+      boost::filesystem::last_write_time(path, time(NULL) + seconds);
+    }
+
+    boost::filesystem::path directory_; /**< The temporary directory */
+    std::string yaml_path_; /**< The map YAML file */
+    std::string image_path_; /**< The map image */
+    nav_msgs::OccupancyGrid map_; /**< A small map, with occupied, free and unknown cells */
+};
+
+/**
+ * @brief Tests that a binary map is read back as it was written
+ */
+TEST_F(BinaryMapTest, save_load_test)
+{
+  touch(yaml_path_, -10);
+  touch(image_path_, -10);
+  map_server::saveBinaryMap(yaml_path_, image_path_, map_);
+  EXPECT_EQ((directory_ / "map.grid").string(), map_server::binaryMapPath(yaml_path_));
+
+  nav_msgs::OccupancyGrid map;
+  ASSERT_TRUE(map_server::loadBinaryMap(yaml_path_, &map));
+  EXPECT_EQ(4, map.info.width);
+  EXPECT_EQ(3, map.info.height);
+  EXPECT_FLOAT_EQ(0.02, map.info.resolution);
+  EXPECT_EQ(1.0, map.info.origin.position.x);
+  EXPECT_EQ(2.0, map.info.origin.position.y);
+  EXPECT_EQ(1.0, map.info.origin.orientation.w);
+  EXPECT_TRUE(map_.data == map.data);
+}
+
+/**
+ * @brief Tests that a binary map older than its YAML file is ignored
+ */
+TEST_F(BinaryMapTest, modified_yaml_test)
+{
+  touch(image_path_, -10);
+  map_server::saveBinaryMap(yaml_path_, image_path_, map_);
+  touch(yaml_path_, 10);
+  nav_msgs::OccupancyGrid map;
+  EXPECT_FALSE(map_server::loadBinaryMap(yaml_path_, &map));
+}
+
+/**
+ * @brief Tests that a binary map older than its image is ignored
+ */
+TEST_F(BinaryMapTest, modified_image_test)
+{
+  touch(yaml_path_, -10);
+  map_server::saveBinaryMap(yaml_path_, image_path_, map_);
+  touch(image_path_, 10);
+  nav_msgs::OccupancyGrid map;
+  EXPECT_FALSE(map_server::loadBinaryMap(yaml_path_, &map));
+}
+
+/**
+ * @brief Tests that missing and truncated binary maps are ignored
+ */
+TEST_F(BinaryMapTest, broken_test)
+{
+  nav_msgs::OccupancyGrid map;
+  EXPECT_FALSE(map_server::loadBinaryMap(yaml_path_, &map));
+
+  touch(yaml_path_, -10);
+  touch(image_path_, -10);
+  map_server::saveBinaryMap(yaml_path_, image_path_, map_);
+  std::string grid_path = map_server::binaryMapPath(yaml_path_);
+  boost::filesystem::resize_file(grid_path, boost::filesystem::file_size(grid_path) - 1);
+  EXPECT_FALSE(map_server::loadBinaryMap(yaml_path_, &map));
+}
+
+/**
+ * @brief Tests that loading a map outside the users' maps does not write its binary form
+ */
+TEST_F(BinaryMapTest, not_user_map_test)
+{
+  EXPECT_FALSE(map_server::isUserMap(yaml_path_));
+  nav_msgs::OccupancyGrid map;
+  map_server::loadMap(yaml_path_, &map);
+  EXPECT_FALSE(map.data.empty());
+  EXPECT_FALSE(boost::filesystem::exists(map_server::binaryMapPath(yaml_path_)));
+}
+
+/**
+ * @brief Tests that uploaded maps whose user or map name would leave the user's maps
+ * directory are rejected before anything is written
+ */
+TEST_F(BinaryMapTest, invalid_upload_name_test)
+{
+  EXPECT_TRUE(map_server::validName("user"));
+  EXPECT_FALSE(map_server::validName(""));
+  EXPECT_FALSE(map_server::validName(".."));
+  EXPECT_FALSE(map_server::validName("../user"));
+  EXPECT_FALSE(map_server::validName("user/map"));
+
+  rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request req;
+  req.user_name = "user";
+  req.map_name = "../escaped";
+  std::string directory = (directory_ / "user").string();
+  EXPECT_THROW(map_server::saveUploadedMap(directory, req), std::runtime_error);
+  EXPECT_THROW(map_server::saveUploadedMapDescription(directory, req), std::runtime_error);
+  req.user_name = "..";
+  req.map_name = "map";
+  EXPECT_THROW(map_server::saveUploadedMap(directory, req), std::runtime_error);
+  EXPECT_FALSE(boost::filesystem::exists(directory));
+  EXPECT_FALSE(boost::filesystem::exists(directory_ / "escaped.yaml"));
+}
+
+/**
+ * @brief The main function. Initializes the unit tests
+ */
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,338 @@
+/******************************************************************************
+Copyright 2016 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <ros/package.h>
+
+#include "map_server/map_uploader.h"
+
+typedef rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request ChunkRequest;
+typedef rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Response ChunkResponse;
+
+/**
+ * @class MapUploaderTest
+ * @brief Uploads a map image in chunks into a temporary maps directory
+ */
+class MapUploaderTest : public ::testing::Test
+{
+  protected:
+
+    /**
+     * @brief Default constructor
+     */
+    MapUploaderTest()
+    {
+    }
+
+    /**
+     * @brief Creates the temporary maps directory and reads the uploaded image
+     */
+    virtual void SetUp()
+    {
+      directory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+      boost::filesystem::create_directories(directory_);
+      std::string image_path = ros::package::getPath("rapp_map_server") + "/maps/empty.png";
+      std::ifstream image(image_path.c_str(), std::ios::binary);
+      image_.assign(std::istreambuf_iterator<char>(image), std::istreambuf_iterator<char>());
+      crc_.process_bytes(&image_[0], image_.size());
+    }
+
+    /**
+     * @brief Removes the temporary maps directory
+     */
+    virtual void TearDown()
+    {
+      boost::filesystem::remove_all(directory_);
+    }
+
+    /**
+     * @brief Begins the upload of the map "map" of the user "user"
+     * @return The response
+     */
+    ChunkResponse begin(map_server::MapUploader& uploader)
+    {
+      ChunkRequest req;
+      req.action = ChunkRequest::BEGIN;
+      req.user_name = "user";
+      req.map_name = "map";
+      req.resolution = 0.02;
+      req.origin.resize(3, 0.0);
+      req.occupied_thresh = 0.65;
+      req.free_thresh = 0.196;
+      ChunkResponse res;
+      uploader.handle(req, &res);
+      return res;
+    }
+
+    /**
+     * @brief Appends the image bytes [begin, end) at the given offset
+     * @return The response
+     */
+    ChunkResponse append(map_server::MapUploader& uploader, const std::string& upload_id,
+                         size_t offset, size_t begin, size_t end)
+    {
+      ChunkRequest req;
+      req.action = ChunkRequest::APPEND;
+      req.upload_id = upload_id;
+      req.user_name = "user";
+      req.offset = offset;
+      req.data.assign(image_.begin() + begin, image_.begin() + end);
+      ChunkResponse res;
+      uploader.handle(req, &res);
+      return res;
+    }
+
+    /**
+     * @brief Sends a request without data, such as a commit or an abort
+     * @return The response
+     */
+    ChunkResponse finish(map_server::MapUploader& uploader, const std::string& upload_id,
+                         unsigned char action, unsigned int crc32, std::string* yaml_path = NULL)
+    {
+      ChunkRequest req;
+      req.action = action;
+      req.upload_id = upload_id;
+      req.user_name = "user";
+      req.file_size = image_.size();
+      req.crc32 = crc32;
+      ChunkResponse res;
+      std::string path = uploader.handle(req, &res);
+      if (yaml_path != NULL)
+        *yaml_path = path;
+      return res;
+    }
+
+    /**
+     * @brief Counts the temporary files of the uploads of "map"
+     */
+    int tmpFiles()
+    {
+      int files = 0;
+      boost::filesystem::path user = directory_ / "user";
+      if (!boost::filesystem::is_directory(user))
+        return 0;
+      for (boost::filesystem::directory_iterator file(user), end; file != end; ++file)
+        if (file->path().filename().string().compare(0, 8, "map.png.") == 0)
+          files++;
+      return files;
+    }
+
+    /**
+     * @brief True if the user's file holds the uploaded image
+     */
+    bool holdsImage(const std::string& name)
+    {
+      std::string path = (directory_ / "user" / name).string();
+      std::ifstream file(path.c_str(), std::ios::binary);
+      std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      return data == image_;
+    }
+
+    boost::filesystem::path directory_; /**< The temporary maps directory */
+    std::vector<char> image_; /**< The uploaded map image */
+    boost::crc_32_type crc_; /**< CRC-32 of the image */
+};
+
+/**
+ * @brief Tests that an image appended in chunks is committed into place with its description
+ */
+TEST_F(MapUploaderTest, commit_test)
+{
+  map_server::MapUploader uploader(directory_.string());
+  ChunkResponse res = begin(uploader);
+  ASSERT_TRUE(res.status);
+  std::string id = res.upload_id;
+  EXPECT_EQ(1, tmpFiles());
+
+  size_t half = image_.size() / 2;
+  res = append(uploader, id, 0, 0, half);
+  EXPECT_TRUE(res.status);
+  EXPECT_EQ(half, res.received);
+  res = append(uploader, id, half, half, image_.size());
+  EXPECT_TRUE(res.status);
+  EXPECT_EQ(image_.size(), res.received);
+
+  std::string yaml_path;
+  res = finish(uploader, id, ChunkRequest::COMMIT, crc_.checksum(), &yaml_path);
+  EXPECT_TRUE(res.status);
+  EXPECT_EQ((directory_ / "user" / "map.yaml").string(), yaml_path);
+  EXPECT_TRUE(boost::filesystem::exists(yaml_path));
+  EXPECT_TRUE(holdsImage("map.png"));
+  EXPECT_EQ(0, tmpFiles());
+
+  // The upload is over
+  res = append(uploader, id, image_.size(), 0, 1);
+  EXPECT_FALSE(res.status);
+}
+
+/**
+ * @brief Tests that chunks at another offset than the received bytes are rejected
+ */
+TEST_F(MapUploaderTest, offset_test)
+{
+  map_server::MapUploader uploader(directory_.string());
+  std::string id = begin(uploader).upload_id;
+  size_t half = image_.size() / 2;
+  ASSERT_TRUE(append(uploader, id, 0, 0, half).status);
+
+  // A repeated chunk
+  ChunkResponse res = append(uploader, id, 0, 0, half);
+  EXPECT_FALSE(res.status);
+  EXPECT_EQ(half, res.received);
+  EXPECT_FALSE(res.error.empty());
+  // A lost chunk
+  res = append(uploader, id, half + 1, half + 1, image_.size());
+  EXPECT_FALSE(res.status);
+  EXPECT_EQ(half, res.received);
+
+  // The upload resumes from the received bytes
+  res = append(uploader, id, half, half, image_.size());
+  EXPECT_TRUE(res.status);
+  EXPECT_TRUE(finish(uploader, id, ChunkRequest::COMMIT, crc_.checksum()).status);
+  EXPECT_TRUE(holdsImage("map.png"));
+}
+
+/**
+ * @brief Tests that an incomplete upload is not committed and goes on
+ */
+TEST_F(MapUploaderTest, incomplete_commit_test)
+{
+  map_server::MapUploader uploader(directory_.string());
+  std::string id = begin(uploader).upload_id;
+  size_t half = image_.size() / 2;
+  append(uploader, id, 0, 0, half);
+
+  ChunkResponse res = finish(uploader, id, ChunkRequest::COMMIT, crc_.checksum());
+  EXPECT_FALSE(res.status);
+  EXPECT_EQ(half, res.received);
+  EXPECT_FALSE(boost::filesystem::exists(directory_ / "user" / "map.png"));
+
+  EXPECT_TRUE(append(uploader, id, half, half, image_.size()).status);
+  EXPECT_TRUE(finish(uploader, id, ChunkRequest::COMMIT, crc_.checksum()).status);
+}
+
+/**
+ * @brief Tests that an upload whose checksum does not match is dropped
+ */
+TEST_F(MapUploaderTest, crc_mismatch_test)
+{
+  map_server::MapUploader uploader(directory_.string());
+  std::string id = begin(uploader).upload_id;
+  append(uploader, id, 0, 0, image_.size());
+
+  ChunkResponse res = finish(uploader, id, ChunkRequest::COMMIT, crc_.checksum() ^ 1);
+  EXPECT_FALSE(res.status);
+  EXPECT_FALSE(boost::filesystem::exists(directory_ / "user" / "map.png"));
+  EXPECT_EQ(0, tmpFiles());
+  EXPECT_FALSE(finish(uploader, id, ChunkRequest::COMMIT, crc_.checksum()).status);
+}
+
+/**
+ * @brief Tests that an aborted upload is dropped with its temporary file
+ */
+TEST_F(MapUploaderTest, abort_test)
+{
+  map_server::MapUploader uploader(directory_.string());
+  std::string id = begin(uploader).upload_id;
+  append(uploader, id, 0, 0, image_.size());
+
+  EXPECT_TRUE(finish(uploader, id, ChunkRequest::ABORT, 0).status);
+  EXPECT_EQ(0, tmpFiles());
+  EXPECT_FALSE(finish(uploader, id, ChunkRequest::COMMIT, crc_.checksum()).status);
+  EXPECT_FALSE(boost::filesystem::exists(directory_ / "user" / "map.png"));
+}
+
+/**
+ * @brief Tests that uploads are bound to their user and that invalid names are rejected
+ */
+TEST_F(MapUploaderTest, user_test)
+{
+  map_server::MapUploader uploader(directory_.string());
+  std::string id = begin(uploader).upload_id;
+  ChunkRequest req;
+  req.action = ChunkRequest::APPEND;
+  req.upload_id = id;
+  req.user_name = "other";
+  req.offset = 0;
+  req.data.assign(image_.begin(), image_.end());
+  ChunkResponse res;
+  uploader.handle(req, &res);
+  EXPECT_FALSE(res.status);
+
+  req.action = ChunkRequest::BEGIN;
+  req.user_name = "user";
+  req.map_name = "../map";
+  uploader.handle(req, &res);
+  EXPECT_FALSE(res.status);
+  req.user_name = "..";
+  req.map_name = "map";
+  uploader.handle(req, &res);
+  EXPECT_FALSE(res.status);
+}
+
+/**
+ * @brief Tests that idle uploads are dropped with their temporary files
+ */
+TEST_F(MapUploaderTest, expiry_test)
+{
+  map_server::MapUploader uploader(directory_.string(), 0.2);
+  std::string id = begin(uploader).upload_id;
+  ASSERT_TRUE(append(uploader, id, 0, 0, 1).status);
+  usleep(400000);
+
+  ChunkResponse res = append(uploader, id, 1, 1, image_.size());
+  EXPECT_FALSE(res.status);
+  EXPECT_EQ(0, tmpFiles());
+}
+
+/**
+ * @brief Tests that only the stale temporary files of an earlier run are removed on start
+ */
+TEST_F(MapUploaderTest, stale_files_test)
+{
+  boost::filesystem::path user = directory_ / "user";
+  boost::filesystem::create_directories(user);
+  std::ofstream((user / "map.png.aB3dE9").string().c_str()) << "stale";
+  boost::filesystem::last_write_time(user / "map.png.aB3dE9", time(NULL) - 700);
+  std::ofstream((user / "map.png.Xy12Zw").string().c_str()) << "recent";
+  std::ofstream((user / "other.png").string().c_str()) << "map";
+  boost::filesystem::last_write_time(user / "other.png", time(NULL) - 700);
+
+  map_server::MapUploader uploader(directory_.string(), 600.0);
+  EXPECT_FALSE(boost::filesystem::exists(user / "map.png.aB3dE9"));
+  EXPECT_TRUE(boost::filesystem::exists(user / "map.png.Xy12Zw"));
+  EXPECT_TRUE(boost::filesystem::exists(user / "other.png"));
+}
+
+/**
+ * @brief The main function. Initializes the unit tests
+ */
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
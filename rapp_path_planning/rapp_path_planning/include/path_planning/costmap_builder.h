@@ -0,0 +1,114 @@
+#ifndef RAPP_PATH_PLANNING_COSTMAP_BUILDER
+#define RAPP_PATH_PLANNING_COSTMAP_BUILDER
+
+#include <string>
+#include <vector>
+#include <costmap_2d/costmap_2d.h>
+#include <geometry_msgs/Point.h>
+#include <nav_msgs/OccupancyGrid.h>
+
+/**
+ * @class CostmapConfig
+ * @brief The part of a robot's costmap configuration (cfg/costmap/<robot>.yaml) used by the in-process planner:
+ *        the value interpretation of the static map layer and the inflation layer's parameters.
+ */
+struct CostmapConfig
+{
+  // The robot footprint, padded by footprint_padding
+  std::vector<geometry_msgs::Point> footprint;
+  // Radius of the largest circle inside the footprint [m]
+  double inscribed_radius;
+  // Distance from the obstacles up to which costs are inflated [m]
+  double inflation_radius;
+  // Decay rate of the inflated costs
+  double cost_scaling_factor;
+  // Map values at or above which cells are lethal
+  unsigned char lethal_threshold;
+  // Map value of unknown cells
+  unsigned char unknown_cost_value;
+  // True to keep unknown cells unknown instead of free
+  bool track_unknown_space;
+  // True to map every non-lethal, known cell to free space
+  bool trinary_costmap;
+
+  /**
+   * @brief   Reads a robot's costmap configuration. Missing parameters get the costmap_2d defaults.
+   * @param   path [const std::string&] Path to the robot's costmap YAML file,
+   * @return  [CostmapConfig] The configuration.
+   * @throws  std::runtime_error If the file cannot be read or parsed
+   */
+  static CostmapConfig load(const std::string& path);
+};
+
+/**
+ * @class CostmapBuilder
+ * @brief Builds a master costmap out of an occupancy grid, the way the RappStaticLayer and InflationLayer plugins
+ *        of a costmap_2d::Costmap2DROS do, without running a costmap node.
+ */
+class CostmapBuilder
+{
+  public:
+
+    /**
+     * @brief   Constructor
+     * @param   config [const CostmapConfig&] The robot's costmap configuration
+     */
+    explicit CostmapBuilder(const CostmapConfig& config);
+
+    /**
+     * @brief   Resizes the costmap to the map and fills it with the interpreted and inflated map values.
+     * @param   map [const nav_msgs::OccupancyGrid&] The map,
+     * @param   costmap [costmap_2d::Costmap2D*] The costmap to fill.
+     */
+    void build(const nav_msgs::OccupancyGrid& map, costmap_2d::Costmap2D* costmap);
+
+  private:
+
+    /**
+     * @class KernelCell
+     * @brief A cell within the inflation radius of an obstacle, relative to it
+     */
+    struct KernelCell
+    {
+      int dx;
+      int dy;
+      unsigned char cost;
+    };
+
+    /**
+     * @brief   Maps an occupancy grid value to a cost, like RappStaticLayer::interpretValue
+     * @param   value [unsigned char] The occupancy grid value,
+     * @return  [unsigned char] The cost.
+     */
+    unsigned char interpretValue(unsigned char value) const;
+
+    /**
+     * @brief   Computes the inflated cost of a cell, like InflationLayer::computeCost
+     * @param   distance [double] Distance of the cell from the closest obstacle [cells],
+     * @param   resolution [double] The costmap resolution [m/cell],
+     * @return  [unsigned char] The cost.
+     */
+    unsigned char computeCost(double distance, double resolution) const;
+
+    /**
+     * @brief   Precomputes the costs around an obstacle for the given resolution
+     * @param   resolution [double] The costmap resolution [m/cell]
+     */
+    void computeKernel(double resolution);
+
+    /**
+     * @brief   Inflates the lethal cells of the costmap. Only obstacles bordering non-lethal cells are stamped,
+     *          since the closest obstacle of any other cell is always one of them.
+     * @param   costmap [costmap_2d::Costmap2D*] The costmap
+     */
+    void inflate(costmap_2d::Costmap2D* costmap);
+
+    // The robot's costmap configuration
+    CostmapConfig config_;
+    // The resolution the kernel was computed for, 0 if none
+    double kernel_resolution_;
+    // The inflated costs around an obstacle
+    std::vector<KernelCell> kernel_;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef RAPP_PATH_PLANNING_COSTMAP_SNAPSHOT
+#define RAPP_PATH_PLANNING_COSTMAP_SNAPSHOT
+
+#include <string>
+#include <stdint.h>
+#include <costmap_2d/costmap_2d.h>
+#include <path_planning/planning_key.h>
+
+/**
+ * @class CostmapSnapshot
+ * @brief A master costmap built by CostmapBuilder, persisted next to its map as <map>.<robot_type>.costmap.
+ *        The snapshot records the modification time of the map YAML file and a hash of the robot's costmap
+ *        configuration, and is ignored when either changed. Snapshots are memory-mapped for reading.
+ */
+class CostmapSnapshot
+{
+  public:
+
+    /**
+     * @brief   Default constructor. Nothing is mapped.
+     */
+    CostmapSnapshot(void);
+
+    /**
+     * @brief   Destructor. Unmaps the snapshot.
+     */
+    ~CostmapSnapshot(void);
+
+    /**
+     * @brief   Returns the path of the snapshot of a map for a robot type
+     * @param   map_path [const std::string&] Path to the map YAML file,
+     * @param   robot_type [const std::string&] Name of robot_type.
+     * @return  [std::string] Path to the snapshot.
+     */
+    static std::string path(const std::string& map_path, const std::string& robot_type);
+
+    /**
+     * @brief   Hashes a robot's costmap configuration file
+     * @param   config_path [const std::string&] Path to the robot's costmap YAML file,
+     * @return  [uint64_t] The FNV-1a hash of the file's contents.
+     * @throws  std::runtime_error If the file cannot be read
+     */
+    static uint64_t configHash(const std::string& config_path);
+
+    /**
+     * @brief   Writes the snapshot of a costmap. The snapshot is written to a temporary file and renamed, thus
+     *          concurrent readers and writers never see a partial snapshot.
+     * @param   path [const std::string&] Path to the snapshot,
+     * @param   key [const PlanningKey&] The map the costmap was built for,
+     * @param   config_hash [uint64_t] Hash of the robot's costmap configuration,
+     * @param   costmap [const costmap_2d::Costmap2D&] The costmap.
+     * @throws  std::runtime_error If the snapshot cannot be written
+     */
+    static void save(const std::string& path, const PlanningKey& key, uint64_t config_hash,
+      const costmap_2d::Costmap2D& costmap);
+
+    /**
+     * @brief   Maps a snapshot, if it exists and matches the map and the costmap configuration
+     * @param   path [const std::string&] Path to the snapshot,
+     * @param   key [const PlanningKey&] The map the costmap is needed for,
+     * @param   config_hash [uint64_t] Hash of the robot's costmap configuration,
+     * @return  [bool] True if the snapshot is mapped, false if it is missing, stale or broken.
+     */
+    bool open(const std::string& path, const PlanningKey& key, uint64_t config_hash);
+
+    /**
+     * @brief   Resizes the costmap to the mapped snapshot and copies its costs
+     * @param   costmap [costmap_2d::Costmap2D*] The costmap to fill.
+     */
+    void copyTo(costmap_2d::Costmap2D* costmap) const;
+
+  private:
+
+    /**
+     * @class Header
+     * @brief The header of a snapshot file, followed by size_x * size_y costs in row-major order
+     */
+    struct Header
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t size_x;
+      uint32_t size_y;
+      uint32_t reserved;
+      uint64_t config_hash;
+      int64_t map_mtime;
+      int64_t map_mtime_nsec;
+      double resolution;
+      double origin_x;
+      double origin_y;
+    };
+
+    /**
+     * @brief   Unmaps the snapshot, if any
+     */
+    void close(void);
+
+    // Not copyable, the mapping is owned
+    CostmapSnapshot(const CostmapSnapshot&);
+    CostmapSnapshot& operator=(const CostmapSnapshot&);
+
+    // The mapped file, NULL if none
+    void* data_;
+    // Size of the mapped file [bytes]
+    std::size_t size_;
+};
+
+#endif
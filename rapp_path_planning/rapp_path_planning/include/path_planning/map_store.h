@@ -0,0 +1,123 @@
+#ifndef RAPP_PATH_PLANNING_MAP_STORE
+#define RAPP_PATH_PLANNING_MAP_STORE
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <nav_msgs/OccupancyGrid.h>
+#include <path_planning/planning_key.h>
+
+/**
+ * @class MapStore
+ * @brief The decoded maps of the in-process planning slots, keyed by their canonical path. The maps are shared by the slots
+ *        as immutable, reference counted grids, and the least recently used ones are evicted once their size exceeds
+ *        a byte budget. An evicted map stays alive for as long as a slot uses it.
+ */
+class MapStore
+{
+  public:
+
+    /**
+     * @class Stats
+     * @brief Snapshot of the store's counters
+     */
+    struct Stats
+    {
+      // Requests served by a resident map
+      unsigned long hits;
+      // Requests that loaded their map, because it was not resident or was modified
+      unsigned long misses;
+      // Maps evicted to keep the store within its budget
+      unsigned long evictions;
+      // Maps currently resident, and their size [bytes]
+      unsigned int maps;
+      std::size_t bytes;
+      // The byte budget
+      std::size_t budget;
+      // Names of the resident maps, <user>/<map>, most recently used first
+      std::vector<std::string> names;
+    };
+
+    /**
+     * @brief   Constructor
+     * @param   budget [std::size_t] Maximum size of the resident maps [bytes],
+     * @param   frame_id [const std::string&] The frame of the loaded maps.
+     */
+    MapStore(std::size_t budget, const std::string& frame_id);
+
+    /**
+     * @brief   Returns the name a map is reported under
+     * @param   map_path [const std::string&] Path to the map YAML file, <maps>/<user>/<map>.yaml,
+     * @return  [std::string] <user>/<map>.
+     */
+    static std::string name(const std::string& map_path);
+
+    /**
+     * @brief   Returns the key a map is stored under
+     * @param   map_path [const std::string&] Path to the map YAML file,
+     * @return  [std::string] The canonical path of the file, the path itself if it cannot be resolved.
+     */
+    static std::string key(const std::string& map_path);
+
+    /**
+     * @brief   Returns a map, loading it unless it is resident and was not modified since it was loaded. A loaded map
+     *          replaces the resident one only if it is newer.
+     * @param   key [const PlanningKey&] The map's path and modification time,
+     * @return  [boost::shared_ptr<const nav_msgs::OccupancyGrid>] The map.
+     * @throws  std::runtime_error If the map cannot be loaded
+     */
+    boost::shared_ptr<const nav_msgs::OccupancyGrid> get(const PlanningKey& key);
+
+    /**
+     * @brief   Returns the store's counters
+     * @return  [Stats] The counters.
+     */
+    Stats stats(void) const;
+
+  private:
+
+    /**
+     * @class Entry
+     * @brief A resident map
+     */
+    struct Entry
+    {
+      boost::shared_ptr<const nav_msgs::OccupancyGrid> map;
+      // <user>/<map>, for the counters
+      std::string name;
+      // Modification time of the map YAML file when the map was loaded
+      time_t mtime;
+      long mtime_nsec;
+      // Size of the map [bytes]
+      std::size_t bytes;
+      // Position of the map in the recency list
+      std::list<std::string>::iterator recency;
+    };
+
+    /**
+     * @brief   Evicts the least recently used maps until the store fits its budget. The caller holds the mutex.
+     */
+    void evict(void);
+
+    // Maximum size of the resident maps [bytes]
+    std::size_t budget_;
+    // The frame of the loaded maps
+    std::string frame_id_;
+    // Guards the maps and the counters
+    mutable boost::mutex mutex_;
+    // The resident maps, by key
+    std::map<std::string, Entry> entries_;
+    // Keys of the resident maps, most recently used first
+    std::list<std::string> recency_;
+    // Size of the resident maps [bytes]
+    std::size_t bytes_;
+    unsigned long hits_;
+    unsigned long misses_;
+    unsigned long evictions_;
+};
+
+#endif
@@ -2,6 +2,10 @@
 #define RAPP_PATH_PLANNER_NODE
 
 #include <string>
+#include <vector>
+#include "ros/ros.h"
+#include <boost/thread/mutex.hpp>
+#include <path_planning/planning_key.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <nav_msgs/Path.h>
 
@@ -19,21 +23,35 @@ class PathPlanner
     PathPlanner(void);
 
     /** 
-     * @brief   Determines next planning seqence (which global_planner and map_server should be used)
-     * @param   &nh_ [ros::NodeHandle] node handler for getParam() method,
-     * @param   pathPlanningThreads_ [int] Number of planning sequences,
-     * @return  [std::string] Next sequence nr.
+     * @brief   Creates persistent service clients of the planning sequences' map_server and global_planner nodes
+     * @param   sequences [int] Number of planning sequences,
+     * @param   &nh_ [ros::NodeHandle] node handler for serviceClient() method.
+    */
+    void createClients(int sequences, ros::NodeHandle &nh_);
+
+    /** 
+     * @brief   Waits until the global_planner node of every planning sequence advertises its make_plan service
+     * @param   timeout [ros::Duration] Maximum time to wait for each sequence,
+     * @return  [bool] Returns false if a sequence was not available in time.
+    */
+    bool waitForSequences(ros::Duration timeout);
 
+    /** 
+     * @brief   Returns the counters of the sequences' configuration cache
+     * @param   hits [unsigned long*] Requests served by a sequence already configured for them,
+     * @param   misses [unsigned long*] Requests that configured their sequence.
     */
-    std::string setSequenceNR(ros::NodeHandle &nh_, int pathPlanningThreads_);
+    void cacheStats(unsigned long* hits, unsigned long* misses);
+
      /** 
      * @brief   Configures sequence. Sets map, approprate costmap parameters for specified robot type, sets global_planner to use detemined algorithm.
+     *          A sequence already configured for the same map file, unmodified since, robot type and algorithm is left as is.
      * @param   seq_nr [std::string] ID of current sequence,
      * @param   map_path [std::string] Path to the map that should be passed to global_planner,
      * @param   robot_type [std::string] Name of robot_type. It is used to configure costmap,
      * @param   algorithm [std::string] Name of algorithm that should be used by global_planner,
      * @param   &nh_ [ros::NodeHandle] node handler for getParam() method,
-     * @return  [bool] Returns if sequence was configured correctly. Returns false if PathPlanner could not configure sequence in 5 sec.
+     * @return  [bool] Returns if sequence was configured correctly. Returns false if the sequence's nodes were not available in 5 sec.
 
     */  
     bool configureSequence(std::string seq_nr, std::string map_path, std::string robot_type, std::string algorithm, ros::NodeHandle &nh_);
@@ -88,6 +106,34 @@ class PathPlanner
 */
       private:
 
+    /**
+     * @class SequenceClients
+     * @brief Persistent clients of the services of a planning sequence
+     */
+    struct SequenceClients
+    {
+      ros::ServiceClient get_map;
+      ros::ServiceClient costmap_update;
+      ros::ServiceClient make_plan;
+      // What the sequence is configured for
+      PlanningKey key;
+    };
+
+    /** 
+     * @brief   Returns the clients of a planning sequence, reconnecting the ones whose connection dropped
+     * @param   seq [int] Number of the sequence, 1 to the number of sequences,
+     * @param   &nh_ [ros::NodeHandle] node handler for serviceClient() method,
+     * @return  [SequenceClients&] The clients.
+    */
+    SequenceClients& connectSequence(int seq, ros::NodeHandle &nh_);
+
+    // The clients of every planning sequence. A sequence serves one request at a time, thus its clients are not shared.
+    std::vector<SequenceClients> clients_;
+    // Guards the cache counters
+    boost::mutex stats_mutex_;
+    // Counters of the sequences' configuration cache
+    unsigned long cache_hits_;
+    unsigned long cache_misses_;
 
 };
 
@@ -3,14 +3,22 @@
 
 #include "ros/ros.h"
 #include "ros/package.h"
+#include <ros/callback_queue.h>
 #include <navfn/MakeNavPlan.h>
 #include <navfn/MakeNavPlanResponse.h>
 #include <rapp_platform_ros_communications/PathPlanningRosSrv.h>
 #include "rapp_platform_ros_communications/MapServerGetMapRosSrv.h"
 #include "rapp_platform_ros_communications/Costmap2dRosSrv.h"
 #include "rapp_platform_ros_communications/MapServerUploadMapRosSrv.h"
+#include "rapp_platform_ros_communications/MapServerUploadMapChunkRosSrv.h"
+#include "rapp_platform_ros_communications/PathPlanningStatsRosSrv.h"
 #include <signal.h>
 #include <path_planning/path_planner.h>
+#include <path_planning/planner_engine.h>
+#include <path_planning/slot_dispatcher.h>
+#include <map_server/map_loader.h>
+#include <map_server/map_uploader.h>
+#include <boost/scoped_ptr.hpp>
 //converting variables
 #include <boost/lexical_cast.hpp>
 // for service manager -> determine if service is active
@@ -38,6 +46,14 @@ class PathPlanning
     */    
     bool uploadMapCallback(rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request  &req,
                      rapp_platform_ros_communications::MapServerUploadMapRosSrv::Response &res);
+    /** 
+     * @brief   Uploads a map to RAPP Platform in chunks: begin, append the image chunk by chunk, commit
+     * @param   &req: [uint8] action, [std::string] upload_id, the map description on begin, [uint64] offset, [char[]] data, [uint32] file_size, [uint32] crc32,
+     * @param   &res: [bool] status, [std::string] upload_id, [uint64] received, [std::string] error,
+     * @return  [bool] true-> success, false-> failure.
+    */
+    bool uploadMapChunkCallback(rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request  &req,
+                     rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Response &res);
     /** 
      * @brief   Determines next planning seqence (which global_planner and map_server should be used)
      * @param   [navfn::MakeNavPlanRequest] &req: 
@@ -54,6 +70,8 @@ class PathPlanning
                       * 2 : wrong map name
                       * 3 : wrong robot type
                       * 4 : wrong algorithm
+                      * 5 : wrong start or goal pose
+                      * 6 : too many pending requests
                   * [std::string] res.error_message : error explenation
                   * [geometry_msgs/PoseStamped[]] res.path : if plan_found is true, this is an array of waypoints from start to goal, where the first one equals start and the last one equals goal vector of PoseStamped objects
     **/   
@@ -62,14 +80,30 @@ class PathPlanning
       rapp_platform_ros_communications::PathPlanningRosSrv::Response& res
       );
 
+    /** 
+     * @brief   Reports the counters of the planning slots' dispatcher
+     * @param   &req: empty,
+     * @param   &res: [uint32] slots, [uint64] dispatched, [uint64] rejected, [uint32] queue_depth, [uint32] max_queue_depth, [float64] mean_wait_ms, [float64] max_wait_ms, [uint64] cache_hits, [uint64] cache_misses, [uint64] map_hits, [uint64] map_misses, [uint64] map_evictions, [uint32] resident_maps, [uint64] resident_bytes, [uint64] map_budget_bytes, [string[]] resident_map_names,
+     * @return  [bool] true-> success, false-> failure.
+    */
+    bool statsCallback(
+      rapp_platform_ros_communications::PathPlanningStatsRosSrv::Request& req,
+      rapp_platform_ros_communications::PathPlanningStatsRosSrv::Response& res
+      );
+
   private:
     // The ROS node handle
     ros::NodeHandle nh_;
+    // The node handle and queue of the stats service
+    ros::NodeHandle statsNh_;
+    ros::CallbackQueue statsQueue_;
     // RAPP-platform home_dir
     const char *homedir;
     // The service server 
     ros::ServiceServer pathPlanningService_;
     ros::ServiceServer uploadMapService_;
+    ros::ServiceServer uploadMapChunkService_;
+    ros::ServiceServer statsService_;
     std::vector<ros::ServiceServer> pathPlanningThreadServices_;
     std::vector<pid_t> GP_pIDs;
     std::vector<pid_t> MS_pIDs;
@@ -77,10 +111,22 @@ class PathPlanning
     // Topic nomeclarure
     std::string pathPlanningTopic_;
     std::string uploadMapTopic_;
+    std::string uploadMapChunkTopic_;
+    std::string statsTopic_;
     int pathPlanningThreads_;
-    double pose_dist_;
-    std::vector<geometry_msgs::PoseStamped> new_path;
     PathPlanner path_planner_; 
+    // True to plan in process instead of in forked map_server and global_planner nodes
+    bool inProcess_;
+    // Maximum number of requests waiting for an idle planning slot
+    int maxQueue_;
+    // Hands the requests to the planning slots
+    boost::scoped_ptr<SlotDispatcher> dispatcher_;
+    // The in-process planning slots
+    boost::scoped_ptr<PlannerEngine> planner_engine_;
+    // The pending chunked map uploads
+    boost::scoped_ptr<map_server::MapUploader> map_uploader_;
+    // Serves the stats queue, stopped before the members above are destroyed
+    boost::scoped_ptr<ros::AsyncSpinner> statsSpinner_;
 };
 
 #endif
@@ -0,0 +1,183 @@
+#ifndef RAPP_PATH_PLANNING_PLANNER_ENGINE
+#define RAPP_PATH_PLANNING_PLANNER_ENGINE
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "ros/ros.h"
+#include <costmap_2d/costmap_2d.h>
+#include <global_planner/planner_core.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <navfn/MakeNavPlanResponse.h>
+#include <path_planning/planning_key.h>
+#include <path_planning/map_store.h>
+
+/**
+ * @class PlannerEngine
+ * @brief Plans paths in-process, replacing the map_server and global_planner nodes of the planning sequences.
+ *        Every planning slot is served by a worker thread owning a costmap_2d::Costmap2D and a
+ *        global_planner::GlobalPlanner per algorithm. The slot serving a request is picked by a SlotDispatcher.
+ */
+class PlannerEngine
+{
+  public:
+
+    /**
+     * @brief   Constructor. Starts the worker threads.
+     * @param   slots [unsigned int] Number of planning slots. At least one slot is always started,
+     * @param   config_dir [const std::string&] Directory holding the costmap/<robot>.yaml and
+     *          planner/<algorithm>.yaml configuration files,
+     * @param   map_store_bytes [std::size_t] Byte budget of the maps shared by the slots.
+     */
+    PlannerEngine(unsigned int slots, const std::string& config_dir, std::size_t map_store_bytes = 256 << 20);
+
+    /**
+     * @brief   Destructor. Stops and joins the worker threads.
+     */
+    ~PlannerEngine(void);
+
+    /**
+     * @brief   Plans a path on a slot. Blocks until the slot's worker has served the request. A slot serves a
+     *          single request at a time, thus the caller must hold the slot, e.g. acquired from a SlotDispatcher.
+     * @param   slot [int] Number of the slot, 1 to size(),
+     * @param   map_path [const std::string&] Path to the map YAML file,
+     * @param   robot_type [const std::string&] Name of robot_type. It is used to configure the costmap,
+     * @param   algorithm [const std::string&] Name of algorithm that should be used by global_planner,
+     * @param   start [const geometry_msgs::PoseStamped&] Robot start pose,
+     * @param   goal [const geometry_msgs::PoseStamped&] Robot goal pose.
+     * @return  [navfn::MakeNavPlanResponse] The planned path, as returned by the make_plan service of a
+     *          global_planner node. error_message explains a failed configuration, or a request
+     *          made while the engine is stopping.
+     */
+    navfn::MakeNavPlanResponse plan(int slot, const std::string& map_path, const std::string& robot_type,
+      const std::string& algorithm, const geometry_msgs::PoseStamped& start,
+      const geometry_msgs::PoseStamped& goal);
+
+    /**
+     * @brief   Builds the costmap snapshots of a map, for every robot type with a costmap/<robot>.yaml
+     *          configuration, so that the first plans on the map do not build them. Up-to-date snapshots are kept.
+     * @param   map_path [const std::string&] Path to the map YAML file.
+     * @throws  std::runtime_error If the map or a configuration cannot be read, or a snapshot cannot be written
+     */
+    void snapshot(const std::string& map_path);
+
+    /**
+     * @brief   Returns the number of planning slots
+     * @return  [unsigned int] The number of slots.
+     */
+    unsigned int size(void) const;
+
+    /**
+     * @brief   Returns the counters of the slots' costmap cache
+     * @param   hits [unsigned long*] Requests served on the costmap already held by their slot,
+     * @param   misses [unsigned long*] Requests that loaded their map and built the costmap.
+     */
+    void cacheStats(unsigned long* hits, unsigned long* misses) const;
+
+    /**
+     * @brief   Returns the counters of the maps shared by the slots
+     * @return  [MapStore::Stats] The counters.
+     */
+    MapStore::Stats mapStoreStats(void) const;
+
+  private:
+
+    /**
+     * @class Job
+     * @brief A planning request, handed to a slot
+     */
+    struct Job
+    {
+      const std::string* map_path;
+      const std::string* robot_type;
+      const std::string* algorithm;
+      const geometry_msgs::PoseStamped* start;
+      const geometry_msgs::PoseStamped* goal;
+      // Where the planned path is stored
+      navfn::MakeNavPlanResponse* response;
+      // Set when the job is served
+      bool* done;
+    };
+
+    /**
+     * @class Slot
+     * @brief The planning state owned by a worker thread
+     */
+    struct Slot
+    {
+      // Number of the slot, naming its planners' parameter namespaces
+      unsigned int id;
+      // The costmap the slot's planners plan on
+      costmap_2d::Costmap2D costmap;
+      // The map and robot type the costmap was built for, the default key if none
+      PlanningKey key;
+      // The costmap as built. Planning marks the map border and the start cell, thus it is restored before a plan.
+      std::vector<unsigned char> pristine;
+      // The slot's planners, per algorithm
+      std::map<std::string, boost::shared_ptr<global_planner::GlobalPlanner> > planners;
+      // The request handed to the slot, NULL if none
+      const Job* job;
+      // Signaled when a request is handed to the slot or the engine is stopping
+      boost::condition_variable job_available;
+    };
+
+    /**
+     * @brief   The worker threads' loop
+     * @param   slot [boost::shared_ptr<Slot>] The worker's slot
+     */
+    void work(boost::shared_ptr<Slot> slot);
+
+    /**
+     * @brief   Configures a slot for a request, unless it already holds the request's map and robot type, and plans
+     *          the path
+     * @param   slot [Slot&] The worker's slot,
+     * @param   job [const Job&] The request.
+     * @return  [navfn::MakeNavPlanResponse] The planned path.
+     */
+    navfn::MakeNavPlanResponse serve(Slot& slot, const Job& job);
+
+    /**
+     * @brief   Fills a costmap for a map and robot type, from the costmap snapshot if it is up to date. Otherwise
+     *          the map is loaded, the costmap built and, for users' maps, the snapshot saved.
+     * @param   key [const PlanningKey&] The map and robot type,
+     * @param   costmap [costmap_2d::Costmap2D*] The costmap to fill.
+     * @throws  std::runtime_error If the map or the costmap configuration cannot be read
+     */
+    void loadCostmap(const PlanningKey& key, costmap_2d::Costmap2D* costmap);
+
+    /**
+     * @brief   Returns the slot's planner for an algorithm, creating it on first use. The planner parameters are
+     *          loaded from planner/<algorithm>.yaml into the planner's private namespace before its creation.
+     * @param   slot [Slot&] The worker's slot,
+     * @param   algorithm [const std::string&] Name of the algorithm.
+     * @return  [global_planner::GlobalPlanner&] The planner.
+     * @throws  std::runtime_error If the planner configuration cannot be read
+     */
+    global_planner::GlobalPlanner& planner(Slot& slot, const std::string& algorithm);
+
+    // Directory of the costmap and planner configuration files
+    std::string config_dir_;
+    // The maps the costmaps are built from, shared by the slots
+    MapStore map_store_;
+    // Private node handle of the node, holding the planners' parameters
+    ros::NodeHandle private_nh_;
+    // The worker threads
+    boost::thread_group workers_;
+    // The slots owned by the worker threads
+    std::vector<boost::shared_ptr<Slot> > slots_;
+    // Guards the slots' requests, the requests' completion flags and the cache counters
+    mutable boost::mutex mutex_;
+    // Signaled when a job is served
+    boost::condition_variable job_done_;
+    // Set when the workers must exit
+    bool stopping_;
+    // Counters of the slots' costmap cache
+    unsigned long cache_hits_;
+    unsigned long cache_misses_;
+};
+
+#endif
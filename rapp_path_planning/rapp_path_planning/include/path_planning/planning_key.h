@@ -0,0 +1,59 @@
+#ifndef RAPP_PATH_PLANNING_PLANNING_KEY
+#define RAPP_PATH_PLANNING_PLANNING_KEY
+
+#include <string>
+#include <ctime>
+
+/**
+ * @class PlanningKey
+ * @brief Identifies what a planning slot is configured for: the map file and its modification time, the robot
+ *        type and the algorithm. A slot holding the key of a request can plan it without reloading anything.
+ */
+struct PlanningKey
+{
+  // Path to the map YAML file
+  std::string map_path;
+  // Modification time of the map YAML file, 0 if it does not exist
+  time_t map_mtime;
+  long map_mtime_nsec;
+  // Name of robot_type, selecting the costmap configuration
+  std::string robot_type;
+  // Name of the planning algorithm
+  std::string algorithm;
+
+  /**
+   * @brief   Default constructor. The key matches no request.
+   */
+  PlanningKey(void);
+
+  /**
+   * @brief   Builds the key of a request, reading the map file's modification time
+   * @param   map_path [const std::string&] Path to the map YAML file,
+   * @param   robot_type [const std::string&] Name of robot_type,
+   * @param   algorithm [const std::string&] Name of the planning algorithm.
+   */
+  PlanningKey(const std::string& map_path, const std::string& robot_type, const std::string& algorithm);
+
+  /**
+   * @brief   Checks whether a costmap built for this key can serve the other key, i.e. whether the map and the
+   *          robot type are the same and the map was not modified since
+   * @param   other [const PlanningKey&] The other key,
+   * @return  [bool] True if the costmap can be reused.
+   */
+  bool sameCostmap(const PlanningKey& other) const;
+
+  /**
+   * @brief   Checks whether the keys are the same, algorithm included
+   * @param   other [const PlanningKey&] The other key,
+   * @return  [bool] True if the keys are the same.
+   */
+  bool operator==(const PlanningKey& other) const;
+
+  /**
+   * @brief   Returns the key without the modification time, used to steer requests to the slots holding their map
+   * @return  [std::string] The affinity of the key, empty for the default key.
+   */
+  std::string affinity(void) const;
+};
+
+#endif
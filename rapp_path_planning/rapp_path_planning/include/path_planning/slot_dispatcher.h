@@ -0,0 +1,107 @@
+#ifndef RAPP_PATH_PLANNING_SLOT_DISPATCHER
+#define RAPP_PATH_PLANNING_SLOT_DISPATCHER
+
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/**
+ * @class SlotDispatcher
+ * @brief Hands the planning requests to the planning slots. A request gets an idle slot already configured for it
+ *        or else the least-loaded idle slot, or waits for one in a bounded FIFO queue. Requests arriving at a full
+ *        queue are rejected.
+ */
+class SlotDispatcher
+{
+  public:
+
+    /**
+     * @class Stats
+     * @brief Snapshot of the dispatcher's counters
+     */
+    struct Stats
+    {
+      // Number of planning slots
+      unsigned int slots;
+      // Requests dispatched to a slot
+      unsigned long dispatched;
+      // Requests rejected because the queue was full
+      unsigned long rejected;
+      // Requests currently waiting for an idle slot
+      unsigned int queue_depth;
+      // Maximum number of requests that waited at the same time
+      unsigned int max_queue_depth;
+      // Mean and maximum time the dispatched requests waited for an idle slot [ms]
+      double mean_wait_ms;
+      double max_wait_ms;
+    };
+
+    /**
+     * @brief   Constructor
+     * @param   slots [unsigned int] Number of planning slots. At least one slot is always used,
+     * @param   max_queue [unsigned int] Maximum number of requests waiting for an idle slot.
+     */
+    SlotDispatcher(unsigned int slots, unsigned int max_queue);
+
+    /**
+     * @brief   Waits for an idle slot and marks it busy. An idle slot released with the same affinity is picked
+     *          first, otherwise the idle slot that served the fewest requests.
+     * @param   affinity [const std::string&] What the request needs the slot configured for, empty for any slot
+     * @return  [int] Number of the slot, 1 to size(). 0 if the queue is full and the request is rejected.
+     */
+    int acquire(const std::string& affinity = std::string());
+
+    /**
+     * @brief   Marks a slot idle and hands it to the first waiting request
+     * @param   slot [int] Number of the slot, as returned by acquire(),
+     * @param   affinity [const std::string&] What the slot is now configured for, empty if unknown.
+     */
+    void release(int slot, const std::string& affinity = std::string());
+
+    /**
+     * @brief   Returns the number of planning slots
+     * @return  [unsigned int] The number of slots.
+     */
+    unsigned int size(void) const;
+
+    /**
+     * @brief   Returns the dispatcher's counters
+     * @return  [Stats] The counters.
+     */
+    Stats stats(void) const;
+
+  private:
+
+    /**
+     * @brief   Returns the idle slot with the given affinity, or else the least-loaded idle slot.
+     *          Must be called with the mutex held.
+     * @param   affinity [const std::string&] What the request needs the slot configured for
+     * @return  [int] Index of the slot, -1 if all slots are busy.
+     */
+    int idleSlot(const std::string& affinity) const;
+
+    // Guards the slots' state and the counters
+    mutable boost::mutex mutex_;
+    // Signaled when a slot becomes idle or the head of the queue changes
+    boost::condition_variable changed_;
+    // True for every busy slot
+    std::vector<bool> busy_;
+    // Number of requests served by every slot
+    std::vector<unsigned long> served_;
+    // What every slot is configured for
+    std::vector<std::string> affinity_;
+    // Maximum number of waiting requests
+    unsigned int max_queue_;
+    // Ticket of the next arriving request and of the request at the head of the queue
+    unsigned long next_ticket_;
+    unsigned long head_ticket_;
+    // Counters
+    unsigned long dispatched_;
+    unsigned long rejected_;
+    unsigned int max_queue_depth_;
+    double total_wait_ms_;
+    double max_wait_ms_;
+};
+
+#endif
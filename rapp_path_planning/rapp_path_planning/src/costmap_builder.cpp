@@ -0,0 +1,185 @@
+#include <path_planning/costmap_builder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <costmap_2d/cost_values.h>
+#include <costmap_2d/footprint.h>
+#include <yaml-cpp/yaml.h>
+
+namespace
+{
+
+// returns the value of a key of a YAML map, or the default value if the key is missing
+template<typename T>
+T yamlParam(const YAML::Node& node, const char* key, const T& default_value)
+{
+  if (node.IsMap() && node[key])
+    return node[key].as<T>();
+  return default_value;
+}
+
+}
+
+CostmapConfig CostmapConfig::load(const std::string& path)
+{
+  YAML::Node doc;
+  try{
+    doc = YAML::LoadFile(path);
+  }catch (YAML::Exception& e){
+    throw std::runtime_error("cannot read costmap configuration " + path + ": " + e.what());
+  }
+
+  CostmapConfig config;
+  // defaults of costmap_2d::Costmap2DROS, RappStaticLayer and InflationLayer
+  int lethal_threshold = 100;
+  int unknown_cost_value = -1;
+  config.track_unknown_space = true;
+  config.trinary_costmap = true;
+  config.inflation_radius = 0.55;
+  config.cost_scaling_factor = 10.0;
+  try{
+    // every plugin reads its parameters from its own namespace
+    YAML::Node plugins = doc["plugins"];
+    for (std::size_t i = 0; plugins.IsSequence() && i < plugins.size(); i++){
+      std::string name = yamlParam<std::string>(plugins[i], "name", "");
+      std::string type = yamlParam<std::string>(plugins[i], "type", "");
+      YAML::Node plugin = doc[name];
+      if (type.find("StaticLayer") != std::string::npos){
+        lethal_threshold = yamlParam(plugin, "lethal_cost_threshold", lethal_threshold);
+        unknown_cost_value = yamlParam(plugin, "unknown_cost_value", unknown_cost_value);
+        config.track_unknown_space = yamlParam(plugin, "track_unknown_space", config.track_unknown_space);
+        config.trinary_costmap = yamlParam(plugin, "trinary_costmap", config.trinary_costmap);
+      }else if (type.find("InflationLayer") != std::string::npos){
+        config.inflation_radius = yamlParam(plugin, "inflation_radius", config.inflation_radius);
+        config.cost_scaling_factor = yamlParam(plugin, "cost_scaling_factor", config.cost_scaling_factor);
+      }
+    }
+
+    YAML::Node footprint = doc["footprint"];
+    if (footprint.IsSequence() && footprint.size() >= 3){
+      for (std::size_t i = 0; i < footprint.size(); i++){
+        geometry_msgs::Point point;
+        point.x = footprint[i][0].as<double>();
+        point.y = footprint[i][1].as<double>();
+        point.z = 0.0;
+        config.footprint.push_back(point);
+      }
+    }else{
+      config.footprint = costmap_2d::makeFootprintFromRadius(yamlParam(doc, "robot_radius", 0.46));
+    }
+    costmap_2d::padFootprint(config.footprint, yamlParam(doc, "footprint_padding", 0.01));
+  }catch (YAML::Exception& e){
+    throw std::runtime_error("invalid costmap configuration " + path + ": " + e.what());
+  }
+  config.lethal_threshold = lethal_threshold;
+  config.unknown_cost_value = unknown_cost_value;
+
+  double circumscribed_radius;
+  costmap_2d::calculateMinAndMaxDistances(config.footprint, config.inscribed_radius, circumscribed_radius);
+  return config;
+}
+
+CostmapBuilder::CostmapBuilder(const CostmapConfig& config) :
+  config_(config),
+  kernel_resolution_(0)
+{
+}
+
+void CostmapBuilder::build(const nav_msgs::OccupancyGrid& map, costmap_2d::Costmap2D* costmap){
+  unsigned int size_x = map.info.width, size_y = map.info.height;
+  double resolution = map.info.resolution;
+  double origin_x = map.info.origin.position.x, origin_y = map.info.origin.position.y;
+
+  // resizing reallocates the costmap, thus it is skipped for maps of the same geometry
+  if (costmap->getSizeInCellsX() != size_x || costmap->getSizeInCellsY() != size_y ||
+      costmap->getResolution() != resolution || costmap->getOriginX() != origin_x ||
+      costmap->getOriginY() != origin_y){
+    costmap->resizeMap(size_x, size_y, resolution, origin_x, origin_y);
+  }
+
+  unsigned char* grid = costmap->getCharMap();
+  std::size_t cells = (std::size_t) size_x * size_y;
+  for (std::size_t i = 0; i < cells && i < map.data.size(); i++){
+    grid[i] = interpretValue(map.data[i]);
+  }
+  inflate(costmap);
+}
+
+unsigned char CostmapBuilder::interpretValue(unsigned char value) const{
+  //check if the static value is above the unknown or lethal thresholds
+  if (config_.track_unknown_space && value == config_.unknown_cost_value)
+    return costmap_2d::NO_INFORMATION;
+  else if (value >= config_.lethal_threshold)
+    return costmap_2d::LETHAL_OBSTACLE;
+  else if (config_.trinary_costmap)
+    return costmap_2d::FREE_SPACE;
+
+  double scale = (double) value / config_.lethal_threshold;
+  return scale * costmap_2d::LETHAL_OBSTACLE;
+}
+
+unsigned char CostmapBuilder::computeCost(double distance, double resolution) const{
+  if (distance == 0)
+    return costmap_2d::LETHAL_OBSTACLE;
+  if (distance * resolution <= config_.inscribed_radius)
+    return costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
+  // make sure cost falls off by Euclidean distance
+  double factor = exp(-1.0 * config_.cost_scaling_factor * (distance * resolution - config_.inscribed_radius));
+  return (unsigned char) ((costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1) * factor);
+}
+
+void CostmapBuilder::computeKernel(double resolution){
+  kernel_.clear();
+  int radius = (int) std::max(0.0, ceil(config_.inflation_radius / resolution));
+  for (int dy = -radius; dy <= radius; dy++){
+    for (int dx = -radius; dx <= radius; dx++){
+      double distance = sqrt((double) (dx * dx + dy * dy));
+      if (distance == 0 || distance > radius)
+        continue;
+      KernelCell cell;
+      cell.dx = dx;
+      cell.dy = dy;
+      cell.cost = computeCost(distance, resolution);
+      if (cell.cost > costmap_2d::FREE_SPACE)
+        kernel_.push_back(cell);
+    }
+  }
+  kernel_resolution_ = resolution;
+}
+
+void CostmapBuilder::inflate(costmap_2d::Costmap2D* costmap){
+  if (kernel_resolution_ != costmap->getResolution())
+    computeKernel(costmap->getResolution());
+
+  int size_x = costmap->getSizeInCellsX(), size_y = costmap->getSizeInCellsY();
+  unsigned char* grid = costmap->getCharMap();
+  // stamping never turns a cell lethal, thus the obstacles can be found and stamped in the same pass
+  for (int y = 0; y < size_y; y++){
+    for (int x = 0; x < size_x; x++){
+      unsigned int index = y * size_x + x;
+      if (grid[index] != costmap_2d::LETHAL_OBSTACLE)
+        continue;
+      bool boundary = (x > 0 && grid[index - 1] != costmap_2d::LETHAL_OBSTACLE) ||
+          (x < size_x - 1 && grid[index + 1] != costmap_2d::LETHAL_OBSTACLE) ||
+          (y > 0 && grid[index - size_x] != costmap_2d::LETHAL_OBSTACLE) ||
+          (y < size_y - 1 && grid[index + size_x] != costmap_2d::LETHAL_OBSTACLE);
+      if (!boundary)
+        continue;
+      for (std::size_t k = 0; k < kernel_.size(); k++){
+        int cx = x + kernel_[k].dx, cy = y + kernel_[k].dy;
+        if (cx < 0 || cy < 0 || cx >= size_x || cy >= size_y)
+          continue;
+        unsigned char& old_cost = grid[cy * size_x + cx];
+        unsigned char cost = kernel_[k].cost;
+        // unknown cells only become known within the inscribed radius, like in InflationLayer
+        if (old_cost == costmap_2d::NO_INFORMATION){
+          if (cost >= costmap_2d::INSCRIBED_INFLATED_OBSTACLE)
+            old_cost = cost;
+        }else if (cost > old_cost){
+          old_cost = cost;
+        }
+      }
+    }
+  }
+}
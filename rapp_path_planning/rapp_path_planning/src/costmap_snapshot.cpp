@@ -0,0 +1,152 @@
+#include <path_planning/costmap_snapshot.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+const char MAGIC[8] = {'R', 'A', 'P', 'P', 'C', 'M', 'A', 'P'};
+const uint32_t VERSION = 1;
+
+// writes the whole buffer, retrying short writes
+bool writeAll(int fd, const void* buffer, std::size_t size){
+  const char* data = static_cast<const char*>(buffer);
+  while (size > 0){
+    ssize_t written = write(fd, data, size);
+    if (written < 0){
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+}
+
+CostmapSnapshot::CostmapSnapshot(void) :
+  data_(NULL),
+  size_(0)
+{
+}
+
+CostmapSnapshot::~CostmapSnapshot(void){
+  close();
+}
+
+std::string CostmapSnapshot::path(const std::string& map_path, const std::string& robot_type){
+  std::string base = map_path;
+  std::string::size_type dot = base.rfind('.');
+  if (dot != std::string::npos && base.find('/', dot) == std::string::npos)
+    base.erase(dot);
+  return base + "." + robot_type + ".costmap";
+}
+
+uint64_t CostmapSnapshot::configHash(const std::string& config_path){
+  std::ifstream file(config_path.c_str(), std::ifstream::binary);
+  if (!file)
+    throw std::runtime_error("cannot read costmap configuration " + config_path);
+  uint64_t hash = 14695981039346656037ULL;
+  char buffer[4096];
+  while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0){
+    for (std::streamsize i = 0; i < file.gcount(); i++){
+      hash ^= (unsigned char) buffer[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+void CostmapSnapshot::save(const std::string& path, const PlanningKey& key, uint64_t config_hash,
+  const costmap_2d::Costmap2D& costmap){
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.size_x = costmap.getSizeInCellsX();
+  header.size_y = costmap.getSizeInCellsY();
+  header.config_hash = config_hash;
+  header.map_mtime = key.map_mtime;
+  header.map_mtime_nsec = key.map_mtime_nsec;
+  header.resolution = costmap.getResolution();
+  header.origin_x = costmap.getOriginX();
+  header.origin_y = costmap.getOriginY();
+
+  std::vector<char> tmp_path(path.begin(), path.end());
+  const char suffix[] = ".XXXXXX";
+  tmp_path.insert(tmp_path.end(), suffix, suffix + sizeof(suffix));
+  int fd = mkstemp(&tmp_path[0]);
+  if (fd < 0)
+    throw std::runtime_error("cannot create " + path + ": " + strerror(errno));
+  fchmod(fd, 0644);
+  bool written = writeAll(fd, &header, sizeof(header)) &&
+    writeAll(fd, costmap.getCharMap(), (std::size_t) header.size_x * header.size_y);
+  if (::close(fd) != 0)
+    written = false;
+  if (!written || rename(&tmp_path[0], path.c_str()) != 0){
+    std::string error = strerror(errno);
+    unlink(&tmp_path[0]);
+    throw std::runtime_error("cannot write " + path + ": " + error);
+  }
+}
+
+bool CostmapSnapshot::open(const std::string& path, const PlanningKey& key, uint64_t config_hash){
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat buffer;
+  if (fstat(fd, &buffer) != 0 || (std::size_t) buffer.st_size < sizeof(Header)){
+    ::close(fd);
+    return false;
+  }
+  void* data = mmap(NULL, buffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping outlives the descriptor
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  data_ = data;
+  size_ = buffer.st_size;
+
+  const Header& header = *static_cast<const Header*>(data_);
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+      header.config_hash != config_hash || header.map_mtime != key.map_mtime ||
+      header.map_mtime_nsec != key.map_mtime_nsec ||
+      size_ != sizeof(Header) + (std::size_t) header.size_x * header.size_y){
+    close();
+    return false;
+  }
+  return true;
+}
+
+void CostmapSnapshot::copyTo(costmap_2d::Costmap2D* costmap) const{
+  const Header& header = *static_cast<const Header*>(data_);
+  // resizing reallocates the costmap, thus it is skipped for maps of the same geometry
+  if (costmap->getSizeInCellsX() != header.size_x || costmap->getSizeInCellsY() != header.size_y ||
+      costmap->getResolution() != header.resolution || costmap->getOriginX() != header.origin_x ||
+      costmap->getOriginY() != header.origin_y){
+    costmap->resizeMap(header.size_x, header.size_y, header.resolution, header.origin_x, header.origin_y);
+  }
+  std::memcpy(costmap->getCharMap(), static_cast<const char*>(data_) + sizeof(Header),
+    (std::size_t) header.size_x * header.size_y);
+}
+
+void CostmapSnapshot::close(void){
+  if (data_){
+    munmap(data_, size_);
+    data_ = NULL;
+    size_ = 0;
+  }
+}
@@ -0,0 +1,102 @@
+#include <path_planning/map_store.h>
+
+#include <boost/filesystem.hpp>
+#include <map_server/map_loader.h>
+
+MapStore::MapStore(std::size_t budget, const std::string& frame_id) :
+  budget_(budget),
+  frame_id_(frame_id),
+  bytes_(0),
+  hits_(0),
+  misses_(0),
+  evictions_(0)
+{
+}
+
+std::string MapStore::name(const std::string& map_path){
+  std::string::size_type file = map_path.rfind('/');
+  std::string::size_type user = std::string::npos;
+  if (file != std::string::npos && file > 0)
+    user = map_path.rfind('/', file - 1);
+  std::string stem = map_path.substr(user == std::string::npos ? 0 : user + 1);
+  std::string::size_type dot = stem.rfind('.');
+  if (dot != std::string::npos && stem.find('/', dot) == std::string::npos)
+    stem.erase(dot);
+  return stem;
+}
+
+std::string MapStore::key(const std::string& map_path){
+  // same-named maps of different directories are different maps
+  boost::system::error_code error;
+  boost::filesystem::path path = boost::filesystem::canonical(map_path, error);
+  return error ? map_path : path.string();
+}
+
+boost::shared_ptr<const nav_msgs::OccupancyGrid> MapStore::get(const PlanningKey& key){
+  std::string map_key = MapStore::key(key.map_path);
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<std::string, Entry>::iterator it = entries_.find(map_key);
+    if (it != entries_.end() && it->second.mtime == key.map_mtime && it->second.mtime_nsec == key.map_mtime_nsec){
+      recency_.splice(recency_.begin(), recency_, it->second.recency);
+      hits_++;
+      return it->second.map;
+    }
+    misses_++;
+  }
+
+  // the map is loaded without the lock, thus slots loading different maps do not wait for each other
+  boost::shared_ptr<nav_msgs::OccupancyGrid> map(new nav_msgs::OccupancyGrid);
+  map_server::loadMap(key.map_path, map.get(), frame_id_);
+  std::size_t bytes = sizeof(nav_msgs::OccupancyGrid) + map->data.size();
+
+  boost::mutex::scoped_lock lock(mutex_);
+  std::map<std::string, Entry>::iterator it = entries_.find(map_key);
+  if (it != entries_.end()){
+    // another slot loaded the same map meanwhile
+    if (it->second.mtime == key.map_mtime && it->second.mtime_nsec == key.map_mtime_nsec)
+      return it->second.map;
+    // or a newer one, the slot that read the older modification time plans on its map without storing it
+    if (it->second.mtime > key.map_mtime ||
+        (it->second.mtime == key.map_mtime && it->second.mtime_nsec > key.map_mtime_nsec))
+      return map;
+    bytes_ -= it->second.bytes;
+    recency_.erase(it->second.recency);
+    entries_.erase(it);
+  }
+  Entry& entry = entries_[map_key];
+  entry.map = map;
+  entry.name = name(key.map_path);
+  entry.mtime = key.map_mtime;
+  entry.mtime_nsec = key.map_mtime_nsec;
+  entry.bytes = bytes;
+  entry.recency = recency_.insert(recency_.begin(), map_key);
+  bytes_ += bytes;
+  evict();
+  return map;
+}
+
+MapStore::Stats MapStore::stats(void) const{
+  boost::mutex::scoped_lock lock(mutex_);
+  Stats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  stats.maps = entries_.size();
+  stats.bytes = bytes_;
+  stats.budget = budget_;
+  for (std::list<std::string>::const_iterator it = recency_.begin(); it != recency_.end(); ++it)
+    stats.names.push_back(entries_.find(*it)->second.name);
+  return stats;
+}
+
+void MapStore::evict(void){
+  // a map larger than the budget is evicted as well, its users keep it alive
+  while (bytes_ > budget_ && !recency_.empty()){
+    std::map<std::string, Entry>::iterator it = entries_.find(recency_.back());
+    bytes_ -= it->second.bytes;
+    entries_.erase(it);
+    recency_.pop_back();
+    evictions_++;
+  }
+}
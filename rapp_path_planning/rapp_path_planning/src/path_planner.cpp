@@ -1,176 +1,126 @@
 #include <path_planning/path_planning.h>
 
 
-PathPlanner::PathPlanner(void)
+namespace
 {
+
+// how long a planning sequence's node may take to advertise its services [s]
+const double SERVICE_TIMEOUT = 5.0;
+
+// creates a persistent client of a sequence's service, unless a usable one exists
+template<class Service>
+void connect(ros::ServiceClient& client, const std::string& name, ros::NodeHandle &nh_){
+  if (!client.isValid())
+    client = nh_.serviceClient<Service>(name, true);
 }
 
-// set next planning sequence ID
-std::string PathPlanner::setSequenceNR(ros::NodeHandle &nh_, int pathPlanningThreads_){
-  int seq_nr_int=1;
-  std::string seq_nr_str;
-  if (nh_.hasParam("/rapp/rapp_path_planning/last_seq")){
-    nh_.getParam("/rapp/rapp_path_planning/last_seq", seq_nr_int);
+}
 
-    seq_nr_int++;
-    if (seq_nr_int > pathPlanningThreads_)
-      seq_nr_int = 1;
-  }
+PathPlanner::PathPlanner(void) :
+  cache_hits_(0),
+  cache_misses_(0)
+{
+}
 
-  seq_nr_str = boost::lexical_cast<std::string>(seq_nr_int);
-  nh_.setParam("/rapp/rapp_path_planning/last_seq", seq_nr_int);
+void PathPlanner::cacheStats(unsigned long* hits, unsigned long* misses){
+  boost::mutex::scoped_lock lock(stats_mutex_);
+  *hits = cache_hits_;
+  *misses = cache_misses_;
+}
+
+void PathPlanner::createClients(int sequences, ros::NodeHandle &nh_){
+  clients_.resize(sequences > 0 ? sequences : 0);
+  for (int seq = 1; seq <= (int) clients_.size(); seq++)
+    connectSequence(seq, nh_);
+}
+
+bool PathPlanner::waitForSequences(ros::Duration timeout){
+  for (std::size_t i = 0; i < clients_.size(); i++){
+    if (!clients_[i].make_plan.waitForExistence(timeout)){
+      ROS_ERROR_STREAM("Planning sequence " << i+1 << " is not available");
+      return false;
+    }
+  }
+  return true;
+}
 
-  return seq_nr_str;
+PathPlanner::SequenceClients& PathPlanner::connectSequence(int seq, ros::NodeHandle &nh_){
+  std::string seq_nr = boost::lexical_cast<std::string>(seq);
+  SequenceClients& clients = clients_.at(seq - 1);
+  // a persistent client becomes invalid when its connection drops, e.g. on a node restart
+  connect<rapp_platform_ros_communications::MapServerGetMapRosSrv>(clients.get_map, "/map_server"+seq_nr+"/get_map", nh_);
+  connect<rapp_platform_ros_communications::Costmap2dRosSrv>(clients.costmap_update, "/global_planner"+seq_nr+"/costmap_map_update", nh_);
+  connect<navfn::MakeNavPlan>(clients.make_plan, "/global_planner"+seq_nr+"/make_plan", nh_);
+  return clients;
 }
-// configure sequence -> load .yaml files and load proper map
+
+// configure sequence -> load proper map
 bool PathPlanner::configureSequence(std::string seq_nr, std::string map_path, std::string robot_type, std::string algorithm, ros::NodeHandle &nh_){
 
+  SequenceClients& clients = connectSequence(boost::lexical_cast<int>(seq_nr), nh_);
+  PlanningKey key(map_path, robot_type, algorithm);
+  bool hit = clients.key == key;
+  {
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    if (hit)
+      cache_hits_++;
+    else
+      cache_misses_++;
+  }
+  if (hit){
+    ROS_DEBUG_STREAM("SEQ: " << seq_nr << " already holds " << map_path);
+    return true;
+  }
+  clients.key = PlanningKey();
+
   nh_.setParam("/map_server"+seq_nr+"/setMap", map_path);
-  ros::ServiceClient get_map_client = nh_.serviceClient<rapp_platform_ros_communications::MapServerGetMapRosSrv>("map_server"+seq_nr+"/get_map");
-  ros::ServiceClient set_costmap_client = nh_.serviceClient<rapp_platform_ros_communications::Costmap2dRosSrv>("/global_planner"+seq_nr+"/costmap_map_update");
 
   rapp_platform_ros_communications::MapServerGetMapRosSrv get_map_srv;
   rapp_platform_ros_communications::Costmap2dRosSrv set_costmap_srv;
   get_map_srv.request.map_path = map_path;
-  uint32_t serv_port;
-  std::string serv_node_name, serv_name;
-  ros::ServiceManager srv_manager; 
-  bool serv_active = srv_manager.lookupService("map_server"+seq_nr+"/get_map",serv_node_name,serv_port);
-
-  while (!serv_active){
-    ROS_DEBUG_STREAM("Waiting for:"<<" map_server"<<seq_nr<<"/get_map" << " service ");
-    serv_active = srv_manager.lookupService("map_server"+seq_nr+"/get_map",serv_node_name,serv_port);
-    ros::Duration(1).sleep();
-  }
-
 
-  if (get_map_client.call(get_map_srv))
+  if (!clients.get_map.waitForExistence(ros::Duration(SERVICE_TIMEOUT))){
+    ROS_ERROR_STREAM("Costmap update error for SEQ: " << seq_nr << "\n map server is not available");
+    return false;
+  }
+  if (!clients.get_map.call(get_map_srv))
   { 
-    set_costmap_srv.request.map = get_map_srv.response.map;
-
-    if (set_costmap_client.call(set_costmap_srv))
-    { 
-      ROS_INFO_STREAM("Costmap update for SEQ: " << seq_nr);
-
-    }else{
-      ROS_ERROR_STREAM("Costmap update error for SEQ: " << seq_nr  << "\n path planner cannot set new costmap");
-
-    }
-  }else{
-
     ROS_ERROR_STREAM("Costmap update error for SEQ: " << seq_nr << "\n path planner cannot get map from map server");
-
-  }
-  const char* execute_command = "/opt/ros/indigo/bin/rosparam";
-  pid_t load_configs_costmap_pID = fork();
-  if (load_configs_costmap_pID == 0)                
-  {
-    ROS_DEBUG_STREAM("starting load_configs_costmap_pID for sequence: "<< seq_nr);
-
-    //robot_type = "NAO";
-    std::string costmap_file = robot_type+".yaml";
-    std::string load_configs_pkg_path = ros::package::getPath("rapp_path_planning");
-    // set yaml file path
-    std:: string execute_param_1_string = load_configs_pkg_path+"/cfg/costmap/"+costmap_file;
-    const char* execute_param_1 = execute_param_1_string.c_str();
-    ROS_DEBUG_STREAM("costmap file path:\n"<< execute_param_1_string);
-
-    // set params namespace
-    std:: string execute_param_2_string = "/global_planner"+seq_nr+"/costmap/";
-    const char* execute_param_2 = execute_param_2_string.c_str();
-    nh_.setParam("/global_planner"+seq_nr+"/costmap/map_service", "/map_server"+seq_nr+"/getMap");
-
-    execl(execute_command,execute_command,"load", execute_param_1,execute_param_2 , (char *)0);
-  }
-  else if (load_configs_costmap_pID < 0)            
-  {
-    std::cout << "Failed to fork load_configs" << std::endl;
     return false;
-    exit(1);
-
   }
-  else{
-    pid_t load_configs_planner_pID = fork();
-    if (load_configs_planner_pID == 0)                
-    {
-      ROS_DEBUG_STREAM("starting load_configs_planner_pID for sequence: "<< seq_nr);
-
-      //algorithm = "dijkstra";
-      std::string algorithm_file = algorithm+".yaml";
-      std::string load_configs_pkg_path = ros::package::getPath("rapp_path_planning");
-      // set yaml file path
-      std:: string execute_param_1_string =  load_configs_pkg_path+"/cfg/planner/"+algorithm_file;
-      const char* execute_param_1 = execute_param_1_string.c_str();
-      // set params namespace
-      std:: string execute_param_2_string = "/global_planner"+seq_nr+"/planner/";
-      const char* execute_param_2 = execute_param_2_string.c_str();
-      execl(execute_command,execute_command,"load", execute_param_1,execute_param_2 , (char *)0);
-    }
-    else if (load_configs_planner_pID < 0)            
-    {
-      ROS_ERROR("Failed to fork load_configs");
-      return false;
-      exit(1);
-
-    }
-    else{
-
-      std:: string costmap_param_name = "/global_planner"+seq_nr+"/costmap/map_topic";
-
-      std:: string planner_param_name = "/global_planner"+seq_nr+"/planner/use_dijkstra";
-      ros::Time time_start = ros::Time::now();
-      ros::Time time_now;
-
-      while (!nh_.hasParam(costmap_param_name) && !nh_.hasParam(planner_param_name)){
-        ros::Duration(0.1).sleep();
-        time_now = ros::Time::now();
-        if (time_now > time_start + ros::Duration(5))
-          return false;
-      }
-      return true;
-    }
+  set_costmap_srv.request.map = get_map_srv.response.map;
 
+  if (!clients.costmap_update.waitForExistence(ros::Duration(SERVICE_TIMEOUT)) ||
+      !clients.costmap_update.call(set_costmap_srv))
+  { 
+    ROS_ERROR_STREAM("Costmap update error for SEQ: " << seq_nr  << "\n path planner cannot set new costmap");
+    return false;
   }
-  return false;
+  ROS_INFO_STREAM("Costmap update for SEQ: " << seq_nr);
+  clients.key = key;
+  // The costmap and planner parameters of the sequence's global_planner are
+  // loaded once, when it is started, since the node only reads them then
+  return true;
 }
 // send request to approprate global_planner and return MakeNavPlanResponse 
 navfn::MakeNavPlanResponse PathPlanner::startSequence(std::string seq_nr, geometry_msgs::PoseStamped request_start, geometry_msgs::PoseStamped request_goal, ros::NodeHandle &nh_){
   navfn::MakeNavPlanResponse planned_path; 
-  uint32_t serv_port;
-  std::string serv_node_name, serv_name;
-  serv_name = "/global_planner"+seq_nr+"/make_plan";
-  ros::ServiceManager srv_manager; 
-  bool serv_active = srv_manager.lookupService(serv_name,serv_node_name,serv_port);
-
-  ros::Duration(1.5).sleep();
-
-  while (!serv_active){
-    ROS_ERROR("Can't find service make_plan");
-    serv_active = srv_manager.lookupService(serv_name,serv_node_name,serv_port);
-    ros::Duration(1).sleep();
-  }
-  ROS_DEBUG_STREAM("HOST name:\n" << serv_node_name << "service port:\n" << serv_port);
+  SequenceClients& clients = connectSequence(boost::lexical_cast<int>(seq_nr), nh_);
 
-  ros::ServiceClient client = nh_.serviceClient<navfn::MakeNavPlan>("/global_planner"+seq_nr+"/make_plan");
   navfn::MakeNavPlan srv;
   srv.request.start = request_start;
   srv.request.goal = request_goal;
 
-  if (client.call(srv))
+  if (clients.make_plan.waitForExistence(ros::Duration(SERVICE_TIMEOUT)) && clients.make_plan.call(srv))
   {
-    navfn::MakeNavPlanResponse planned_path; 
     planned_path = srv.response;
     ROS_DEBUG("Path planning service ended");
-    return planned_path;
-
   }
-
   else
   {
     ROS_ERROR("Failed to call service make_plan");
-    return planned_path;
   }
-
+  return planned_path;
 }
 
 
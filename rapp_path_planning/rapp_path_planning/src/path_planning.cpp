@@ -193,60 +193,116 @@ PathPlanning::PathPlanning(void)
     ROS_WARN("Path planning threads param does not exist. Setting 5 threads.");
     pathPlanningThreads_ = 5;
   }
-  TP_pID = start_tf_publisher();
-  pid_t MS_pID;
-  pid_t GP_pID;
-  // if (tf_status){
-  for (int node_nr=1;node_nr<pathPlanningThreads_+1;node_nr++)
+  if(!nh_.getParam("/rapp_path_planning_max_queue", maxQueue_))
   {
-    std::string node_nr_str = boost::lexical_cast<std::string>(node_nr);
+    ROS_WARN("Path planning max queue param does not exist. Setting to 10 requests.");
+    maxQueue_ = 10;
+  }
+  dispatcher_.reset(new SlotDispatcher(pathPlanningThreads_, std::max(maxQueue_, 0)));
+  if(!nh_.getParam("/rapp_path_planning_in_process", inProcess_))
+  {
+    ROS_WARN("Path planning in process param does not exist. Planning in process.");
+    inProcess_ = true;
+  }
+  if (inProcess_){
+    // the planning slots live in this process, no map_server or global_planner nodes are started
+    int map_store_mb;
+    if(!nh_.getParam("/rapp_path_planning_map_store_mb", map_store_mb))
+    {
+      ROS_WARN("Path planning map store param does not exist. Keeping up to 256 MB of maps.");
+      map_store_mb = 256;
+    }
+    planner_engine_.reset(new PlannerEngine(pathPlanningThreads_,
+      ros::package::getPath("rapp_path_planning")+"/cfg", (std::size_t) std::max(map_store_mb, 0) << 20));
+  }else{
+    TP_pID = start_tf_publisher();
+    pid_t MS_pID;
+    pid_t GP_pID;
+    // if (tf_status){
+    for (int node_nr=1;node_nr<pathPlanningThreads_+1;node_nr++)
+    {
+      std::string node_nr_str = boost::lexical_cast<std::string>(node_nr);
 
 
-    MS_pID = start_map_servers(node_nr_str);
-    GP_pID = start_global_planners(node_nr_str);
-    MS_pIDs.push_back(MS_pID);
-    GP_pIDs.push_back(GP_pID);
-    //bool config_status = path_planner_.configureSequence(node_nr_str, "/home/rapp/rapp_platform/rapp-platform-catkin-ws/src/rapp-platform/rapp_map_server/maps/empty.yaml", "NAO", "dijkstra", nh_);
+      MS_pID = start_map_servers(node_nr_str);
+      GP_pID = start_global_planners(node_nr_str);
+      MS_pIDs.push_back(MS_pID);
+      GP_pIDs.push_back(GP_pID);
+      //bool config_status = path_planner_.configureSequence(node_nr_str, "/home/rapp/rapp_platform/rapp-platform-catkin-ws/src/rapp-platform/rapp_map_server/maps/empty.yaml", "NAO", "dijkstra", nh_);
 
+    }
+    path_planner_.createClients(pathPlanningThreads_, nh_);
+    path_planner_.waitForSequences(ros::Duration(20));
   }
-  uint32_t serv_port;
-  std::string serv_node_name, serv_name;
-  ros::ServiceManager srv_manager;
-  // char *serv_name_char;
-  // sprintf(serv_name_char,  "/global_planner%d/make_plan", pathPlanningThreads_);
-  std::string threads_str = boost::lexical_cast<std::string>(pathPlanningThreads_);
-  serv_name = "/global_planner"+threads_str+"/make_plan";
-  bool serv_active = srv_manager.lookupService(serv_name.c_str() ,serv_node_name,serv_port);
-  int i=0;
-  while (!serv_active && i <= 20){
-    ROS_DEBUG_STREAM("Waiting for:"<<" /global_planner"<<pathPlanningThreads_<<"/make_plan" << " service ");
-    serv_active = srv_manager.lookupService(serv_name.c_str(),serv_node_name,serv_port);
-    ros::Duration(1).sleep();
-    i+=1;
-  }
-  // }
   if(!nh_.getParam("/rapp_path_planning_upload_map_topic", uploadMapTopic_))
   {
     ROS_WARN("Upload map topic param does not exist. Setting to: /rapp/rapp_path_planning/upload_map");
     pathPlanningTopic_ = "/rapp/rapp_path_planning/upload_map";
   }
+  if(!nh_.getParam("/rapp_path_planning_upload_map_chunk_topic", uploadMapChunkTopic_))
+  {
+    ROS_WARN("Upload map chunk topic param does not exist. Setting to: /rapp/rapp_path_planning/upload_map_chunk");
+    uploadMapChunkTopic_ = "/rapp/rapp_path_planning/upload_map_chunk";
+  }
+  // the chunked uploads are received here in both modes, the maps directory is shared with the map_server nodes
+  map_uploader_.reset(new map_server::MapUploader(std::string(homedir)+"/rapp_platform_files/maps"));
+
+  if(!nh_.getParam("/rapp_path_planning_stats_topic", statsTopic_))
+  {
+    ROS_WARN("Stats topic param does not exist. Setting to: /rapp/rapp_path_planning/stats");
+    statsTopic_ = "/rapp/rapp_path_planning/stats";
+  }
 
   // Creating the service server concerning the path planning functionality
   pathPlanningService_ = nh_.advertiseService(pathPlanningTopic_, 
     &PathPlanning::pathPlanningCallback, this);
   uploadMapService_ = nh_.advertiseService(uploadMapTopic_, 
     &PathPlanning::uploadMapCallback, this);
+  uploadMapChunkService_ = nh_.advertiseService(uploadMapChunkTopic_, 
+    &PathPlanning::uploadMapChunkCallback, this);
+  // the stats are served by a thread of their own, they are reported even
+  // while every spinner thread waits for a planning slot
+  statsNh_.setCallbackQueue(&statsQueue_);
+  statsService_ = statsNh_.advertiseService(statsTopic_, 
+    &PathPlanning::statsCallback, this);
+  statsSpinner_.reset(new ros::AsyncSpinner(1, &statsQueue_));
+  statsSpinner_->start();
 }
 
 
 bool PathPlanning::uploadMapCallback(rapp_platform_ros_communications::MapServerUploadMapRosSrv::Request  &req,
   rapp_platform_ros_communications::MapServerUploadMapRosSrv::Response &res){
 
-  std::string seq_nr_str = path_planner_.setSequenceNR(nh_, pathPlanningThreads_);
+  if (inProcess_){
+    std::string homedir_str = homedir;
+    try{
+      std::string yaml_path = map_server::saveUploadedMap(homedir_str+"/rapp_platform_files/maps/"+req.user_name, req);
+      ROS_INFO_STREAM("User: "<< req.user_name << " saved map: "<< yaml_path);
+      res.status = true;
+      // the costmaps are built once here rather than by the first plans on the map
+      try{
+        planner_engine_->snapshot(yaml_path);
+      }catch (std::runtime_error& e){
+        ROS_WARN_STREAM("Costmap snapshots of "<< yaml_path << " not saved: "<< e.what());
+      }
+    }catch (std::runtime_error& e){
+      ROS_ERROR_STREAM("Map upload failed: "<< e.what());
+      res.status = false;
+    }
+    return true;
+  }
+  int seq_nr = dispatcher_->acquire();
+  if (seq_nr == 0){
+    ROS_ERROR("Too many path planning requests, map upload rejected");
+    return false;
+  }
+  std::string seq_nr_str = boost::lexical_cast<std::string>(seq_nr);
   ros::ServiceClient upload_map_client = nh_.serviceClient<rapp_platform_ros_communications::MapServerUploadMapRosSrv>("/map_server"+seq_nr_str+"/upload_map");
   rapp_platform_ros_communications::MapServerUploadMapRosSrv upload_map_srv;
   upload_map_srv.request = req;
-  if(upload_map_client.call(upload_map_srv)){
+  bool status = upload_map_client.call(upload_map_srv);
+  dispatcher_->release(seq_nr);
+  if(status){
     res = upload_map_srv.response;
     return true;
   }else{
@@ -256,6 +312,23 @@ bool PathPlanning::uploadMapCallback(rapp_platform_ros_communications::MapServer
 
 }
 
+bool PathPlanning::uploadMapChunkCallback(rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Request  &req,
+  rapp_platform_ros_communications::MapServerUploadMapChunkRosSrv::Response &res){
+
+  std::string yaml_path = map_uploader_->handle(req, &res);
+  if (!yaml_path.empty()){
+    ROS_INFO_STREAM("Saved uploaded map: "<< yaml_path);
+    if (inProcess_){
+      try{
+        planner_engine_->snapshot(yaml_path);
+      }catch (std::runtime_error& e){
+        ROS_WARN_STREAM("Costmap snapshots of "<< yaml_path << " not saved: "<< e.what());
+      }
+    }
+  }
+  return true;
+}
+
 std::vector<geometry_msgs::PoseStamped> setPoseDist(double pose_dist, std::vector<geometry_msgs::PoseStamped> input_path){
     geometry_msgs::PoseStamped last_pose;
     geometry_msgs::PoseStamped next_pose;
@@ -314,26 +387,43 @@ bool PathPlanning::pathPlanningCallback(
       if (exists_file(costmap_file_path)){
         if (exists_file(map_path)){
           ROS_DEBUG("NEW <<Path_planning>> SERVICE STARTED");
-          std::string seq_nr_str = path_planner_.setSequenceNR(nh_, pathPlanningThreads_);
+          std::string affinity = PlanningKey(map_path, req.robot_type, req.algorithm).affinity();
+          int seq_nr = dispatcher_->acquire(affinity);
+          if (seq_nr == 0){
+            res.plan_found = 6;
+            res.error_message = "Too many path planning requests, try again later";
+            ROS_ERROR("Too many path planning requests, request rejected");
+            return true;
+          }
+          std::string seq_nr_str = boost::lexical_cast<std::string>(seq_nr);
           ROS_DEBUG_STREAM("SEQ-NR is: " << seq_nr_str);
-          bool config_status = path_planner_.configureSequence(seq_nr_str, map_path, req.robot_type, req.algorithm, nh_);
-
-          response = path_planner_.startSequence(seq_nr_str, req.start, req.goal, nh_);
+          bool config_status;
+          if (inProcess_){
+            response = planner_engine_->plan(seq_nr, map_path, req.robot_type, req.algorithm, req.start, req.goal);
+            config_status = response.error_message.empty();
+          }else{
+            config_status = path_planner_.configureSequence(seq_nr_str, map_path, req.robot_type, req.algorithm, nh_);
+
+            response = path_planner_.startSequence(seq_nr_str, req.start, req.goal, nh_);
+          }
+          // later requests for the same map are steered to the slot holding it
+          dispatcher_->release(seq_nr, config_status ? affinity : std::string());
 
           res.plan_found =  response.plan_found;
 
           res.error_message = response.error_message;
 
-	  new_path.clear();
+	  // locals, since the callback runs on several spinner threads at once
+	  std::vector<geometry_msgs::PoseStamped> new_path;
 	  if (res.plan_found == 1){
-          nh_.param<double>("rapp_path_planning_pose_distance", pose_dist_, 0.15);
+          double pose_dist;
+          nh_.param<double>("rapp_path_planning_pose_distance", pose_dist, 0.15);
 
-          new_path = setPoseDist(pose_dist_, response.path);
+          new_path = setPoseDist(pose_dist, response.path);
 	  }
 
           res.path  = new_path;
 
-          nh_.setParam("/rapp/rapp_path_planning/seq_"+seq_nr_str+"/busy", false);
         }else{
           res.plan_found = 2;
           res.error_message = "Input map does not exist";
@@ -364,4 +454,34 @@ bool PathPlanning::pathPlanningCallback(
 
 }
 
-
+bool PathPlanning::statsCallback(
+  rapp_platform_ros_communications::PathPlanningStatsRosSrv::Request& req,
+  rapp_platform_ros_communications::PathPlanningStatsRosSrv::Response& res)
+{
+  SlotDispatcher::Stats stats = dispatcher_->stats();
+  res.slots = stats.slots;
+  res.dispatched = stats.dispatched;
+  res.rejected = stats.rejected;
+  res.queue_depth = stats.queue_depth;
+  res.max_queue_depth = stats.max_queue_depth;
+  res.mean_wait_ms = stats.mean_wait_ms;
+  res.max_wait_ms = stats.max_wait_ms;
+  unsigned long hits, misses;
+  if (inProcess_)
+    planner_engine_->cacheStats(&hits, &misses);
+  else
+    path_planner_.cacheStats(&hits, &misses);
+  res.cache_hits = hits;
+  res.cache_misses = misses;
+  if (inProcess_){
+    MapStore::Stats map_stats = planner_engine_->mapStoreStats();
+    res.map_hits = map_stats.hits;
+    res.map_misses = map_stats.misses;
+    res.map_evictions = map_stats.evictions;
+    res.resident_maps = map_stats.maps;
+    res.resident_bytes = map_stats.bytes;
+    res.map_budget_bytes = map_stats.budget;
+    res.resident_map_names = map_stats.names;
+  }
+  return true;
+}
@@ -24,6 +24,17 @@ int main(int argc, char ** argv)
   {
     threads = 1;
   }
+  // requests beyond the planning slots wait in the dispatcher's queue, or are
+  // rejected when it is full, instead of waiting unnoticed for a spinner
+  // thread: one thread more than the slots and the queue takes the requests
+  // beyond them and rejects them
+  int max_queue = 10;
+  nh.getParam("/rapp_path_planning_max_queue", max_queue);
+  if(max_queue > 0)
+  {
+    threads += max_queue;
+  }
+  threads += 1;
   ros::MultiThreadedSpinner spinner(threads);
   signal(SIGINT, mySigintHandler); 
   spinner.spin();
@@ -0,0 +1,255 @@
+#include <path_planning/planner_engine.h>
+#include <path_planning/costmap_builder.h>
+#include <path_planning/costmap_snapshot.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <map_server/map_loader.h>
+#include <yaml-cpp/yaml.h>
+
+namespace
+{
+
+// The frame of the maps and the plans, as published by map_server
+const char* const PLAN_FRAME = "map";
+
+// copies a YAML map to the parameter server, below the given namespace
+void setParams(ros::NodeHandle& nh, const std::string& ns, const YAML::Node& node){
+  for (YAML::const_iterator it = node.begin(); it != node.end(); ++it){
+    std::string name = ns + "/" + it->first.as<std::string>();
+    const YAML::Node& value = it->second;
+    bool bool_value;
+    int int_value;
+    double double_value;
+    if (value.IsMap())
+      setParams(nh, name, value);
+    else if (!value.IsScalar())
+      ROS_WARN_STREAM("Planner parameter " << name << " is not a scalar, skipping it");
+    else if (YAML::convert<bool>::decode(value, bool_value))
+      nh.setParam(name, bool_value);
+    else if (YAML::convert<int>::decode(value, int_value))
+      nh.setParam(name, int_value);
+    else if (YAML::convert<double>::decode(value, double_value))
+      nh.setParam(name, double_value);
+    else
+      nh.setParam(name, value.as<std::string>());
+  }
+}
+
+}
+
+PlannerEngine::PlannerEngine(unsigned int slots, const std::string& config_dir, std::size_t map_store_bytes) :
+  config_dir_(config_dir),
+  map_store_(map_store_bytes, PLAN_FRAME),
+  private_nh_("~"),
+  stopping_(false),
+  cache_hits_(0),
+  cache_misses_(0)
+{
+  if (slots == 0)
+    slots = 1;
+  for (unsigned int i = 0; i < slots; i++){
+    boost::shared_ptr<Slot> slot(new Slot);
+    slot->id = i + 1;
+    slot->job = NULL;
+    slots_.push_back(slot);
+    workers_.create_thread(boost::bind(&PlannerEngine::work, this, slot));
+  }
+}
+
+PlannerEngine::~PlannerEngine(void){
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopping_ = true;
+  }
+  for (unsigned int i = 0; i < slots_.size(); i++)
+    slots_[i]->job_available.notify_all();
+  workers_.join_all();
+}
+
+unsigned int PlannerEngine::size(void) const{
+  return slots_.size();
+}
+
+void PlannerEngine::cacheStats(unsigned long* hits, unsigned long* misses) const{
+  boost::mutex::scoped_lock lock(mutex_);
+  *hits = cache_hits_;
+  *misses = cache_misses_;
+}
+
+MapStore::Stats PlannerEngine::mapStoreStats(void) const{
+  return map_store_.stats();
+}
+
+void PlannerEngine::snapshot(const std::string& map_path){
+  boost::filesystem::path costmap_dir(config_dir_ + "/costmap");
+  boost::filesystem::directory_iterator end;
+  boost::shared_ptr<const nav_msgs::OccupancyGrid> map;
+  for (boost::filesystem::directory_iterator it(costmap_dir); it != end; ++it){
+    if (it->path().extension() != ".yaml")
+      continue;
+    std::string robot_type = it->path().stem().string();
+    PlanningKey key(map_path, robot_type, std::string());
+    uint64_t config_hash = CostmapSnapshot::configHash(it->path().string());
+    std::string snapshot_path = CostmapSnapshot::path(map_path, robot_type);
+    CostmapSnapshot snapshot;
+    if (snapshot.open(snapshot_path, key, config_hash))
+      continue;
+    if (!map)
+      map = map_store_.get(key);
+    costmap_2d::Costmap2D costmap;
+    CostmapBuilder builder(CostmapConfig::load(it->path().string()));
+    builder.build(*map, &costmap);
+    CostmapSnapshot::save(snapshot_path, key, config_hash, costmap);
+    ROS_INFO_STREAM("Saved costmap snapshot " << snapshot_path);
+  }
+}
+
+navfn::MakeNavPlanResponse PlannerEngine::plan(int slot, const std::string& map_path, const std::string& robot_type,
+  const std::string& algorithm, const geometry_msgs::PoseStamped& start,
+  const geometry_msgs::PoseStamped& goal){
+  navfn::MakeNavPlanResponse response;
+  if (slot < 1 || slot > (int) slots_.size()){
+    response.plan_found = 0;
+    response.error_message = "Invalid planning slot";
+    return response;
+  }
+  bool done = false;
+  Job job;
+  job.map_path = &map_path;
+  job.robot_type = &robot_type;
+  job.algorithm = &algorithm;
+  job.start = &start;
+  job.goal = &goal;
+  job.response = &response;
+  job.done = &done;
+
+  Slot& target = *slots_[slot - 1];
+  boost::mutex::scoped_lock lock(mutex_);
+  if (stopping_){
+    response.plan_found = 0;
+    response.error_message = "Path planning is stopping";
+    return response;
+  }
+  target.job = &job;
+  target.job_available.notify_one();
+  while (!done)
+    job_done_.wait(lock);
+  return response;
+}
+
+void PlannerEngine::work(boost::shared_ptr<Slot> slot){
+  while (true){
+    Job job;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (!slot->job && !stopping_)
+        slot->job_available.wait(lock);
+      if (stopping_){
+        // a request handed to the slot meanwhile fails, or its caller would wait forever
+        if (slot->job){
+          slot->job->response->plan_found = 0;
+          slot->job->response->error_message = "Path planning is stopping";
+          *slot->job->done = true;
+          slot->job = NULL;
+          job_done_.notify_all();
+        }
+        return;
+      }
+      job = *slot->job;
+      slot->job = NULL;
+    }
+
+    navfn::MakeNavPlanResponse response = serve(*slot, job);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    *job.response = response;
+    *job.done = true;
+    job_done_.notify_all();
+  }
+}
+
+navfn::MakeNavPlanResponse PlannerEngine::serve(Slot& slot, const Job& job){
+  navfn::MakeNavPlanResponse response;
+  response.plan_found = 0;
+  try{
+    PlanningKey key(*job.map_path, *job.robot_type, *job.algorithm);
+    bool hit = slot.key.sameCostmap(key);
+    if (hit){
+      std::copy(slot.pristine.begin(), slot.pristine.end(), slot.costmap.getCharMap());
+    }else{
+      slot.key = PlanningKey();
+      loadCostmap(key, &slot.costmap);
+      unsigned char* grid = slot.costmap.getCharMap();
+      slot.pristine.assign(grid, grid + (std::size_t) slot.costmap.getSizeInCellsX() * slot.costmap.getSizeInCellsY());
+      slot.key = key;
+    }
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (hit)
+        cache_hits_++;
+      else
+        cache_misses_++;
+    }
+
+    global_planner::GlobalPlanner& global_planner = planner(slot, *job.algorithm);
+    // like the make_plan service of global_planner, the poses are taken in the map frame
+    geometry_msgs::PoseStamped start = *job.start, goal = *job.goal;
+    start.header.frame_id = PLAN_FRAME;
+    goal.header.frame_id = PLAN_FRAME;
+    std::vector<geometry_msgs::PoseStamped> path;
+    if (global_planner.makePlan(start, goal, path)){
+      response.plan_found = 1;
+      response.path = path;
+    }
+    ROS_DEBUG_STREAM("Slot " << slot.id << " planned a path of " << path.size() << " poses");
+  }catch (std::runtime_error& e){
+    ROS_ERROR_STREAM("Slot " << slot.id << " cannot plan: " << e.what());
+    response.error_message = e.what();
+  }
+  return response;
+}
+
+void PlannerEngine::loadCostmap(const PlanningKey& key, costmap_2d::Costmap2D* costmap){
+  std::string config_path = config_dir_ + "/costmap/" + key.robot_type + ".yaml";
+  uint64_t config_hash = CostmapSnapshot::configHash(config_path);
+  std::string snapshot_path = CostmapSnapshot::path(key.map_path, key.robot_type);
+  CostmapSnapshot snapshot;
+  if (snapshot.open(snapshot_path, key, config_hash)){
+    snapshot.copyTo(costmap);
+    ROS_DEBUG_STREAM("Loaded costmap snapshot " << snapshot_path);
+    return;
+  }
+
+  boost::shared_ptr<const nav_msgs::OccupancyGrid> map = map_store_.get(key);
+  CostmapBuilder builder(CostmapConfig::load(config_path));
+  builder.build(*map, costmap);
+  // the maps shipped with the platform live in the source tree, their costmaps are built every time
+  if (!map_server::isUserMap(key.map_path))
+    return;
+  // the map directory may be read-only, in which case the costmap is built every time
+  try{
+    CostmapSnapshot::save(snapshot_path, key, config_hash, *costmap);
+  }catch (std::runtime_error& e){
+    ROS_WARN_STREAM("Costmap snapshot not saved: " << e.what());
+  }
+}
+
+global_planner::GlobalPlanner& PlannerEngine::planner(Slot& slot, const std::string& algorithm){
+  boost::shared_ptr<global_planner::GlobalPlanner>& global_planner = slot.planners[algorithm];
+  if (!global_planner){
+    std::string name = "slot" + boost::lexical_cast<std::string>(slot.id) + "/" + algorithm;
+    std::string algorithm_file_path = config_dir_ + "/planner/" + algorithm + ".yaml";
+    try{
+      setParams(private_nh_, name, YAML::LoadFile(algorithm_file_path));
+    }catch (YAML::Exception& e){
+      slot.planners.erase(algorithm);
+      throw std::runtime_error("cannot read planner configuration " + algorithm_file_path + ": " + e.what());
+    }
+    global_planner.reset(new global_planner::GlobalPlanner(name, &slot.costmap, PLAN_FRAME));
+  }
+  return *global_planner;
+}
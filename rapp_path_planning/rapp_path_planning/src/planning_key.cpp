@@ -0,0 +1,38 @@
+#include <path_planning/planning_key.h>
+
+#include <sys/stat.h>
+
+PlanningKey::PlanningKey(void) :
+  map_mtime(0),
+  map_mtime_nsec(0)
+{
+}
+
+PlanningKey::PlanningKey(const std::string& map_path, const std::string& robot_type, const std::string& algorithm) :
+  map_path(map_path),
+  map_mtime(0),
+  map_mtime_nsec(0),
+  robot_type(robot_type),
+  algorithm(algorithm)
+{
+  struct stat buffer;
+  if (stat(map_path.c_str(), &buffer) == 0){
+    map_mtime = buffer.st_mtim.tv_sec;
+    map_mtime_nsec = buffer.st_mtim.tv_nsec;
+  }
+}
+
+bool PlanningKey::sameCostmap(const PlanningKey& other) const{
+  return !map_path.empty() && map_path == other.map_path && map_mtime == other.map_mtime &&
+    map_mtime_nsec == other.map_mtime_nsec && robot_type == other.robot_type;
+}
+
+bool PlanningKey::operator==(const PlanningKey& other) const{
+  return sameCostmap(other) && algorithm == other.algorithm;
+}
+
+std::string PlanningKey::affinity(void) const{
+  if (map_path.empty())
+    return std::string();
+  return map_path + "|" + robot_type + "|" + algorithm;
+}
@@ -0,0 +1,95 @@
+#include <path_planning/slot_dispatcher.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+SlotDispatcher::SlotDispatcher(unsigned int slots, unsigned int max_queue) :
+  busy_(slots > 0 ? slots : 1, false),
+  served_(busy_.size(), 0),
+  affinity_(busy_.size()),
+  max_queue_(max_queue),
+  next_ticket_(0),
+  head_ticket_(0),
+  dispatched_(0),
+  rejected_(0),
+  max_queue_depth_(0),
+  total_wait_ms_(0),
+  max_wait_ms_(0)
+{
+}
+
+int SlotDispatcher::acquire(const std::string& affinity){
+  boost::posix_time::ptime arrival = boost::posix_time::microsec_clock::universal_time();
+  boost::mutex::scoped_lock lock(mutex_);
+  // requests only wait if a slot is busy or others are already waiting
+  unsigned int queue_depth = next_ticket_ - head_ticket_;
+  if (queue_depth >= max_queue_ && (queue_depth > 0 || idleSlot(affinity) < 0)){
+    rejected_++;
+    return 0;
+  }
+  unsigned long ticket = next_ticket_++;
+  int slot = ticket == head_ticket_ ? idleSlot(affinity) : -1;
+  if (slot < 0){
+    // only the requests that actually wait count for the queue depth
+    if (next_ticket_ - head_ticket_ > max_queue_depth_)
+      max_queue_depth_ = next_ticket_ - head_ticket_;
+    while (ticket != head_ticket_ || (slot = idleSlot(affinity)) < 0)
+      changed_.wait(lock);
+  }
+  head_ticket_++;
+  busy_[slot] = true;
+  served_[slot]++;
+
+  double wait_ms = (boost::posix_time::microsec_clock::universal_time() - arrival).total_microseconds() / 1000.0;
+  dispatched_++;
+  total_wait_ms_ += wait_ms;
+  if (wait_ms > max_wait_ms_)
+    max_wait_ms_ = wait_ms;
+  // the next request in the queue may find another idle slot
+  changed_.notify_all();
+  return slot + 1;
+}
+
+void SlotDispatcher::release(int slot, const std::string& affinity){
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (slot < 1 || slot > (int) busy_.size())
+      return;
+    busy_[slot - 1] = false;
+    affinity_[slot - 1] = affinity;
+  }
+  changed_.notify_all();
+}
+
+unsigned int SlotDispatcher::size(void) const{
+  return busy_.size();
+}
+
+SlotDispatcher::Stats SlotDispatcher::stats(void) const{
+  boost::mutex::scoped_lock lock(mutex_);
+  Stats stats;
+  stats.slots = busy_.size();
+  stats.dispatched = dispatched_;
+  stats.rejected = rejected_;
+  stats.queue_depth = next_ticket_ - head_ticket_;
+  stats.max_queue_depth = max_queue_depth_;
+  stats.mean_wait_ms = dispatched_ > 0 ? total_wait_ms_ / dispatched_ : 0;
+  stats.max_wait_ms = max_wait_ms_;
+  return stats;
+}
+
+int SlotDispatcher::idleSlot(const std::string& affinity) const{
+  int slot = -1;
+  bool matches = false;
+  for (unsigned int i = 0; i < busy_.size(); i++){
+    if (busy_[i])
+      continue;
+    bool slot_matches = !affinity.empty() && affinity_[i] == affinity;
+    // a matching slot beats any other, then the least-loaded one wins
+    if (slot < 0 || (slot_matches && !matches) ||
+        (slot_matches == matches && served_[i] < served_[slot])){
+      slot = i;
+      matches = slot_matches;
+    }
+  }
+  return slot;
+}
@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ros/ros.h"
+#include "ros/package.h"
+#include <path_planning/planner_engine.h>
+#include <rapp_platform_ros_communications/PathPlanningRosSrv.h>
+
+/**
+ * @brief Returns the milliseconds elapsed since the given wall time
+ */
+double elapsedMs(ros::WallTime start)
+{
+  return (ros::WallTime::now() - start).toSec() * 1000.0;
+}
+
+/**
+ * @brief Returns a percentile of the given latencies
+ * @param samples [std::vector<double>] The latencies [ms],
+ * @param percent [int] The percentile, 0 to 100.
+ * @return [double] The latency below which the given percent of the samples fall.
+ */
+double percentile(std::vector<double> samples, int percent)
+{
+  if (samples.empty())
+    return 0;
+  std::sort(samples.begin(), samples.end());
+  return samples[(samples.size() - 1) * percent / 100];
+}
+
+/**
+ * @brief Prints the p50/p99 latencies of a set of plans
+ */
+void report(const char* name, const std::vector<double>& samples, int found)
+{
+  printf("%-32s p50 %9.2f ms  p99 %9.2f ms  (%d/%zu plans found)\n", name,
+    percentile(samples, 50), percentile(samples, 99), found, samples.size());
+}
+
+/**
+ * @brief Builds a pose in the map frame
+ */
+geometry_msgs::PoseStamped makePose(double x, double y)
+{
+  geometry_msgs::PoseStamped pose;
+  pose.header.frame_id = "/map";
+  pose.pose.position.x = x;
+  pose.pose.position.y = y;
+  pose.pose.position.z = 0;
+  pose.pose.orientation.x = 0;
+  pose.pose.orientation.y = 0;
+  pose.pose.orientation.z = 0;
+  pose.pose.orientation.w = 1;
+  return pose;
+}
+
+/**
+ * @brief Times the plans of an in-process planning slot on a map of rapp_map_server
+ * @param map_name [const char*] Name of the map in rapp_map_server/maps,
+ * @param iterations [int] The number of timed plans.
+ */
+void benchmarkEngine(const char* map_name, int iterations)
+{
+  std::string map_path = ros::package::getPath("rapp_map_server") + "/maps/" + map_name + ".yaml";
+  PlannerEngine engine(1, ros::package::getPath("rapp_path_planning") + "/cfg");
+  geometry_msgs::PoseStamped start = makePose(1, 1), goal = makePose(5.3, 4);
+
+  std::vector<double> samples;
+  int found = 0;
+  for (int i = 0; i < iterations; i++)
+  {
+    ros::WallTime begin = ros::WallTime::now();
+    navfn::MakeNavPlanResponse response = engine.plan(1, map_path, "NAO", "dijkstra", start, goal);
+    samples.push_back(elapsedMs(begin));
+    found += response.plan_found == 1;
+  }
+  std::string name = std::string("in-process, ") + map_name;
+  report(name.c_str(), samples, found);
+}
+
+/**
+ * @brief Times the plans of a running path planning node, whichever planning backend it uses
+ * @param topic [const std::string&] The path planning service,
+ * @param user [const char*] Owner of the map,
+ * @param map_name [const char*] Name of the user's map,
+ * @param iterations [int] The number of timed plans.
+ */
+void benchmarkService(const std::string& topic, const char* user, const char* map_name, int iterations)
+{
+  if (!ros::service::waitForService(topic, 2000))
+  {
+    printf("%s is not available, skipping the service benchmark\n", topic.c_str());
+    return;
+  }
+  rapp_platform_ros_communications::PathPlanningRosSrv srv;
+  srv.request.user_name = user;
+  srv.request.map_name = map_name;
+  srv.request.robot_type = "NAO";
+  srv.request.algorithm = "dijkstra";
+  srv.request.start = makePose(1, 1);
+  srv.request.goal = makePose(5.3, 4);
+
+  std::vector<double> samples;
+  int found = 0;
+  for (int i = 0; i < iterations; i++)
+  {
+    ros::WallTime begin = ros::WallTime::now();
+    bool called = ros::service::call(topic, srv);
+    samples.push_back(elapsedMs(begin));
+    found += called && srv.response.plan_found == 1;
+  }
+  std::string name = std::string("service, ") + user + "/" + map_name;
+  report(name.c_str(), samples, found);
+}
+
+/**
+ * @brief Measures the latency of single plans: in-process on the maps shipped with
+ * rapp_map_server, and end-to-end through the path planning service when a node
+ * is running. Requires a running roscore.
+ * Usage: path_planning_benchmark [iterations] [user] [map]
+ */
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "path_planning_benchmark");
+  int iterations = argc > 1 ? atoi(argv[1]) : 50;
+  const char* user = argc > 2 ? argv[2] : "functional_test";
+  const char* map_name = argc > 3 ? argv[3] : "empty";
+
+  ros::NodeHandle nh;
+  std::string topic;
+  nh.param<std::string>("/rapp_path_planning_plan_path_topic", topic, "/rapp/rapp_path_planning/planPath2d");
+
+  printf("Iterations: %d\n", iterations);
+  benchmarkEngine("empty", iterations);
+  benchmarkEngine("523_m", iterations);
+  benchmarkService(topic, user, map_name, iterations);
+  return 0;
+}
@@ -9,15 +9,19 @@ import rospkg
 import roslaunch
 from rapp_platform_ros_communications.srv import (
   PathPlanningRosSrv,
-  PathPlanningRosSrvRequest
+  PathPlanningRosSrvRequest,
+  PathPlanningStatsRosSrv
   )
 # upload map test
 import base64
 import shutil
 from rapp_platform_ros_communications.srv  import MapServerUploadMapRosSrv, MapServerUploadMapRosSrvRequest
+from rapp_platform_ros_communications.srv  import MapServerUploadMapChunkRosSrv, MapServerUploadMapChunkRosSrvRequest
+import zlib
 from std_msgs.msg import ByteMultiArray
 import os
 from os.path import expanduser
+import threading
 
 
 class PathPlanFunc(unittest.TestCase):
@@ -335,6 +339,114 @@ class PathPlanFunc(unittest.TestCase):
         status = response.status
 
         self.assertEqual( status, True )
+
+    def test_map_upload_chunked(self):
+
+        rospack_map = rospkg.RosPack()
+        node_name = 'rapp_map_server_functional_test2'
+
+        upload_service = "/"+node_name+"/upload_map_chunk"
+        rospy.wait_for_service(upload_service)
+        up_prox = rospy.ServiceProxy(upload_service, MapServerUploadMapChunkRosSrv)
+        map_server_path = rospack_map.get_path("rapp_map_server")
+
+        with open(map_server_path+"/maps/523_m3.png", "rb") as imageFile:
+            file_bytes = bytes(imageFile.read())
+
+        req = MapServerUploadMapChunkRosSrvRequest()
+        req.action = MapServerUploadMapChunkRosSrvRequest.BEGIN
+        req.user_name = "functional_test"
+        req.map_name = "523_m_chunked_test"
+        req.resolution = 0.02
+        req.origin = [0.0,0.0,0]
+        req.negate = 0
+        req.occupied_thresh = 0.65
+        req.free_thresh = 0.196
+        response = up_prox(req)
+        self.assertEqual( response.status, True )
+        upload_id = response.upload_id
+
+        chunk_size = 4096
+        for offset in range(0, len(file_bytes), chunk_size):
+            req = MapServerUploadMapChunkRosSrvRequest()
+            req.action = MapServerUploadMapChunkRosSrvRequest.APPEND
+            req.upload_id = upload_id
+            req.user_name = "functional_test"
+            req.offset = offset
+            req.data = file_bytes[offset:offset+chunk_size]
+            response = up_prox(req)
+            self.assertEqual( response.status, True )
+        # a chunk sent twice is refused, the upload stays where it was
+        response = up_prox(req)
+        self.assertEqual( response.status, False )
+        self.assertEqual( response.received, len(file_bytes) )
+        # another user cannot continue the upload
+        req.user_name = "functional_test_other"
+        req.offset = len(file_bytes)
+        response = up_prox(req)
+        self.assertEqual( response.status, False )
+
+        req = MapServerUploadMapChunkRosSrvRequest()
+        req.action = MapServerUploadMapChunkRosSrvRequest.COMMIT
+        req.upload_id = upload_id
+        req.user_name = "functional_test"
+        req.file_size = len(file_bytes)
+        req.crc32 = zlib.crc32(file_bytes) & 0xffffffff
+        response = up_prox(req)
+
+        self.assertEqual( response.status, True )
+
+    def test_tooManyRequests(self):
+
+        path_service = rospy.get_param("rapp_path_planning_plan_path_topic")
+        stats_service = rospy.get_param("rapp_path_planning_stats_topic")
+        rospy.wait_for_service(path_service)
+        rospy.wait_for_service(stats_service)
+        st_service = rospy.ServiceProxy(stats_service, PathPlanningStatsRosSrv)
+        req = PathPlanningRosSrvRequest()
+
+        req.user_name = "functional_test"
+
+        req.map_name = "empty"
+        req.robot_type = "NAO"
+        req.algorithm = "dijkstra"
+
+        req.start.header.frame_id = "/map"
+        req.goal.header = req.start.header
+
+        req.start.pose.position.x = 1
+        req.start.pose.position.y = 1
+        req.start.pose.orientation.x = 1
+        req.start.pose.orientation.w = 1
+
+        req.goal.pose.position.x = 5.3
+        req.goal.pose.position.y = 4
+        req.goal.pose.orientation = req.start.pose.orientation
+
+        # many more requests than planning slots and queued requests are sent
+        # at once, those beyond them are rejected rather than left waiting
+        plans_found = []
+        lock = threading.Lock()
+        def plan():
+            pp_service = rospy.ServiceProxy(path_service, PathPlanningRosSrv)
+            response = pp_service(req)
+            with lock:
+                plans_found.append(response.plan_found)
+
+        for burst in range(5):
+            threads = [threading.Thread(target=plan) for i in range(100)]
+            for thread in threads:
+                thread.start()
+            # the stats are answered while the planning requests are pending
+            stats = st_service()
+            for thread in threads:
+                thread.join()
+            if 6 in plans_found:
+                break
+
+        self.assertIn( 6, plans_found )
+        self.assertEqual( set(plans_found) - set([1, 6]), set() )
+        self.assertGreater( stats.slots, 0 )
 if __name__ == '__main__':
     import rosunit
     home = expanduser("~")
@@ -0,0 +1,534 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <costmap_2d/cost_values.h>
+#include <path_planning/costmap_builder.h>
+#include <path_planning/costmap_snapshot.h>
+#include <path_planning/map_store.h>
+#include <path_planning/slot_dispatcher.h>
+#include <ros/package.h>
+
+/**
+ * @class CostmapBuilderTest
+ * @brief Checks the in-process costmaps against a brute-force inflation
+ */
+class CostmapBuilderTest : public ::testing::Test
+{
+  protected:
+
+    /**
+     * @brief Default constructor
+     */
+    CostmapBuilderTest()
+    {
+    }
+
+    /**
+     * @brief Sets up a costmap configuration inflating a few cells around the obstacles
+     */
+    virtual void SetUp()
+    {
+      config_.inscribed_radius = 0.1;
+      config_.inflation_radius = 0.3;
+      config_.cost_scaling_factor = 10.0;
+      config_.lethal_threshold = 100;
+      config_.unknown_cost_value = 255;
+      config_.track_unknown_space = true;
+      config_.trinary_costmap = true;
+    }
+
+    /**
+     * @brief Returns an empty map of the given size, with a resolution of 0.05 m/cell
+     */
+    nav_msgs::OccupancyGrid emptyMap(unsigned int width, unsigned int height)
+    {
+      nav_msgs::OccupancyGrid map;
+      map.info.width = width;
+      map.info.height = height;
+      map.info.resolution = 0.05;
+      map.data.assign(width * height, 0);
+      return map;
+    }
+
+    /**
+     * @brief Inflates the map the way InflationLayer does, from the distance of every cell to every lethal cell
+     */
+    std::vector<unsigned char> bruteForce(const nav_msgs::OccupancyGrid& map)
+    {
+      int width = map.info.width, height = map.info.height;
+      double resolution = map.info.resolution;
+      int radius = (int) ceil(config_.inflation_radius / resolution);
+      std::vector<unsigned char> costs(map.data.size());
+      for (std::size_t i = 0; i < map.data.size(); i++)
+      {
+        unsigned char value = map.data[i];
+        if (value == config_.unknown_cost_value)
+          costs[i] = costmap_2d::NO_INFORMATION;
+        else if (value >= config_.lethal_threshold)
+          costs[i] = costmap_2d::LETHAL_OBSTACLE;
+        else
+          costs[i] = costmap_2d::FREE_SPACE;
+      }
+
+      std::vector<unsigned char> inflated = costs;
+      for (int y = 0; y < height; y++)
+      {
+        for (int x = 0; x < width; x++)
+        {
+          unsigned char& cost = inflated[y * width + x];
+          if (cost == costmap_2d::LETHAL_OBSTACLE)
+            continue;
+          double distance = -1;
+          for (int oy = 0; oy < height; oy++)
+            for (int ox = 0; ox < width; ox++)
+              if (costs[oy * width + ox] == costmap_2d::LETHAL_OBSTACLE)
+              {
+                double d = sqrt((double) ((x - ox) * (x - ox) + (y - oy) * (y - oy)));
+                if (distance < 0 || d < distance)
+                  distance = d;
+              }
+          if (distance < 0 || distance > radius)
+            continue;
+          unsigned char inflation;
+          if (distance * resolution <= config_.inscribed_radius)
+            inflation = costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
+          else
+            inflation = (unsigned char) ((costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1) *
+              exp(-1.0 * config_.cost_scaling_factor * (distance * resolution - config_.inscribed_radius)));
+          if (cost == costmap_2d::NO_INFORMATION)
+          {
+            if (inflation >= costmap_2d::INSCRIBED_INFLATED_OBSTACLE)
+              cost = inflation;
+          }
+          else
+          {
+            cost = std::max(cost, inflation);
+          }
+        }
+      }
+      return inflated;
+    }
+
+    /**
+     * @brief Builds the costmap of a map and returns its costs
+     */
+    std::vector<unsigned char> build(const nav_msgs::OccupancyGrid& map)
+    {
+      CostmapBuilder builder(config_);
+      costmap_2d::Costmap2D costmap;
+      builder.build(map, &costmap);
+      const unsigned char* grid = costmap.getCharMap();
+      return std::vector<unsigned char>(grid, grid + map.data.size());
+    }
+
+    CostmapConfig config_; /**< The robot's costmap configuration */
+};
+
+/**
+ * @brief Tests scattered obstacles and unknown cells, some of them at the map border
+ */
+TEST_F(CostmapBuilderTest, scattered_obstacles_test)
+{
+  nav_msgs::OccupancyGrid map = emptyMap(23, 17);
+  map.data[0] = 100;
+  map.data[5 * 23 + 7] = 100;
+  map.data[16 * 23 + 22] = 100;
+  map.data[9 * 23 + 15] = 100;
+  for (int x = 10; x < 14; x++)
+    map.data[12 * 23 + x] = -1;
+  map.data[6 * 23 + 8] = -1;
+  map.data[2 * 23 + 20] = 50;
+
+  std::vector<unsigned char> expected = bruteForce(map);
+  EXPECT_TRUE(expected == build(map));
+}
+
+/**
+ * @brief Tests thick obstacles. Only their boundary cells are stamped, thus the costs next to them must still
+ *        match the distance to the closest lethal cell.
+ */
+TEST_F(CostmapBuilderTest, thick_obstacles_test)
+{
+  nav_msgs::OccupancyGrid map = emptyMap(30, 20);
+  for (int y = 4; y < 11; y++)
+    for (int x = 5; x < 13; x++)
+      map.data[y * 30 + x] = 100;
+  for (int y = 0; y < 20; y++)
+    for (int x = 20; x < 24; x++)
+      map.data[y * 30 + x] = 100;
+  map.data[15 * 30 + 9] = -1;
+
+  std::vector<unsigned char> expected = bruteForce(map);
+  EXPECT_TRUE(expected == build(map));
+}
+
+/**
+ * @brief Tests that a map without free cells stays lethal
+ */
+TEST_F(CostmapBuilderTest, all_lethal_test)
+{
+  nav_msgs::OccupancyGrid map = emptyMap(8, 6);
+  std::fill(map.data.begin(), map.data.end(), 100);
+  std::vector<unsigned char> costs = build(map);
+  EXPECT_EQ(map.data.size(), std::count(costs.begin(), costs.end(), costmap_2d::LETHAL_OBSTACLE));
+}
+
+/**
+ * @class SlotDispatcherTest
+ * @brief Hands requests to the slots of a dispatcher from several threads
+ */
+class SlotDispatcherTest : public ::testing::Test
+{
+  public:
+
+    /**
+     * @brief Default constructor
+     */
+    SlotDispatcherTest()
+    {
+    }
+
+    /**
+     * @brief Waits until the given number of requests waits for a slot
+     */
+    void waitForQueue(const SlotDispatcher& dispatcher, unsigned int depth)
+    {
+      for (int i = 0; i < 5000 && dispatcher.stats().queue_depth != depth; i++)
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+      ASSERT_EQ(depth, dispatcher.stats().queue_depth);
+    }
+
+    /**
+     * @brief Acquires a slot, records the request's number and releases the slot
+     */
+    void request(SlotDispatcher* dispatcher, int number)
+    {
+      int slot = dispatcher->acquire();
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        served_.push_back(number);
+      }
+      dispatcher->release(slot);
+    }
+
+    boost::mutex mutex_; /**< Guards the served requests */
+    std::vector<int> served_; /**< Numbers of the served requests, in the order they got a slot */
+};
+
+/**
+ * @brief Tests that requests served at once are not counted as queued
+ */
+TEST_F(SlotDispatcherTest, idle_slots_test)
+{
+  SlotDispatcher dispatcher(2, 0);
+  int first = dispatcher.acquire();
+  int second = dispatcher.acquire();
+  EXPECT_NE(0, first);
+  EXPECT_NE(0, second);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(0, dispatcher.acquire());
+  dispatcher.release(first);
+  dispatcher.release(second);
+
+  SlotDispatcher::Stats stats = dispatcher.stats();
+  EXPECT_EQ(2, stats.dispatched);
+  EXPECT_EQ(1, stats.rejected);
+  EXPECT_EQ(0, stats.queue_depth);
+  EXPECT_EQ(0, stats.max_queue_depth);
+}
+
+/**
+ * @brief Tests that a request arriving at a full queue is rejected
+ */
+TEST_F(SlotDispatcherTest, full_queue_test)
+{
+  SlotDispatcher dispatcher(1, 1);
+  int slot = dispatcher.acquire();
+  ASSERT_EQ(1, slot);
+  boost::thread waiting(boost::bind(&SlotDispatcherTest::request, this, &dispatcher, 1));
+  waitForQueue(dispatcher, 1);
+  EXPECT_EQ(0, dispatcher.acquire());
+  dispatcher.release(slot);
+  waiting.join();
+
+  SlotDispatcher::Stats stats = dispatcher.stats();
+  EXPECT_EQ(2, stats.dispatched);
+  EXPECT_EQ(1, stats.rejected);
+  EXPECT_EQ(1, stats.max_queue_depth);
+  ASSERT_EQ(1, served_.size());
+}
+
+/**
+ * @brief Tests that the waiting requests get the slot in the order they arrived
+ */
+TEST_F(SlotDispatcherTest, fifo_test)
+{
+  SlotDispatcher dispatcher(1, 5);
+  int slot = dispatcher.acquire();
+  boost::thread_group waiting;
+  for (int i = 0; i < 5; i++)
+  {
+    waiting.create_thread(boost::bind(&SlotDispatcherTest::request, this, &dispatcher, i));
+    waitForQueue(dispatcher, i + 1);
+  }
+  dispatcher.release(slot);
+  waiting.join_all();
+
+  ASSERT_EQ(5, served_.size());
+  for (int i = 0; i < 5; i++)
+    EXPECT_EQ(i, served_[i]);
+  EXPECT_EQ(5, dispatcher.stats().max_queue_depth);
+}
+
+/**
+ * @brief Tests that a request gets the idle slot configured for it, even if that slot served more requests
+ */
+TEST_F(SlotDispatcherTest, affinity_test)
+{
+  SlotDispatcher dispatcher(3, 0);
+  int a = dispatcher.acquire("a");
+  int b = dispatcher.acquire("b");
+  dispatcher.release(a, "a");
+  dispatcher.release(b, "b");
+
+  for (int i = 0; i < 3; i++)
+  {
+    int slot = dispatcher.acquire("b");
+    EXPECT_EQ(b, slot);
+    dispatcher.release(slot, "b");
+  }
+  int slot = dispatcher.acquire("a");
+  EXPECT_EQ(a, slot);
+  dispatcher.release(slot, "a");
+
+  // without a matching slot, the least-loaded one is picked
+  slot = dispatcher.acquire("c");
+  EXPECT_NE(a, slot);
+  EXPECT_NE(b, slot);
+  dispatcher.release(slot, "c");
+}
+
+/**
+ * @class CostmapSnapshotTest
+ * @brief Saves and reopens the costmap snapshots of a map in a temporary directory
+ */
+class CostmapSnapshotTest : public ::testing::Test
+{
+  protected:
+
+    /**
+     * @brief Default constructor
+     */
+    CostmapSnapshotTest()
+    {
+    }
+
+    /**
+     * @brief Creates a map YAML file and a costmap configuration in a new temporary directory
+     */
+    virtual void SetUp()
+    {
+      directory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+      boost::filesystem::create_directories(directory_);
+      map_path_ = (directory_ / "map.yaml").string();
+      config_path_ = (directory_ / "NAO.yaml").string();
+      std::ofstream(map_path_.c_str()) << "image: map.png" << std::endl;
+      std::ofstream(config_path_.c_str()) << "robot_radius: 0.2" << std::endl;
+    }
+
+    /**
+     * @brief Removes the temporary directory
+     */
+    virtual void TearDown()
+    {
+      boost::filesystem::remove_all(directory_);
+    }
+
+    /**
+     * @brief Fills the costmap with costs derived from the seed
+     */
+    void fill(costmap_2d::Costmap2D* costmap, unsigned char seed)
+    {
+      costmap->resizeMap(7, 5, 0.05, -1.0, 2.0);
+      unsigned char* grid = costmap->getCharMap();
+      for (unsigned int i = 0; i < 7 * 5; i++)
+        grid[i] = seed + i;
+    }
+
+    /**
+     * @brief Returns the costs of the costmap
+     */
+    std::vector<unsigned char> costs(const costmap_2d::Costmap2D& costmap)
+    {
+      const unsigned char* grid = costmap.getCharMap();
+      return std::vector<unsigned char>(grid, grid + costmap.getSizeInCellsX() * costmap.getSizeInCellsY());
+    }
+
+    boost::filesystem::path directory_; /**< The temporary directory */
+    std::string map_path_; /**< The map YAML file */
+    std::string config_path_; /**< The robot's costmap configuration */
+};
+
+/**
+ * @brief Tests that a saved snapshot is read back as it was written
+ */
+TEST_F(CostmapSnapshotTest, save_open_test)
+{
+  PlanningKey key(map_path_, "NAO", "dijkstra");
+  uint64_t config_hash = CostmapSnapshot::configHash(config_path_);
+  std::string path = CostmapSnapshot::path(map_path_, "NAO");
+  costmap_2d::Costmap2D saved, opened;
+  fill(&saved, 10);
+  CostmapSnapshot::save(path, key, config_hash, saved);
+
+  CostmapSnapshot snapshot;
+  ASSERT_TRUE(snapshot.open(path, key, config_hash));
+  snapshot.copyTo(&opened);
+  EXPECT_EQ(7, opened.getSizeInCellsX());
+  EXPECT_EQ(5, opened.getSizeInCellsY());
+  EXPECT_EQ(0.05, opened.getResolution());
+  EXPECT_EQ(-1.0, opened.getOriginX());
+  EXPECT_EQ(2.0, opened.getOriginY());
+  EXPECT_TRUE(costs(saved) == costs(opened));
+  EXPECT_FALSE(snapshot.open(path, key, config_hash + 1));
+}
+
+/**
+ * @brief Tests that a snapshot is ignored once its map is modified, and is used again once rebuilt
+ */
+TEST_F(CostmapSnapshotTest, modified_map_test)
+{
+  PlanningKey old_key(map_path_, "NAO", "dijkstra");
+  uint64_t config_hash = CostmapSnapshot::configHash(config_path_);
+  std::string path = CostmapSnapshot::path(map_path_, "NAO");
+  costmap_2d::Costmap2D old_costmap, new_costmap, opened;
+  fill(&old_costmap, 10);
+  CostmapSnapshot::save(path, old_key, config_hash, old_costmap);
+
+  boost::filesystem::last_write_time(map_path_, old_key.map_mtime + 10);
+  PlanningKey new_key(map_path_, "NAO", "dijkstra");
+  ASSERT_NE(old_key.map_mtime, new_key.map_mtime);
+  CostmapSnapshot snapshot;
+  EXPECT_FALSE(snapshot.open(path, new_key, config_hash));
+
+  fill(&new_costmap, 100);
+  CostmapSnapshot::save(path, new_key, config_hash, new_costmap);
+  ASSERT_TRUE(snapshot.open(path, new_key, config_hash));
+  snapshot.copyTo(&opened);
+  EXPECT_TRUE(costs(new_costmap) == costs(opened));
+  EXPECT_FALSE(snapshot.open(path, old_key, config_hash));
+}
+
+/**
+ * @class MapStoreTest
+ * @brief Loads same-sized maps of several users into a map store
+ */
+class MapStoreTest : public ::testing::Test
+{
+  protected:
+
+    /**
+     * @brief Default constructor
+     */
+    MapStoreTest()
+    {
+    }
+
+    /**
+     * @brief Describes the same image as the map x of the users a, b and c, in a new temporary directory
+     */
+    virtual void SetUp()
+    {
+      directory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+      std::string image = ros::package::getPath("rapp_map_server") + "/maps/empty.png";
+      const char* users[] = {"a", "b", "c"};
+      for (int i = 0; i < 3; i++)
+      {
+        boost::filesystem::create_directories(directory_ / users[i]);
+        std::string map_path = (directory_ / users[i] / "x.yaml").string();
+        std::ofstream(map_path.c_str()) << "image: " << image << std::endl
+          << "resolution: 0.02" << std::endl << "origin: [0.0, 0.0, 0.0]" << std::endl
+          << "negate: 0" << std::endl << "occupied_thresh: 0.65" << std::endl
+          << "free_thresh: 0.196" << std::endl;
+        keys_.push_back(PlanningKey(map_path, "NAO", "dijkstra"));
+      }
+    }
+
+    /**
+     * @brief Removes the temporary directory
+     */
+    virtual void TearDown()
+    {
+      boost::filesystem::remove_all(directory_);
+    }
+
+    boost::filesystem::path directory_; /**< The temporary directory */
+    std::vector<PlanningKey> keys_; /**< The maps of the users a, b and c */
+};
+
+/**
+ * @brief Tests that the least recently used map is evicted, and stays alive while it is used
+ */
+TEST_F(MapStoreTest, eviction_order_test)
+{
+  MapStore probe(1 << 30, "map");
+  probe.get(keys_[0]);
+  std::size_t map_bytes = probe.stats().bytes;
+  ASSERT_GT(map_bytes, 0);
+
+  // room for two maps
+  MapStore store(2 * map_bytes + map_bytes / 2, "map");
+  boost::shared_ptr<const nav_msgs::OccupancyGrid> a = store.get(keys_[0]);
+  boost::shared_ptr<const nav_msgs::OccupancyGrid> b = store.get(keys_[1]);
+  EXPECT_TRUE(a == store.get(keys_[0]));
+  store.get(keys_[2]);
+
+  MapStore::Stats stats = store.stats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(1, stats.evictions);
+  EXPECT_EQ(2, stats.maps);
+  EXPECT_EQ(2 * map_bytes, stats.bytes);
+  ASSERT_EQ(2, stats.names.size());
+  EXPECT_EQ("c/x", stats.names[0]);
+  EXPECT_EQ("a/x", stats.names[1]);
+  EXPECT_FALSE(b->data.empty());
+
+  // the evicted map is loaded again, evicting the next least recently used one
+  EXPECT_TRUE(b != store.get(keys_[1]));
+  stats = store.stats();
+  EXPECT_EQ(2, stats.evictions);
+  ASSERT_EQ(2, stats.names.size());
+  EXPECT_EQ("b/x", stats.names[0]);
+  EXPECT_EQ("c/x", stats.names[1]);
+}
+
+/**
+ * @brief Tests that a map larger than the budget is not kept
+ */
+TEST_F(MapStoreTest, over_budget_test)
+{
+  MapStore store(1, "map");
+  boost::shared_ptr<const nav_msgs::OccupancyGrid> a = store.get(keys_[0]);
+  EXPECT_FALSE(a->data.empty());
+  EXPECT_TRUE(a != store.get(keys_[0]));
+  MapStore::Stats stats = store.stats();
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(2, stats.evictions);
+  EXPECT_EQ(0, stats.maps);
+}
+
+/**
+ * @brief The main function. Initializes the unit tests
+ */
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
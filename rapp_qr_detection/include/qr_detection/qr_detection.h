@@ -21,8 +21,12 @@ limitations under the License.
 #include "ros/ros.h"
 
 #include <rapp_platform_ros_communications/QrDetectionRosSrv.h>
+#include <rapp_platform_ros_communications/QrCodesMsg.h>
+
+#include <sensor_msgs/Image.h>
 
 #include <qr_detection/qr_detector.h>
+#include <qr_detection/qr_tracker.h>
 
 /**
  * @class QrDetection
@@ -48,6 +52,13 @@ class QrDetection
       rapp_platform_ros_communications::QrDetectionRosSrv::Response& res
       );
 
+    /**
+     * @brief The image stream callback. Tracks the QR codes between frames
+     * and publishes the codes of every frame.
+     * @param msg [const sensor_msgs::ImageConstPtr&] The frame
+     */
+    void imageStreamCallback(const sensor_msgs::ImageConstPtr& msg);
+
   private:
     /**< The ROS node handle */
     ros::NodeHandle nh_;
@@ -60,6 +71,15 @@ class QrDetection
 
     /**< Object of QrDetection type */
     QrDetector qr_detector_;
+
+    /**< The image stream subscriber, active if a stream topic is set */
+    ros::Subscriber imageStreamSubscriber_;
+
+    /**< The publisher of the QR codes detected in the image stream */
+    ros::Publisher streamDetectionsPublisher_;
+
+    /**< Tracks the QR codes between the frames of the image stream */
+    QrTracker qr_tracker_;
 };
 
 #endif // RAPP_QR_DETECTION_NODE
@@ -25,6 +25,8 @@ limitations under the License.
 #include <opencv2/objdetect/objdetect.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include <boost/thread/tss.hpp>
+
 // QR detection utilized the zbar library
 #include <zbar.h>
 
@@ -36,6 +38,35 @@ struct QrCode
 {
   cv::Point center;
   std::string message;
+  /**< The axis aligned box enclosing the code's corners */
+  cv::Rect bounding_box;
+};
+
+/**
+ * @class QrDetectionStats
+ * @brief Structure holding how a QR detection went, per scanning stage
+ */
+struct QrDetectionStats
+{
+  /**< The stages a detection can finish at */
+  enum Stage
+  {
+    NOT_FOUND = 0,
+    RAW,
+    SHARPENED
+  };
+
+  QrDetectionStats(void) :
+    stage(NOT_FOUND), raw_ms(0), sharpened_ms(0)
+  {
+  }
+
+  /**< The stage that decoded the QR codes */
+  Stage stage;
+  /**< Time spent in the raw grayscale scan, in milliseconds */
+  double raw_ms;
+  /**< Time spent in the sharpening and the second scan, in milliseconds */
+  double sharpened_ms;
 };
 
 /**
@@ -59,13 +90,58 @@ class QrDetector
     std::vector<QrCode> findQrs(std::string file_name);
 
     /**
-     * @brief Detects QRs in a cv::Mat
+     * @brief Detects QRs in a cv::Mat. The grayscale image is scanned as is
+     * first and it is sharpened and scanned again only if nothing decodes.
      * @param img [const cv::Mat&] The input image in cv::Mat form
+     * @param stats [QrDetectionStats*] If not NULL, receives the stage that
+     * decoded the codes and the time spent in each stage
      * @return std::vector<QrCode> The detected QR codes
      */
-    std::vector<QrCode> detectQrs(const cv::Mat& img);
+    std::vector<QrCode> detectQrs(const cv::Mat& img,
+      QrDetectionStats* stats = NULL);
+
+    /**
+     * @brief Detects QRs in a region of a cv::Mat, with the same two stages
+     * as the whole image detection
+     * @param img [const cv::Mat&] The input image in cv::Mat form
+     * @param roi [const cv::Rect&] The scanned region. It is clipped to the
+     * image.
+     * @param stats [QrDetectionStats*] If not NULL, receives the stage that
+     * decoded the codes and the time spent in each stage
+     * @return std::vector<QrCode> The detected QR codes, in the image's
+     * coordinates
+     */
+    std::vector<QrCode> detectQrs(const cv::Mat& img, const cv::Rect& roi,
+      QrDetectionStats* stats = NULL);
 
   private:
+
+    /**< The zbar scanner of each thread, configured on first use */
+    boost::thread_specific_ptr<zbar::ImageScanner> scanner_;
+
+    /**
+     * @brief Returns the calling thread's scanner, creating it on first use
+     * @return zbar::ImageScanner& The scanner, configured for QR codes only
+     */
+    zbar::ImageScanner& scanner(void);
+
+    /**
+     * @brief Scans a grayscale image for QR codes
+     * @param gray_frame [const cv::Mat&] The continuous 8-bit grayscale image
+     * @param offset [const cv::Point&] Added to the codes' coordinates, for
+     * images that are regions of a larger one
+     * @return std::vector<QrCode> The detected QR codes
+     */
+    std::vector<QrCode> scan(const cv::Mat& gray_frame,
+      const cv::Point& offset = cv::Point());
+
+    /**
+     * @brief Sharpens a grayscale image, making blurry codes decodable
+     * @param gray_frame [const cv::Mat&] The 8-bit grayscale image
+     * @return cv::Mat The sharpened image
+     */
+    cv::Mat sharpen(const cv::Mat& gray_frame);
+
     /**
      * @brief Loads an image into a cv::Mat structure
      * @param file_name [std::string] The file URI
@@ -0,0 +1,120 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#ifndef RAPP_QR_TRACKER_NODE
+#define RAPP_QR_TRACKER_NODE
+
+#include <qr_detection/qr_detector.h>
+
+/**
+ * @class QrTracker
+ * @brief Detects QR codes in consecutive frames of a stream. Known codes are
+ * searched for only in a region around their last location, while the whole
+ * frame is scanned every few frames or when no code is tracked.
+ */
+class QrTracker
+{
+  public:
+
+    /**
+     * @brief Constructor
+     * @param full_scan_interval [unsigned int] The whole frame is scanned
+     * once every that many frames
+     * @param roi_margin [double] The region searched around a known code,
+     * as a fraction of the code's size added on each side
+     * @param max_misses [unsigned int] The consecutive frames a code may be
+     * missing before it is dropped
+     */
+    QrTracker(unsigned int full_scan_interval = 10, double roi_margin = 0.5,
+      unsigned int max_misses = 2);
+
+    /**
+     * @brief Detects the QR codes of the next frame of the stream
+     * @param frame [const cv::Mat&] The frame
+     * @return std::vector<QrCode> The QR codes found in the frame
+     */
+    std::vector<QrCode> process(const cv::Mat& frame);
+
+    /**
+     * @brief Sets how often the whole frame is scanned
+     * @param full_scan_interval [unsigned int] The whole frame is scanned
+     * once every that many frames
+     */
+    void setFullScanInterval(unsigned int full_scan_interval);
+
+    /**
+     * @brief Forgets the tracked codes, the next frame is scanned whole
+     */
+    void reset(void);
+
+    /**
+     * @brief Returns whether the last processed frame was scanned whole
+     * @return bool True for a whole frame scan
+     */
+    bool lastScanWasFull(void) const;
+
+  private:
+
+    /**
+     * @class Track
+     * @brief A code seen in the previous frames
+     */
+    struct Track
+    {
+      /**< The code, as last seen */
+      QrCode code;
+      /**< The consecutive frames the code was not found in */
+      unsigned int misses;
+    };
+
+    /**
+     * @brief Scans the whole frame and replaces the tracks
+     * @param frame [const cv::Mat&] The frame
+     * @return std::vector<QrCode> The QR codes found in the frame
+     */
+    std::vector<QrCode> fullScan(const cv::Mat& frame);
+
+    /**
+     * @brief Scans the region around each track and updates the tracks
+     * @param frame [const cv::Mat&] The frame
+     * @return std::vector<QrCode> The QR codes found in the frame
+     */
+    std::vector<QrCode> trackedScan(const cv::Mat& frame);
+
+    /**< The detector performing the scans */
+    QrDetector qr_detector_;
+
+    /**< The codes currently tracked */
+    std::vector<Track> tracks_;
+
+    /**< The frames processed since the last whole frame scan */
+    unsigned int frames_since_full_scan_;
+
+    /**< Whether the last processed frame was scanned whole */
+    bool last_scan_full_;
+
+    /**< The whole frame is scanned once every that many frames */
+    unsigned int full_scan_interval_;
+
+    /**< The margin around a known code, as a fraction of its size */
+    double roi_margin_;
+
+    /**< The consecutive frames a code may be missing before it is dropped */
+    unsigned int max_misses_;
+};
+
+#endif // RAPP_QR_TRACKER_NODE
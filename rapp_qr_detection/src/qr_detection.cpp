@@ -17,6 +17,9 @@ limitations under the License.
 
 #include <qr_detection/qr_detection.h>
 
+#include <cv_bridge/cv_bridge.h>
+#include <sensor_msgs/image_encodings.h>
+
 /** 
  * @brief Default constructor 
  */
@@ -29,6 +32,36 @@ QrDetection::QrDetection(void)
   // Creating the service server concerning the face detection functionality
   qrDetectionService_ = nh_.advertiseService(qrDetectionTopic_,
     &QrDetection::qrDetectionCallback, this);
+
+  // The image stream mode is optional, enabled by setting the stream topic
+  std::string stream_topic;
+  if(!nh_.getParam("/rapp_qr_detection_stream_topic", stream_topic) ||
+    stream_topic.empty())
+  {
+    ROS_INFO("Qr detection stream topic not set, stream mode disabled");
+    return;
+  }
+  std::string detections_topic;
+  if(!nh_.getParam("/rapp_qr_detection_stream_detections_topic",
+      detections_topic))
+  {
+    ROS_ERROR("Qr detection stream detections topic param does not exist");
+  }
+  int full_scan_interval = 10;
+  if(!nh_.getParam("/rapp_qr_detection_stream_full_scan_interval",
+      full_scan_interval))
+  {
+    ROS_WARN("Qr detection stream full scan interval param not found, "
+      "using %d", full_scan_interval);
+  }
+  qr_tracker_.setFullScanInterval(full_scan_interval > 0 ?
+    full_scan_interval : 1);
+
+  streamDetectionsPublisher_ = nh_.advertise<
+    rapp_platform_ros_communications::QrCodesMsg>(detections_topic, 10);
+  // Only the latest frame matters, older ones are dropped
+  imageStreamSubscriber_ = nh_.subscribe(stream_topic, 1,
+    &QrDetection::imageStreamCallback, this);
 }
 
 /**
@@ -57,3 +90,56 @@ bool QrDetection::qrDetectionCallback(
 
   return true;
 }
+
+/**
+ * @brief The image stream callback. Tracks the QR codes between frames
+ * and publishes the codes of every frame.
+ * @param msg [const sensor_msgs::ImageConstPtr&] The frame
+ */
+void QrDetection::imageStreamCallback(const sensor_msgs::ImageConstPtr& msg)
+{
+  // Grayscale frames are used as they are, the rest are converted to BGR
+  cv_bridge::CvImageConstPtr frame;
+  try
+  {
+    if(msg->encoding == sensor_msgs::image_encodings::MONO8)
+    {
+      frame = cv_bridge::toCvShare(msg);
+    }
+    else
+    {
+      frame = cv_bridge::toCvShare(msg, sensor_msgs::image_encodings::BGR8);
+    }
+  }
+  catch(cv_bridge::Exception& e)
+  {
+    ROS_ERROR("Qr detection stream frame conversion failed: %s", e.what());
+    return;
+  }
+
+  // The callbacks of a single subscriber are not run concurrently, thus the
+  // tracker needs no locking
+  std::vector<QrCode> qrs = qr_tracker_.process(frame->image);
+
+  rapp_platform_ros_communications::QrCodesMsg codes;
+  codes.header = msg->header;
+  for(unsigned int i = 0 ; i < qrs.size() ; i++)
+  {
+    geometry_msgs::PointStamped qr_center, up_left, down_right;
+    qr_center.header = msg->header;
+    qr_center.point.x = qrs[i].center.x;
+    qr_center.point.y = qrs[i].center.y;
+    up_left.header = msg->header;
+    up_left.point.x = qrs[i].bounding_box.x;
+    up_left.point.y = qrs[i].bounding_box.y;
+    down_right.header = msg->header;
+    down_right.point.x = qrs[i].bounding_box.x + qrs[i].bounding_box.width;
+    down_right.point.y = qrs[i].bounding_box.y + qrs[i].bounding_box.height;
+
+    codes.qr_centers.push_back(qr_center);
+    codes.qr_messages.push_back(qrs[i].message);
+    codes.qr_up_left.push_back(up_left);
+    codes.qr_down_right.push_back(down_right);
+  }
+  streamDetectionsPublisher_.publish(codes);
+}
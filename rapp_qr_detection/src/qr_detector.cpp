@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <qr_detection/qr_detector.h>
 
+#include <algorithm>
+
 /** 
  * @brief Default constructor 
  */
@@ -36,40 +38,36 @@ cv::Mat QrDetector::loadImage(std::string file_name)
 }
 
 /**
- * @brief Detects QRs in a cv::Mat
- * @param img [const cv::Mat&] The input image in cv::Mat form
- * @return std::vector<QrCode> The detected QR codes
+ * @brief Returns the calling thread's scanner, creating it on first use
+ * @return zbar::ImageScanner& The scanner, configured for QR codes only
  */
-std::vector<QrCode> QrDetector::detectQrs(const cv::Mat& input_frame)
+zbar::ImageScanner& QrDetector::scanner(void)
 {
-  cv::Mat gray_frame;
-
-  unsigned int channels = input_frame.channels();
-  if( channels == 3 )
+  if(scanner_.get() == NULL)
   {
-    cv::cvtColor(input_frame, gray_frame, CV_BGR2GRAY);
+    scanner_.reset(new zbar::ImageScanner);
+    scanner_->set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_ENABLE, 0);
+    scanner_->set_config(zbar::ZBAR_QRCODE, zbar::ZBAR_CFG_ENABLE, 1);
   }
+  return *scanner_;
+}
 
-  int gaussiansharpenblur = 5;
-  float gaussiansharpenweight = 0.8;
-
-  cv::Mat blured;
-  normalize(gray_frame, gray_frame, 255, 0, cv::NORM_MINMAX);
-  cv::GaussianBlur(gray_frame, blured, cv::Size(0, 0), gaussiansharpenblur);
-  cv::addWeighted(gray_frame, 1 + gaussiansharpenweight, blured,
-    -gaussiansharpenweight, 0, gray_frame);
-
+/**
+ * @brief Scans a grayscale image for QR codes
+ * @param gray_frame [const cv::Mat&] The continuous 8-bit grayscale image
+ * @param offset [const cv::Point&] Added to the codes' coordinates, for
+ * images that are regions of a larger one
+ * @return std::vector<QrCode> The detected QR codes
+ */
+std::vector<QrCode> QrDetector::scan(const cv::Mat& gray_frame,
+  const cv::Point& offset)
+{
   int width = gray_frame.cols;
   int height = gray_frame.rows;
-  uchar *raw = gray_frame.data;
-
-  zbar::Image image(width, height, "Y800", raw, width * height);
 
-  //!< QrCode scanner
-  zbar::ImageScanner scanner;
-  scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_ENABLE, 0);
-  scanner.set_config(zbar::ZBAR_QRCODE, zbar::ZBAR_CFG_ENABLE, 1);
-  scanner.scan(image);
+  // zbar reads the pixels in place, no copy is made
+  zbar::Image image(width, height, "Y800", gray_frame.data, width * height);
+  scanner().scan(image);
 
   std::vector<QrCode> qrs;
   for (zbar::Image::SymbolIterator symbol = image.symbol_begin();
@@ -79,20 +77,137 @@ std::vector<QrCode> QrDetector::detectQrs(const cv::Mat& input_frame)
     QrCode temp_qr;
     temp_qr.message = symbol->get_data();
 
+    int min_x = width, min_y = height, max_x = 0, max_y = 0;
     for(int i = 0; i < symbol->get_location_size(); i++)
     {
-      temp_qr.center.x += symbol->get_location_x(i);
-      temp_qr.center.y += symbol->get_location_y(i);
+      int x = symbol->get_location_x(i);
+      int y = symbol->get_location_y(i);
+      temp_qr.center.x += x;
+      temp_qr.center.y += y;
+      min_x = std::min(min_x, x);
+      min_y = std::min(min_y, y);
+      max_x = std::max(max_x, x);
+      max_y = std::max(max_y, y);
     }
 
-    temp_qr.center.x /= symbol->get_location_size();
-    temp_qr.center.y /= symbol->get_location_size();
+    if(symbol->get_location_size() > 0)
+    {
+      temp_qr.center.x /= symbol->get_location_size();
+      temp_qr.center.y /= symbol->get_location_size();
+      temp_qr.bounding_box = cv::Rect(min_x, min_y,
+        max_x - min_x + 1, max_y - min_y + 1);
+    }
+    temp_qr.center += offset;
+    temp_qr.bounding_box += offset;
 
     qrs.push_back(temp_qr);
   }
   return qrs;
 }
 
+/**
+ * @brief Sharpens a grayscale image, making blurry codes decodable
+ * @param gray_frame [const cv::Mat&] The 8-bit grayscale image
+ * @return cv::Mat The sharpened image
+ */
+cv::Mat QrDetector::sharpen(const cv::Mat& gray_frame)
+{
+  int gaussiansharpenblur = 5;
+  float gaussiansharpenweight = 0.8;
+
+  cv::Mat normalized, blured, sharpened;
+  normalize(gray_frame, normalized, 255, 0, cv::NORM_MINMAX);
+  cv::GaussianBlur(normalized, blured, cv::Size(0, 0), gaussiansharpenblur);
+  cv::addWeighted(normalized, 1 + gaussiansharpenweight, blured,
+    -gaussiansharpenweight, 0, sharpened);
+  return sharpened;
+}
+
+/**
+ * @brief Detects QRs in a cv::Mat. The grayscale image is scanned as is
+ * first and it is sharpened and scanned again only if nothing decodes.
+ * @param img [const cv::Mat&] The input image in cv::Mat form
+ * @param stats [QrDetectionStats*] If not NULL, receives the stage that
+ * decoded the codes and the time spent in each stage
+ * @return std::vector<QrCode> The detected QR codes
+ */
+std::vector<QrCode> QrDetector::detectQrs(const cv::Mat& input_frame,
+  QrDetectionStats* stats)
+{
+  return detectQrs(input_frame,
+    cv::Rect(0, 0, input_frame.cols, input_frame.rows), stats);
+}
+
+/**
+ * @brief Detects QRs in a region of a cv::Mat, with the same two stages
+ * as the whole image detection
+ * @param img [const cv::Mat&] The input image in cv::Mat form
+ * @param roi [const cv::Rect&] The scanned region. It is clipped to the
+ * image.
+ * @param stats [QrDetectionStats*] If not NULL, receives the stage that
+ * decoded the codes and the time spent in each stage
+ * @return std::vector<QrCode> The detected QR codes, in the image's
+ * coordinates
+ */
+std::vector<QrCode> QrDetector::detectQrs(const cv::Mat& input_frame,
+  const cv::Rect& roi, QrDetectionStats* stats)
+{
+  QrDetectionStats local_stats;
+  if(stats == NULL)
+  {
+    stats = &local_stats;
+  }
+  std::vector<QrCode> qrs;
+  cv::Rect region = roi & cv::Rect(0, 0, input_frame.cols, input_frame.rows);
+  if(input_frame.empty() || region.area() == 0)
+  {
+    return qrs;
+  }
+
+  int64 start = cv::getTickCount();
+  cv::Mat input_region = input_frame(region);
+  cv::Mat gray_frame;
+  unsigned int channels = input_region.channels();
+  if( channels == 3 )
+  {
+    cv::cvtColor(input_region, gray_frame, CV_BGR2GRAY);
+  }
+  else if( channels == 4 )
+  {
+    cv::cvtColor(input_region, gray_frame, CV_BGRA2GRAY);
+  }
+  else if( input_region.isContinuous() )
+  {
+    // Already grayscale, scanned without a copy
+    gray_frame = input_region;
+  }
+  else
+  {
+    gray_frame = input_region.clone();
+  }
+
+  // Most frames decode as they are
+  qrs = scan(gray_frame, region.tl());
+  stats->raw_ms += (cv::getTickCount() - start) * 1000.0 /
+    cv::getTickFrequency();
+  if(!qrs.empty())
+  {
+    stats->stage = QrDetectionStats::RAW;
+    return qrs;
+  }
+
+  // Fall back to the sharpened image for blurry or low contrast frames
+  start = cv::getTickCount();
+  qrs = scan(sharpen(gray_frame), region.tl());
+  stats->sharpened_ms += (cv::getTickCount() - start) * 1000.0 /
+    cv::getTickFrequency();
+  if(!qrs.empty())
+  {
+    stats->stage = QrDetectionStats::SHARPENED;
+  }
+  return qrs;
+}
+
 /**
  * @brief Detects QRs in an image file
  * @param file_name [std::string] The input image URI
@@ -0,0 +1,160 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <qr_detection/qr_tracker.h>
+
+/**
+ * @brief Constructor
+ * @param full_scan_interval [unsigned int] The whole frame is scanned
+ * once every that many frames
+ * @param roi_margin [double] The region searched around a known code,
+ * as a fraction of the code's size added on each side
+ * @param max_misses [unsigned int] The consecutive frames a code may be
+ * missing before it is dropped
+ */
+QrTracker::QrTracker(unsigned int full_scan_interval, double roi_margin,
+  unsigned int max_misses) :
+  frames_since_full_scan_(0),
+  last_scan_full_(false),
+  full_scan_interval_(full_scan_interval > 0 ? full_scan_interval : 1),
+  roi_margin_(roi_margin),
+  max_misses_(max_misses)
+{
+}
+
+/**
+ * @brief Sets how often the whole frame is scanned
+ * @param full_scan_interval [unsigned int] The whole frame is scanned
+ * once every that many frames
+ */
+void QrTracker::setFullScanInterval(unsigned int full_scan_interval)
+{
+  full_scan_interval_ = full_scan_interval > 0 ? full_scan_interval : 1;
+}
+
+/**
+ * @brief Forgets the tracked codes, the next frame is scanned whole
+ */
+void QrTracker::reset(void)
+{
+  tracks_.clear();
+  frames_since_full_scan_ = 0;
+}
+
+/**
+ * @brief Returns whether the last processed frame was scanned whole
+ * @return bool True for a whole frame scan
+ */
+bool QrTracker::lastScanWasFull(void) const
+{
+  return last_scan_full_;
+}
+
+/**
+ * @brief Detects the QR codes of the next frame of the stream
+ * @param frame [const cv::Mat&] The frame
+ * @return std::vector<QrCode> The QR codes found in the frame
+ */
+std::vector<QrCode> QrTracker::process(const cv::Mat& frame)
+{
+  if(frame.empty())
+  {
+    return std::vector<QrCode>();
+  }
+
+  // New codes can only be found by a whole frame scan
+  if(tracks_.empty() || frames_since_full_scan_ + 1 >= full_scan_interval_)
+  {
+    return fullScan(frame);
+  }
+  return trackedScan(frame);
+}
+
+/**
+ * @brief Scans the whole frame and replaces the tracks
+ * @param frame [const cv::Mat&] The frame
+ * @return std::vector<QrCode> The QR codes found in the frame
+ */
+std::vector<QrCode> QrTracker::fullScan(const cv::Mat& frame)
+{
+  std::vector<QrCode> qrs = qr_detector_.detectQrs(frame);
+  last_scan_full_ = true;
+  frames_since_full_scan_ = 0;
+
+  tracks_.clear();
+  for(unsigned int i = 0 ; i < qrs.size() ; i++)
+  {
+    Track track;
+    track.code = qrs[i];
+    track.misses = 0;
+    tracks_.push_back(track);
+  }
+  return qrs;
+}
+
+/**
+ * @brief Scans the region around each track and updates the tracks
+ * @param frame [const cv::Mat&] The frame
+ * @return std::vector<QrCode> The QR codes found in the frame
+ */
+std::vector<QrCode> QrTracker::trackedScan(const cv::Mat& frame)
+{
+  last_scan_full_ = false;
+  frames_since_full_scan_++;
+
+  std::vector<QrCode> qrs;
+  std::vector<Track> tracks;
+  for(unsigned int t = 0 ; t < tracks_.size() ; t++)
+  {
+    Track track = tracks_[t];
+    const cv::Rect& box = track.code.bounding_box;
+    int margin_x = static_cast<int>(box.width * roi_margin_) + 1;
+    int margin_y = static_cast<int>(box.height * roi_margin_) + 1;
+    // A missed code may have moved further, the region grows with the misses
+    margin_x *= track.misses + 1;
+    margin_y *= track.misses + 1;
+    cv::Rect roi(box.x - margin_x, box.y - margin_y,
+      box.width + 2 * margin_x, box.height + 2 * margin_y);
+
+    std::vector<QrCode> found = qr_detector_.detectQrs(frame, roi);
+    bool matched = false;
+    for(unsigned int i = 0 ; i < found.size() ; i++)
+    {
+      if(found[i].message == track.code.message)
+      {
+        track.code = found[i];
+        matched = true;
+        break;
+      }
+    }
+
+    if(matched)
+    {
+      track.misses = 0;
+      qrs.push_back(track.code);
+      tracks.push_back(track);
+    }
+    else if(track.misses < max_misses_)
+    {
+      track.misses++;
+      tracks.push_back(track);
+    }
+  }
+  // With every code lost, the next frame is scanned whole
+  tracks_.swap(tracks);
+  return qrs;
+}
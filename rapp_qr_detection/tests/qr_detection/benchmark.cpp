@@ -0,0 +1,187 @@
+/******************************************************************************
+Copyright 2015 RAPP
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <qr_detection/qr_detector.h>
+#include <qr_detection/qr_tracker.h>
+#include <ros/package.h>
+
+/**
+ * @brief Returns the milliseconds elapsed since the given tick count
+ */
+double elapsedMs(int64 start)
+{
+  return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+/**
+ * @brief The detection as it used to be: a new scanner per call and an
+ * unconditional sharpening of the whole frame before the single scan
+ * @return The number of decoded codes
+ */
+unsigned int legacyDetectQrs(const cv::Mat& input_frame)
+{
+  cv::Mat gray_frame, blured;
+  cv::cvtColor(input_frame, gray_frame, CV_BGR2GRAY);
+  cv::normalize(gray_frame, gray_frame, 255, 0, cv::NORM_MINMAX);
+  cv::GaussianBlur(gray_frame, blured, cv::Size(0, 0), 5);
+  cv::addWeighted(gray_frame, 1.8, blured, -0.8, 0, gray_frame);
+
+  zbar::Image image(gray_frame.cols, gray_frame.rows, "Y800",
+    gray_frame.data, gray_frame.cols * gray_frame.rows);
+  zbar::ImageScanner scanner;
+  scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_ENABLE, 0);
+  scanner.set_config(zbar::ZBAR_QRCODE, zbar::ZBAR_CFG_ENABLE, 1);
+  scanner.scan(image);
+
+  unsigned int qrs = 0;
+  for (zbar::Image::SymbolIterator symbol = image.symbol_begin();
+    symbol != image.symbol_end(); ++symbol)
+  {
+    qrs++;
+  }
+  return qrs;
+}
+
+/**
+ * @brief Compares the per frame cost of scanning every frame of a stream
+ * whole against tracking the codes between frames. The stream is emulated
+ * by moving a sample image a few pixels per frame over a white canvas.
+ * @param frame [const cv::Mat&] The sample image
+ * @param frames [int] The number of frames of the stream
+ */
+void benchmarkStream(const cv::Mat& frame, int frames)
+{
+  const int travel = 40;
+  cv::Mat canvas(frame.rows + travel, frame.cols + travel, frame.type());
+  QrDetector qr_detector;
+  QrTracker qr_tracker(10);
+
+  double full_ms = 0, tracked_ms = 0;
+  unsigned int full_hits = 0, tracked_hits = 0;
+  for(int i = 0 ; i < frames ; i++)
+  {
+    int offset = (i * 3) % travel;
+    canvas.setTo(cv::Scalar(255, 255, 255));
+    cv::Mat placement = canvas(cv::Rect(offset, offset / 2, frame.cols,
+      frame.rows));
+    frame.copyTo(placement);
+
+    int64 start = cv::getTickCount();
+    full_hits += qr_detector.detectQrs(canvas).empty() ? 0 : 1;
+    full_ms += elapsedMs(start);
+
+    start = cv::getTickCount();
+    tracked_hits += qr_tracker.process(canvas).empty() ? 0 : 1;
+    tracked_ms += elapsedMs(start);
+  }
+  printf("\nStream of %d frames, whole frame scan every 10 frames:\n",
+    frames);
+  printf("Whole frame scans:  %8.2f ms/frame  decoded %d/%d\n",
+    full_ms / frames, full_hits, frames);
+  printf("Tracking:           %8.2f ms/frame  decoded %d/%d\n",
+    tracked_ms / frames, tracked_hits, frames);
+}
+
+/**
+ * @brief Reports, for the qr_samples, how many frames decode at the raw
+ * grayscale stage and how many need the sharpening fallback, along with the
+ * latency of each stage and of the previous single-stage detection. Then it
+ * compares whole frame scans against tracking on an emulated stream.
+ * Usage: qr_detection_benchmark [iterations]
+ */
+int main(int argc, char **argv)
+{
+  int iterations = 20;
+  if(argc > 1)
+  {
+    iterations = atoi(argv[1]);
+  }
+
+  std::string path = ros::package::getPath("rapp_testing_tools") +
+    std::string("/test_data/");
+  const char* samples[] = {"qr_code_rapp.jpg", "Lenna.png",
+    "qr_samples/easyNearQr.jpg", "qr_samples/easyMediumQr.jpg",
+    "qr_samples/easyFarQr.jpg", "qr_samples/mediumNearQr.jpg",
+    "qr_samples/mediumMediumQr.jpg", "qr_samples/mediumFarQr.jpg",
+    "qr_samples/hardNearQr.jpg", "qr_samples/hardMediumQr.jpg",
+    "qr_samples/hardFarQr.jpg"};
+  const unsigned int samples_count = sizeof(samples) / sizeof(samples[0]);
+  const char* stages[] = {"none", "raw", "sharpened"};
+
+  QrDetector qr_detector;
+  unsigned int hits[3] = {0, 0, 0};
+  double raw_ms = 0, sharpened_ms = 0, total_ms = 0, legacy_ms = 0;
+  unsigned int frames = 0;
+
+  printf("%-30s %-10s %10s %10s\n", "Image", "Stage", "ms", "legacy ms");
+  for(unsigned int s = 0 ; s < samples_count ; s++)
+  {
+    cv::Mat input_frame = cv::imread(path + samples[s]);
+    if(input_frame.empty())
+    {
+      printf("Could not load %s\n", samples[s]);
+      continue;
+    }
+
+    QrDetectionStats stats;
+    double image_ms = 0, image_legacy_ms = 0;
+    for(int i = 0 ; i < iterations ; i++)
+    {
+      stats = QrDetectionStats();
+      int64 start = cv::getTickCount();
+      qr_detector.detectQrs(input_frame, &stats);
+      image_ms += elapsedMs(start);
+      raw_ms += stats.raw_ms;
+      sharpened_ms += stats.sharpened_ms;
+
+      start = cv::getTickCount();
+      legacyDetectQrs(input_frame);
+      image_legacy_ms += elapsedMs(start);
+    }
+    hits[stats.stage]++;
+    frames++;
+    total_ms += image_ms;
+    legacy_ms += image_legacy_ms;
+    printf("%-30s %-10s %10.2f %10.2f\n", samples[s], stages[stats.stage],
+      image_ms / iterations, image_legacy_ms / iterations);
+  }
+  if(frames == 0)
+  {
+    return 1;
+  }
+
+  unsigned int runs = frames * iterations;
+  printf("\nHit rate: raw %u/%u, sharpened %u/%u, none %u/%u\n",
+    hits[QrDetectionStats::RAW], frames,
+    hits[QrDetectionStats::SHARPENED], frames,
+    hits[QrDetectionStats::NOT_FOUND], frames);
+  printf("Raw stage:        %8.2f ms/frame\n", raw_ms / runs);
+  printf("Sharpened stage:  %8.2f ms/frame\n", sharpened_ms / runs);
+  printf("Two-stage total:  %8.2f ms/frame\n", total_ms / runs);
+  printf("Legacy:           %8.2f ms/frame\n", legacy_ms / runs);
+
+  cv::Mat stream_frame = cv::imread(path +
+    std::string("qr_samples/easyMediumQr.jpg"));
+  if(!stream_frame.empty())
+  {
+    benchmarkStream(stream_frame, 15 * iterations);
+  }
+  return 0;
+}
@@ -18,6 +18,7 @@ limitations under the License.
 #include <gtest/gtest.h>
 
 #include <qr_detection/qr_detector.h>
+#include <qr_detection/qr_tracker.h>
 #include <ros/package.h>
 
 /**
@@ -79,6 +80,66 @@ TEST_F(QrDetectionTest, qr_test)
   EXPECT_EQ(1, qrs.size());
 }
 
+/**
+ * @brief Tests QR detection with a grayscale image containing a qr. Should
+ * return 1 qr
+ */
+TEST_F(QrDetectionTest, qr_grayscale_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/qr_code_rapp.jpg");
+  cv::Mat gray = cv::imread(s, CV_LOAD_IMAGE_GRAYSCALE);
+  std::vector<QrCode> qrs;
+  qrs = qr_detector_->detectQrs(gray);
+  EXPECT_EQ(1, qrs.size());
+}
+
+/**
+ * @brief Tests that a clean qr decodes without the sharpening stage
+ */
+TEST_F(QrDetectionTest, qr_raw_stage_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/qr_code_rapp.jpg");
+  QrDetectionStats stats;
+  std::vector<QrCode> qrs;
+  qrs = qr_detector_->detectQrs(cv::imread(s), &stats);
+  EXPECT_EQ(1, qrs.size());
+  EXPECT_EQ(QrDetectionStats::RAW, stats.stage);
+  EXPECT_EQ(0, stats.sharpened_ms);
+}
+
+/**
+ * @brief Tests that the detected qr's center lies in its bounding box
+ */
+TEST_F(QrDetectionTest, qr_bounding_box_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  std::string s = path + std::string("/test_data/qr_code_rapp.jpg");
+  std::vector<QrCode> qrs;
+  qrs = qr_detector_->findQrs(s);
+  ASSERT_EQ(1, qrs.size());
+  EXPECT_GT(qrs[0].bounding_box.area(), 0);
+  EXPECT_TRUE(qrs[0].bounding_box.contains(qrs[0].center));
+}
+
+/**
+ * @brief Tests QR tracking over a stream of identical frames. The qr should
+ * be found in every frame and the whole frame scanned every 5 frames
+ */
+TEST_F(QrDetectionTest, qr_tracker_test)
+{
+  std::string path = ros::package::getPath("rapp_testing_tools");
+  cv::Mat frame = cv::imread(path + std::string("/test_data/qr_code_rapp.jpg"));
+  QrTracker qr_tracker(5);
+  for(unsigned int i = 0 ; i < 12 ; i++)
+  {
+    std::vector<QrCode> qrs = qr_tracker.process(frame);
+    EXPECT_EQ(1, qrs.size());
+    EXPECT_EQ(i % 5 == 0, qr_tracker.lastScanWasFull());
+  }
+}
+
 /**
  * @brief Tests QR detection with a non-existent image. Should return 0 qrs
  */